@@ -0,0 +1,238 @@
+#ifndef AGENT_CLASS
+#define AGENT_CLASS
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include "Environment.hpp"
+#include "RewardTape.hpp"
+#include "DumpWriter.hpp"
+#include "Profiler.hpp"
+
+/**
+ * Reward of an arm reported after the decision, see Agent::apply_feedback
+ **/
+struct Feedback {
+    int arm, reward;
+};
+
+/**
+ * Agent playing the slot machine, put together from a selection policy (which arm to pull) and an update
+ * policy (what the agent learns from the reward). The agent keeps the bookkeeping every algorithm shares
+ * (points, optimal choices, rounds, environment, random streams) and runs the round; the policies are
+ * template parameters, so their calls are resolved at compile time and inline into exec_round.
+ * The agent only refers to its environment, which must outlive it (or the next change_parameters), so
+ * several agents can play the same environment and a sweep can regenerate it in place. The environment is an
+ * Environment, or any class with its get_arms_size, is_optimal, pull_chosen_arm(choice, r), next_round,
+ * print_arm_probs and get_arm_probs (BatchLane plays one environment of a BatchEnvironment).
+ *
+ * An update policy provides
+ *      void reset(int n)                               every arm back to its initial state
+ *      void update(int choice, int reward, int round)  learns from the reward of a round (round is 1 based)
+ *      const double *values()                          per-arm values written to the dump
+ *      void update_batch(const Feedback *batch, int n, int round)
+ *                                                      learns from n rewards in order, the first of them
+ *                                                      in round (only needed by apply_feedback)
+ *      void print_values(std::ostream &file)           per-arm values in the text format
+ * and a selection policy provides
+ *      static const bool uses_rng                      whether choose draws from the agent's stream
+ *      void reset(int n, Update &update)               back to the first round
+ *      int choose(Update &update, int round, Rng &rng) arm to pull in a round, -1 for none
+ *      void observe(int choice, Update &update)        called after the update of the chosen arm
+ **/
+template <class Selection, class Update, class Env = Environment>
+class Agent {
+    protected:
+        // Policies of the algorithm
+        Selection selection;
+        Update update;
+        // Cumulative points
+        int points, optm_chosen, rounds;
+        // Current Environment
+        Env *curr_env;
+        // Random streams used to choose arms and to produce rewards
+        Rng rng, reward_rng;
+        // Rewards replayed instead of pulling the environment (nullptr when the environment is pulled)
+        // and the number of pulls of every arm so far
+        const RewardTape *tape;
+        std::vector<int> tape_pulls;
+        // Label for the type of algorithm
+        std::string label;
+
+    public:
+        // Type of the environment the agent plays
+        typedef Env EnvironmentType;
+
+        /**
+         * Default constructor
+         **/
+        Agent(Env &env, const std::string &l, const Selection &s = Selection(), const Update &u = Update())
+        :selection(s)
+        ,update(u)
+        ,points(0)
+        ,optm_chosen(0)
+        ,rounds(0)
+        ,curr_env(&env)
+        ,tape(nullptr)
+        ,label(l) {
+            update.reset(curr_env->get_arms_size());
+            selection.reset(curr_env->get_arms_size(), update);
+        }
+
+        /**
+         * returns the cumulative rewards collected
+         **/
+        int get_points(){ return points; }
+
+        /**
+         * Chooses an arm to pull based on the selection policy
+         **/
+        int choose_arm(){ return selection.choose(update, rounds + 1, rng); }
+
+        /**
+         * Executes a single round of game and updates the policies
+         **/
+        void exec_round(){
+            // Choose an arm
+            PROFILE_BEGIN(PHASE_SELECT);
+            int choice = choose_arm();
+            PROFILE_END(PHASE_SELECT);
+
+            if (choice == -1)
+                return;
+
+            // Pulls the arm and returns the reward (0 or 1), the next reward of the arm on the tape if there is one
+            PROFILE_BEGIN(PHASE_PULL);
+            int reward = begin_round(choice);
+            if (reward < 0)
+                reward = curr_env->pull_chosen_arm(choice, reward_rng);
+            PROFILE_END(PHASE_PULL);
+
+            end_round(choice, reward);
+        }
+
+        /**
+         * First half of a round whose arm is pulled by the caller (see BatchAgent): counts the choice and returns
+         * the next reward of the arm on the tape, or -1 when the arm has to be pulled with get_reward_rng()
+         **/
+        int begin_round(int choice){
+            //Add 1 to optimal chosen variable if the optimal arm is chosen else add 0 (do nothing)
+            optm_chosen += curr_env->is_optimal(choice);
+
+            if (tape != nullptr && tape_pulls[choice] < tape->get_length())
+                return tape->reward(choice, tape_pulls[choice]++);
+            return -1;
+        }
+
+        /**
+         * Second half of a round: moves the environment on and learns from the reward of the chosen arm
+         **/
+        void end_round(int choice, int reward){
+            curr_env->next_round();
+
+            // Adds the reward to the total points accumulated
+            points += reward;
+
+            PROFILE_BEGIN(PHASE_UPDATE);
+            update.update(choice, reward, rounds + 1);
+            selection.observe(choice, update);
+            PROFILE_END(PHASE_UPDATE);
+
+            // Update the number of rounds played
+            rounds++;
+        }
+
+        /**
+         * Returns the stream the rewards of the agent's pulls come from
+         **/
+        Rng &get_reward_rng(){ return reward_rng; }
+
+        /**
+         * Learns from a batch of delayed rewards of arms chosen earlier, in the order given. Every feedback
+         * counts as a round of its arm (optimal choices against the environment as it is now), and the update
+         * policy folds the whole batch into its state at once
+         **/
+        void apply_feedback(const Feedback *batch, int n){
+            PROFILE_BEGIN(PHASE_UPDATE);
+            update.update_batch(batch, n, rounds + 1);
+            for (int i = 0; i < n; i++) {
+                points += batch[i].reward;
+                optm_chosen += curr_env->is_optimal(batch[i].arm);
+                selection.observe(batch[i].arm, update);
+            }
+            rounds += n;
+            PROFILE_END(PHASE_UPDATE);
+        }
+
+        /**
+         * Plays count rounds one after the other
+         **/
+        void run_rounds(int count){
+            for (int i = 0; i < count; i++)
+                exec_round();
+        }
+
+        /**
+         * Return the percentage of iterations where reward was received
+         **/
+        double get_reward_percent(){ return (double)points / (double)rounds; }
+
+        /**
+         * Return the percentage of iterations where optimal arm was chosen
+         **/
+        double get_optm_percent(){ return (double)optm_chosen / (double)rounds; }
+
+        /**
+         * Prints the agent's statistics
+         **/
+        void print_agent_stats(std::ostream &file = std::cout){
+            file << "-------------------------------------" << label << "---------------------------------------\n";
+            file << "Optimal Action Chosen:\t" << std::setw(5) << optm_chosen << "/" << rounds << std::endl;
+            file << "Percentage:\t" << std::setw(20) << get_optm_percent() * 100 << "%" << std::endl;
+            file << "Success Rate:\t" << std::setw(13) << points << "/" << rounds << std::endl;
+            file << "Percentage:\t" << std::setw(20) << get_reward_percent() * 100 << "%" << std::endl << std::endl;
+
+            update.print_values(file);
+            curr_env->print_arm_probs(file);
+            file << "----------------------------------------------------------------------------------\n\n" << std::endl;
+        }
+
+        /**
+         * Queues the agent's statistics on the dump writer
+         **/
+        void trace_agent_stats(DumpWriter &dump, int config, int env, int label){
+            dump.write_snapshot(config, env, label, rounds, optm_chosen, points, update.values());
+        }
+
+        /**
+         * Resets the agent variables and takes a new environment. A selection that draws random numbers
+         * chooses with r and the rewards come from r.fork(1), otherwise the rewards come from r.
+         * Nothing is allocated once the policies have held as many arms. The environment is pulled until
+         * use_reward_tape is called
+         **/
+        void change_parameters(Env &env, Rng r = Rng()){
+            curr_env = &env;
+            tape = nullptr;
+            rng = r;
+            reward_rng = Selection::uses_rng ? rng.fork(1) : rng;
+            points = 0;
+            rounds = 0;
+            optm_chosen = 0;
+
+            int n = curr_env->get_arms_size();
+            update.reset(n);
+            selection.reset(n, update);
+        }
+
+        /**
+         * Replays the rewards of t (generated for the current environment) from now on: the k-th pull of an
+         * arm gets the k-th reward of its tape, and the environment is only pulled once the tape runs out
+         **/
+        void use_reward_tape(const RewardTape *t){
+            tape = t;
+            tape_pulls.assign(curr_env->get_arms_size(), 0);
+        }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef ALIGNEDALLOCATOR_CLASS
+#define ALIGNEDALLOCATOR_CLASS
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Allocator that places the elements of a container on a 64 byte boundary (one cache line and
+ * one AVX-512 register), so vector kernels never split a load over two cache lines
+ **/
+template <typename T>
+class AlignedAllocator {
+    public:
+        typedef T value_type;
+
+        // Alignment of every allocation in bytes
+        static const std::size_t alignment = 64;
+
+        template <typename U>
+        struct rebind { typedef AlignedAllocator<U> other; };
+
+        AlignedAllocator() {}
+
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U> &) {}
+
+        /**
+         * Allocates room for n elements
+         **/
+        T *allocate(std::size_t n) {
+            void *ptr = nullptr;
+            if (posix_memalign(&ptr, alignment, n * sizeof(T) > 0 ? n * sizeof(T) : alignment) != 0)
+                throw std::bad_alloc();
+            return static_cast<T *>(ptr);
+        }
+
+        /**
+         * Frees memory returned by allocate
+         **/
+        void deallocate(T *ptr, std::size_t) { free(ptr); }
+};
+
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T> &, const AlignedAllocator<U> &) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T> &, const AlignedAllocator<U> &) { return false; }
+
+#endif
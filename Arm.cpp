@@ -1,20 +1,20 @@
 #include "Arm.hpp"
 
 /**
- * Default constructor that regenerates random probability of reward
+ * Constructor that generates a random probability of reward from the given stream
  **/
-Arm::Arm(){ gen_new_prob(); }
+Arm::Arm(Rng &rng){ gen_new_prob(rng); }
 /**
  * Returns the probability of the arm producing a reward
  **/
-double Arm::get_prob(){ return prob; }
+double Arm::get_prob(){ return threshold_prob(threshold); }
 /**
  * Regenerates the probability associated with this arm
  **/
-void Arm::gen_new_prob(){ prob = rand()/double(RAND_MAX); }
+void Arm::gen_new_prob(Rng &rng){ threshold = random_threshold(rng.next_u64()); }
 /**
  * Simulates pulling the arm and returns a 1 (reward) or 0 (no reward)
  **/
-int Arm::pull_arm(){ 
-    return (rand()/double(RAND_MAX) <= prob) ? 1 : 0; 
+int Arm::pull_arm(Rng &rng){ 
+    return rng.next_bernoulli(threshold);
 }
\ No newline at end of file
@@ -1,32 +1,46 @@
 #ifndef ARM_CLASS
 #define ARM_CLASS
-#include <ctime>
-#include <cstdlib>
+#include "Rng.hpp"
 
 /**
  * Arm class representing an arm on slot machine with probabilistic characteristics
  **/
 class Arm {
     private: 
-        // Probability of the arm returning a reward
-        double prob;
+        // Probability of the arm returning a reward as its integer threshold (see Rng::bernoulli_threshold):
+        // the probability is k / 2^53 with threshold = k + 1, so both convert exactly
+        uint64_t threshold;
     public:
         /**
-         * Default constructor that regenerates random probability of reward
+         * Constructor that generates a random probability of reward from the given stream
          **/
-        Arm();
+        Arm(Rng &rng);
         /**
          * Returns the probability of the arm producing a reward
          **/
         double get_prob();
+        /**
+         * Returns the integer threshold of the probability (see Rng::bernoulli_threshold)
+         **/
+        uint64_t get_threshold(){ return threshold; }
+        /**
+         * Returns the threshold of the probability drawn from 64 random bits, as gen_new_prob draws it
+         **/
+        static uint64_t random_threshold(uint64_t bits){ return (bits >> 11) + 1; }
+        /**
+         * Returns the probability of an integer threshold
+         **/
+        static double threshold_prob(uint64_t threshold){
+            return (int64_t)(threshold - 1) * (1.0 / 9007199254740992.0);
+        }
         /**
          * Regenerates the probability associated with this arm
          **/
-        void gen_new_prob();
+        void gen_new_prob(Rng &rng);
         /**
          * Simulates pulling the arm and returns a 1 (reward) or 0 (no reward)
          **/
-        int pull_arm();
+        int pull_arm(Rng &rng);
 };
 
 #endif
\ No newline at end of file
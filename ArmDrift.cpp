@@ -0,0 +1,80 @@
+#include "ArmDrift.hpp"
+#include "Arm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <climits>
+
+/**
+ * Constructor of a stationary environment's drift
+ **/
+ArmDrift::ArmDrift(const Drift &d)
+:drift(d)
+,rounds_to_change(0) {}
+
+/**
+ * Sets how the arms change, from the next start on
+ **/
+void ArmDrift::set(const Drift &d){ drift = d; }
+
+/**
+ * Starts the changes of n new arms whose environment was drawn from r (the changes come from
+ * r.fork(ENV_DRIFT_STREAM)) and returns the best arm
+ **/
+int ArmDrift::start(const uint64_t *thresholds, int n, Rng r){
+    rng = r.fork(ENV_DRIFT_STREAM);
+    tree.build(thresholds, n);
+    rounds_to_change = next_change();
+    return tree.argmax(thresholds);
+}
+
+/**
+ * Returns the number of rounds until the next change, drawn from the drift stream for change points
+ **/
+int ArmDrift::next_change(){
+    if (drift.mode != DRIFT_CHANGE_POINT)
+        return std::max(drift.period, 1);
+
+    // Geometric number of rounds up to and including the next change point
+    if (drift.rate >= 1)
+        return 1;
+    if (drift.rate <= 0)
+        return INT_MAX;
+    double gap = floor(log(1 - rng.next_double()) / log1p(-drift.rate)) + 1;
+    return (gap >= INT_MAX) ? INT_MAX : (int)gap;
+}
+
+/**
+ * Returns the threshold an arm with threshold t changes to, drawn from the drift stream
+ **/
+uint64_t ArmDrift::changed_threshold(uint64_t t){
+    if (drift.mode != DRIFT_RANDOM_WALK)
+        return Arm::random_threshold(rng.next_u64());
+
+    // Reflect the step back into [0, 1]
+    double p = Arm::threshold_prob(t) + (2 * rng.next_double() - 1) * drift.step;
+    if (p < 0)
+        p = -p;
+    if (p > 1)
+        p = 2 - p;
+    return Rng::bernoulli_threshold(std::min(std::max(p, 0.0), 1.0));
+}
+
+/**
+ * Changes the n arms as set by the drift and returns the best arm
+ **/
+int ArmDrift::change(uint64_t *thresholds, int n){
+    if (drift.arms <= 0 || drift.arms >= n) {
+        for (int i = 0; i < n; i++)
+            thresholds[i] = changed_threshold(thresholds[i]);
+        tree.build(thresholds, n);
+    } else {
+        // Only the paths of the changed arms to the root are recomputed
+        for (int k = 0; k < drift.arms; k++) {
+            int arm = (int)(rng.next_double() * n);
+            thresholds[arm] = changed_threshold(thresholds[arm]);
+            tree.update(thresholds, arm);
+        }
+    }
+    rounds_to_change = next_change();
+    return tree.argmax(thresholds);
+}
@@ -0,0 +1,94 @@
+#ifndef ARMDRIFT_CLASS
+#define ARMDRIFT_CLASS
+#define ENV_DRIFT_STREAM 2 // Fork of the environment's stream that drives the changes of a non-stationary one
+
+#include <cstdint>
+#include "Rng.hpp"
+#include "ThresholdTree.hpp"
+
+/**
+ * How the arms of an environment change while it is played:
+ *      DRIFT_NONE          the arms never change (stationary)
+ *      DRIFT_RANDOM_WALK   every period rounds the probability of arms moves by up to step, reflected into [0, 1]
+ *      DRIFT_REDRAW        every period rounds arms get a new probability
+ *      DRIFT_CHANGE_POINT  arms get a new probability at change points, which come with a chance of rate per round
+ **/
+enum DriftMode { DRIFT_NONE, DRIFT_RANDOM_WALK, DRIFT_REDRAW, DRIFT_CHANGE_POINT };
+
+/**
+ * Settings of a non-stationary environment, see DriftMode
+ **/
+struct Drift {
+    DriftMode mode;
+    // Arms changed at every change (picked at random, 0 changes all of them)
+    int arms;
+    // Rounds between two changes (random walk and re-draws)
+    int period;
+    // Chance of a change point per round (change points)
+    double rate;
+    // Largest move of a probability in one random walk step
+    double step;
+
+    Drift(DriftMode m = DRIFT_NONE, int a = 1, int p = 1, double r = 0.001, double s = 0.01)
+    :mode(m), arms(a), period(p), rate(r), step(s) {}
+};
+
+/**
+ * Changes of the arms of one non-stationary environment (see Drift), for any storage of its thresholds:
+ * the rounds left before the next change, the stream the changes are drawn from and a ThresholdTree that
+ * keeps the best arm current in O(log n) per changed arm. The thresholds are passed to every call, so
+ * Environment, FixedEnvironment and BatchEnvironment share it
+ **/
+class ArmDrift {
+    private:
+        // Settings, their own stream and the rounds left before the next change
+        Drift drift;
+        Rng rng;
+        int rounds_to_change;
+        // Best arm of every subtree, kept current while the arms change
+        ThresholdTree tree;
+
+        /**
+         * Returns the number of rounds until the next change, drawn from the drift stream for change points
+         **/
+        int next_change();
+
+        /**
+         * Returns the threshold an arm with threshold t changes to, drawn from the drift stream
+         **/
+        uint64_t changed_threshold(uint64_t t);
+
+    public:
+        /**
+         * Constructor of a stationary environment's drift
+         **/
+        ArmDrift(const Drift &d = Drift());
+
+        /**
+         * Sets how the arms change, from the next start on
+         **/
+        void set(const Drift &d);
+
+        /**
+         * Returns true when the arms change while the environment is played
+         **/
+        bool is_drifting(){ return drift.mode != DRIFT_NONE; }
+
+        /**
+         * Starts the changes of n new arms whose environment was drawn from r (the changes come from
+         * r.fork(ENV_DRIFT_STREAM)) and returns the best arm
+         **/
+        int start(const uint64_t *thresholds, int n, Rng r);
+
+        /**
+         * Counts a round, returns true when the arms have to change now (see change)
+         **/
+        bool next_round(){ return drift.mode != DRIFT_NONE && --rounds_to_change == 0; }
+
+        /**
+         * Changes the n arms as set by the drift and returns the best arm
+         **/
+        int change(uint64_t *thresholds, int n);
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "ArmProbTree.hpp"
+
+// Smallest scale before the transform is folded back into the raw values
+#define MIN_SCALE 1e-150
+
+/**
+ * Constructor that takes the number of arms, every arm starts at probability 1/n
+ **/
+ArmProbTree::ArmProbTree(int n) { reset(n); }
+
+/**
+ * Resets every arm to probability 1/n
+ **/
+void ArmProbTree::reset(int n){
+    num_of_arms = n;
+    scale = 1.0;
+    offset = 0.0;
+    normalized = true;
+    raw.assign(num_of_arms, 1.0/n);
+    tree.assign(num_of_arms + 1, 0.0);
+    rebuild(false);
+}
+
+/**
+ * Sets the n arms to the given weights, which keep their sum instead of being renormalized
+ **/
+void ArmProbTree::assign(const double *values, int n){
+    num_of_arms = n;
+    scale = 1.0;
+    offset = 0.0;
+    normalized = false;
+    raw.assign(values, values + n);
+    tree.assign(num_of_arms + 1, 0.0);
+    rebuild(false);
+}
+
+/**
+ * Returns the sum of the values of every arm
+ **/
+double ArmProbTree::total(){
+    double sum = 0.0;
+    for (int i = num_of_arms; i > 0; i -= i & -i)
+        sum += tree[i];
+    return scale * sum + offset * num_of_arms;
+}
+
+/**
+ * Folds the transform into the raw values, optionally renormalizes them and rebuilds the tree
+ **/
+void ArmProbTree::rebuild(bool normalize){
+    double total = 0.0;
+    for (int i = 0; i < num_of_arms; i++) {
+        raw[i] = scale * raw[i] + offset;
+        if (raw[i] < 0)
+            raw[i] = 0;
+        total += raw[i];
+    }
+    if (normalize && total > 0)
+        for (int i = 0; i < num_of_arms; i++)
+            raw[i] /= total;
+    scale = 1.0;
+    offset = 0.0;
+    updates = 0;
+
+    // Linear time construction, every node pushes its sum to its parent
+    for (int i = 1; i <= num_of_arms; i++)
+        tree[i] = raw[i - 1];
+    for (int i = 1; i <= num_of_arms; i++) {
+        int parent = i + (i & -i);
+        if (parent <= num_of_arms)
+            tree[parent] += tree[i];
+    }
+}
+
+/**
+ * Returns the probability of an arm
+ **/
+double ArmProbTree::get(int arm){ return scale * raw[arm] + offset; }
+
+/**
+ * Maps the probability of every arm p to factor * p + shift
+ **/
+void ArmProbTree::transform_all(double factor, double shift){
+    scale *= factor;
+    offset = factor * offset + shift;
+
+    // The update of the chosen arm may still be missing, so the sum is not renormalized here
+    if (scale < MIN_SCALE)
+        rebuild(false);
+}
+
+/**
+ * Adds delta to the probability of one arm
+ **/
+void ArmProbTree::add(int arm, double delta){
+    double raw_delta = delta / scale;
+    raw[arm] += raw_delta;
+    for (int i = arm + 1; i <= num_of_arms; i += i & -i)
+        tree[i] += raw_delta;
+
+    // Rounding errors of the tree and the transform are cleared every n updates, O(1) amortized
+    if (++updates >= num_of_arms)
+        rebuild(normalized);
+}
+
+/**
+ * Returns the first arm whose cumulative probability reaches num, or -1 when the total is below num
+ **/
+int ArmProbTree::sample(double num){
+    int step = 1;
+    while (step * 2 <= num_of_arms)
+        step *= 2;
+
+    // Largest prefix (pos arms) whose cumulative probability scale * sum + offset * pos stays below num
+    int pos = 0;
+    double sum = 0.0;
+    for (; step > 0; step /= 2) {
+        int next = pos + step;
+        if (next <= num_of_arms && scale * (sum + tree[next]) + offset * next < num) {
+            pos = next;
+            sum += tree[next];
+        }
+    }
+    return (pos < num_of_arms) ? pos : -1;
+}
@@ -0,0 +1,76 @@
+#ifndef ARMPROBTREE_CLASS
+#define ARMPROBTREE_CLASS
+
+#include <vector>
+
+/**
+ * Probability vector over the arms stored as raw values under a shared affine transform:
+ * prob[i] = scale * raw[i] + offset. Rescaling every arm (the L(r-p)/L(r-i) update of the arms that
+ * were not chosen) only changes scale and offset, a single arm is changed in the raw values, and a
+ * Fenwick tree over the raw values samples an arm in O(log n). The raw values are folded back into
+ * plain probabilities (and renormalized to sum to 1) every n updates or when the scale gets too small.
+ * Values set with assign are weights of any sum and are folded back without renormalizing
+ **/
+class ArmProbTree {
+    private:
+        // Number of arms
+        int num_of_arms;
+        // Shared transform applied to every raw value
+        double scale, offset;
+        // Raw value of every arm
+        std::vector<double> raw;
+        // Fenwick tree over the raw values (1 based)
+        std::vector<double> tree;
+        // Updates since the last rebuild
+        int updates;
+        // Are the values probabilities renormalized to sum to 1?
+        bool normalized;
+
+        /**
+         * Folds the transform into the raw values, optionally renormalizes them and rebuilds the tree
+         **/
+        void rebuild(bool normalize);
+
+    public:
+        /**
+         * Constructor that takes the number of arms, every arm starts at probability 1/n
+         **/
+        ArmProbTree(int n = 0);
+
+        /**
+         * Resets every arm to probability 1/n
+         **/
+        void reset(int n);
+
+        /**
+         * Sets the n arms to the given weights, which keep their sum instead of being renormalized
+         **/
+        void assign(const double *values, int n);
+
+        /**
+         * Returns the sum of the values of every arm
+         **/
+        double total();
+
+        /**
+         * Returns the probability of an arm
+         **/
+        double get(int arm);
+
+        /**
+         * Maps the probability of every arm p to factor * p + shift
+         **/
+        void transform_all(double factor, double shift);
+
+        /**
+         * Adds delta to the probability of one arm
+         **/
+        void add(int arm, double delta);
+
+        /**
+         * Returns the first arm whose cumulative probability reaches num, or -1 when the total is below num
+         **/
+        int sample(double num);
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef BATCHAGENT_CLASS
+#define BATCHAGENT_CLASS
+
+#include <vector>
+#include "BatchEnvironment.hpp"
+#include "Profiler.hpp"
+
+/**
+ * Agents of one kind playing every environment of a BatchEnvironment in lockstep: a round chooses an arm in
+ * every environment, pulls all of them with one BatchEnvironment::pull and then every agent learns from its
+ * reward, so the calls into the environment are shared by the whole batch.
+ *
+ * The agents are AgentType instances playing the lanes of the batch (BatchUCBAgent, BatchLRAgent or any
+ * Agent on a BatchLane), so they keep their own bookkeeping, policies, streams and reward tapes and every one
+ * picks exactly the arms it would pick playing its environment on its own. Rounds are always played one by
+ * one (an LRAgent does not fast forward in a batch)
+ **/
+template <class AgentType>
+class BatchAgent {
+    private:
+        // Agent of every environment and the batch they play
+        std::vector<AgentType> agents;
+        BatchEnvironment *batch;
+        // Arm chosen in every environment, arm pulled (-1 when there is none or the reward came from a tape),
+        // the rewards and the reward stream of every agent
+        std::vector<int> choices, pulled, rewards;
+        std::vector<Rng *> streams;
+
+    public:
+        /**
+         * Constructor that takes the agent copied into every environment and the largest number of environments
+         **/
+        BatchAgent(const AgentType &prototype, int size)
+        :agents(size, prototype)
+        ,batch(nullptr) {}
+
+        /**
+         * Returns the agent of environment e
+         **/
+        AgentType &get_agent(int e){ return agents[e]; }
+
+        /**
+         * Plays the environments of b from now on, once the agent of every environment e took b.lane(e) with
+         * change_parameters
+         **/
+        void start(BatchEnvironment &b){
+            batch = &b;
+            int n = b.get_num_of_envs();
+            choices.resize(n);
+            pulled.resize(n);
+            rewards.resize(n);
+            streams.resize(n);
+            for (int e = 0; e < n; e++)
+                streams[e] = &agents[e].get_reward_rng();
+        }
+
+        /**
+         * Executes a single round in every environment of the batch
+         **/
+        void exec_round(){
+            int n = batch->get_num_of_envs();
+
+            // Choose an arm in every environment
+            PROFILE_BEGIN(PHASE_SELECT);
+            for (int e = 0; e < n; e++)
+                choices[e] = agents[e].choose_arm();
+            PROFILE_END(PHASE_SELECT);
+
+            // Pull the arms whose reward is not on a tape, in one call
+            PROFILE_BEGIN(PHASE_PULL);
+            for (int e = 0; e < n; e++) {
+                pulled[e] = -1;
+                if (choices[e] != -1 && (rewards[e] = agents[e].begin_round(choices[e])) < 0)
+                    pulled[e] = choices[e];
+            }
+            batch->pull(pulled.data(), streams.data(), rewards.data());
+            PROFILE_END(PHASE_PULL);
+
+            for (int e = 0; e < n; e++)
+                if (choices[e] != -1)
+                    agents[e].end_round(choices[e], rewards[e]);
+        }
+
+        /**
+         * Plays count rounds in every environment of the batch
+         **/
+        void run_rounds(int count){
+            for (int i = 0; i < count; i++)
+                exec_round();
+        }
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "BatchEnvironment.hpp"
+#include "ThresholdKernel.hpp"
+#include "Arm.hpp"
+#include <iomanip>
+#define NUM_SPACE std::setw(5) // Formatting support for printing an array
+
+/**
+ * Constructor that takes the number of environments and of arms, drawn from the default streams
+ **/
+BatchEnvironment::BatchEnvironment(int envs, int n){
+    std::vector<Rng> rngs(envs);
+    regenerate(envs, n, rngs.data());
+}
+
+/**
+ * Draws envs new environments of n arms in place, environment e from rngs[e]. Nothing is allocated once
+ * the batch held as many arms
+ **/
+void BatchEnvironment::regenerate(int envs, int n, const Rng *rngs){
+    num_of_envs = envs;
+    num_of_arms = n;
+    thresholds.resize((size_t)envs * n);
+    optm_arms.resize(envs);
+    drifts.resize(envs);
+    lanes.resize(envs);
+
+    for (int e = 0; e < envs; e++) {
+        // Same draws as Environment::regenerate with the stream of the environment
+        uint64_t *env_thresholds = &thresholds[(size_t)e * n];
+        Rng r = rngs[e];
+        for (int i = 0; i < n; i++)
+            env_thresholds[i] = Arm::random_threshold(r.next_u64());
+
+        drifts[e].set(drift);
+        optm_arms[e] = is_drifting() ? drifts[e].start(env_thresholds, n, rngs[e]) : threshold_argmax(env_thresholds, n);
+        lanes[e].batch = this;
+        lanes[e].env = e;
+    }
+}
+
+/**
+ * Makes the environments non-stationary as set by d, from the next regenerate on (see Environment::set_drift)
+ **/
+void BatchEnvironment::set_drift(const Drift &d){ drift = d; }
+
+/**
+ * Plays a round of every environment: pulls arm choices[e] of environment e with the stream *streams[e]
+ * and writes the reward to rewards[e], the same reward as pull_chosen_arm. A choice of -1 pulls nothing
+ * and leaves its reward as it is
+ **/
+void BatchEnvironment::pull(const int *choices, Rng *const *streams, int *rewards){
+    const uint64_t *env_thresholds = thresholds.data();
+    for (int e = 0; e < num_of_envs; e++, env_thresholds += num_of_arms)
+        if (choices[e] >= 0)
+            rewards[e] = streams[e]->next_bernoulli(env_thresholds[choices[e]]);
+}
+
+/**
+ * Copies the arm probabilities of environment e to out
+ **/
+void BatchEnvironment::get_arm_probs(int e, double *out){
+    for (int i = 0; i < num_of_arms; i++)
+        out[i] = Arm::threshold_prob(thresholds[(size_t)e * num_of_arms + i]);
+}
+
+/**
+ * Prints the arm probabilities of environment e
+ **/
+void BatchEnvironment::print_arm_probs(int e, std::ostream &file){
+    file << "Arm Success Probs: \t\t";
+    for (int i = 0; i < num_of_arms; i++)
+        file << Arm::threshold_prob(thresholds[(size_t)e * num_of_arms + i]) << " " << NUM_SPACE;
+    file << std::endl;
+}
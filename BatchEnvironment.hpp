@@ -0,0 +1,176 @@
+#ifndef BATCHENVIRONMENT_CLASS
+#define BATCHENVIRONMENT_CLASS
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include "Rng.hpp"
+#include "ArmDrift.hpp"
+
+class BatchEnvironment;
+
+/**
+ * One environment of a BatchEnvironment seen as an environment of its own, what the agents of a BatchAgent
+ * play (see Agent). The lanes belong to their batch, which points them at itself on every regenerate
+ **/
+class BatchLane {
+    friend class BatchEnvironment;
+
+    private:
+        // Batch the environment belongs to and its index in it
+        BatchEnvironment *batch;
+        int env;
+
+    public:
+        /**
+         * Constructor of a lane that belongs to no batch yet
+         **/
+        BatchLane()
+        :batch(nullptr)
+        ,env(0) {}
+
+        /**
+         * Returns the number of arms
+         **/
+        int get_arms_size();
+
+        /**
+         * Returns 1 if the choice is optimal (greatest probability), otherwise 0
+         **/
+        int is_optimal(int choice);
+
+        /**
+         * Pull the chosen arm with the given reward stream and return reward
+         **/
+        int pull_chosen_arm(int choice, Rng &r);
+
+        /**
+         * Moves a non-stationary environment on by one round, called once the arm of a round is pulled
+         **/
+        void next_round();
+
+        /**
+         * Returns true when the arms change while the environment is played
+         **/
+        bool is_drifting();
+
+        /**
+         * Prints the arm probabilities of producing reward
+         **/
+        void print_arm_probs(std::ostream &file = std::cout);
+
+        /**
+         * Copies the arm probabilities of producing reward to out
+         **/
+        void get_arm_probs(double *out);
+};
+
+/**
+ * Environments with the same number of arms stored as a structure of arrays: the reward thresholds of
+ * environment e are thresholds[e * n, (e + 1) * n), so one call of pull plays a round of every environment
+ * in one loop over contiguous memory. Environment e is drawn from its own stream exactly like Environment(n, r)
+ * draws it, and with a drift it changes exactly like that Environment would (see ArmDrift)
+ **/
+class BatchEnvironment {
+    private:
+        // Number of environments and arms of each of them
+        int num_of_envs, num_of_arms;
+        // Reward threshold of every arm of every environment and the best arm of every environment
+        std::vector<uint64_t> thresholds;
+        std::vector<int> optm_arms;
+        // Changes of every environment when they are non-stationary
+        Drift drift;
+        std::vector<ArmDrift> drifts;
+        // Every environment seen on its own
+        std::vector<BatchLane> lanes;
+
+    public:
+        /**
+         * Constructor that takes the number of environments and of arms, drawn from the default streams
+         **/
+        BatchEnvironment(int envs = 1, int n = 10);
+
+        /**
+         * Draws envs new environments of n arms in place, environment e from rngs[e]. Nothing is allocated once
+         * the batch held as many arms
+         **/
+        void regenerate(int envs, int n, const Rng *rngs);
+
+        /**
+         * Makes the environments non-stationary as set by d, from the next regenerate on (see Environment::set_drift)
+         **/
+        void set_drift(const Drift &d);
+
+        /**
+         * Returns the number of environments
+         **/
+        int get_num_of_envs(){ return num_of_envs; }
+
+        /**
+         * Returns the number of arms of every environment
+         **/
+        int get_arms_size(){ return num_of_arms; }
+
+        /**
+         * Returns environment e seen on its own, valid until the next regenerate
+         **/
+        BatchLane &lane(int e){ return lanes[e]; }
+
+        /**
+         * Returns 1 if the choice is the optimal arm of environment e, otherwise 0
+         **/
+        int is_optimal(int e, int choice){ return (optm_arms[e] == choice) ? 1 : 0; }
+
+        /**
+         * Pulls the chosen arm of environment e with the given reward stream and returns the reward
+         **/
+        int pull_chosen_arm(int e, int choice, Rng &r){
+            return r.next_bernoulli(thresholds[(size_t)e * num_of_arms + choice]);
+        }
+
+        /**
+         * Plays a round of every environment: pulls arm choices[e] of environment e with the stream *streams[e]
+         * and writes the reward to rewards[e], the same reward as pull_chosen_arm. A choice of -1 pulls nothing
+         * and leaves its reward as it is
+         **/
+        void pull(const int *choices, Rng *const *streams, int *rewards);
+
+        /**
+         * Moves non-stationary environment e on by one round, called once its arm of a round is pulled
+         **/
+        void next_round(int e){
+            if (drifts[e].next_round())
+                optm_arms[e] = drifts[e].change(&thresholds[(size_t)e * num_of_arms], num_of_arms);
+        }
+
+        /**
+         * Returns true when the arms change while the environments are played
+         **/
+        bool is_drifting(){ return drift.mode != DRIFT_NONE; }
+
+        /**
+         * Copies the arm probabilities of environment e to out
+         **/
+        void get_arm_probs(int e, double *out);
+
+        /**
+         * Prints the arm probabilities of environment e
+         **/
+        void print_arm_probs(int e, std::ostream &file = std::cout);
+};
+
+inline int BatchLane::get_arms_size(){ return batch->get_arms_size(); }
+
+inline int BatchLane::is_optimal(int choice){ return batch->is_optimal(env, choice); }
+
+inline int BatchLane::pull_chosen_arm(int choice, Rng &r){ return batch->pull_chosen_arm(env, choice, r); }
+
+inline void BatchLane::next_round(){ batch->next_round(env); }
+
+inline bool BatchLane::is_drifting(){ return batch->is_drifting(); }
+
+inline void BatchLane::print_arm_probs(std::ostream &file){ batch->print_arm_probs(env, file); }
+
+inline void BatchLane::get_arm_probs(double *out){ batch->get_arm_probs(env, out); }
+
+#endif
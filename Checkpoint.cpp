@@ -0,0 +1,264 @@
+#include "Checkpoint.hpp"
+#include "LearningCurves.hpp"
+#include <iostream>
+#include <fstream>
+#include <unistd.h>
+
+/**
+ * Constructor that takes the log file name, the seconds between saves (negative turns checkpoints off),
+ * the description of the sweep, its number of configurations, environments and result arrays. It
+ * looks for a checkpoint of the same sweep on disk
+ **/
+Checkpoint::Checkpoint(const std::string &file_name, double secs, const std::string &sweep, int configs, int envs,
+                       int columns)
+:file_name(file_name)
+,state_file_name(file_name + ".state")
+,sweep(sweep)
+,interval(secs)
+,num_of_configs(configs)
+,num_of_envs(envs)
+,num_of_columns(columns)
+,found_seed(0)
+,found_records(0)
+,num_of_records(0)
+,log(nullptr)
+,done(configs * envs, false) {
+    if (interval < 0)
+        return;
+
+    // The log header has to describe this sweep
+    FILE *file = fopen(file_name.c_str(), "rb");
+    if (file == nullptr)
+        return;
+    uint32_t magic = 0, length = 0;
+    uint64_t seed = 0;
+    int32_t header[3] = {0, 0, 0};
+    bool same = fread(&magic, sizeof(magic), 1, file) == 1 && magic == CHECKPOINT_MAGIC &&
+                fread(&length, sizeof(length), 1, file) == 1 && length == sweep.size();
+    std::string file_sweep(length, ' ');
+    same = same && (length == 0 || fread(&file_sweep[0], 1, length, file) == length) && file_sweep == sweep &&
+           fread(&seed, sizeof(seed), 1, file) == 1 && fread(header, sizeof(header), 1, file) == 1 &&
+           header[0] == configs && header[1] == envs && header[2] == columns;
+    fseek(file, 0, SEEK_END);
+    long log_size = ftell(file);
+    fclose(file);
+    if (!same) {
+        std::cout << "Checkpoint " << file_name << " belongs to another sweep, starting from scratch" << std::endl;
+        return;
+    }
+
+    // The state tells how many records of the log are covered
+    FILE *state = fopen(state_file_name.c_str(), "rb");
+    uint64_t records = 0;
+    if (state == nullptr || fread(&magic, sizeof(magic), 1, state) != 1 || magic != CHECKPOINT_MAGIC ||
+        fread(&records, sizeof(records), 1, state) != 1)
+        records = 0;
+    if (state != nullptr)
+        fclose(state);
+
+    long record_size = 2 * sizeof(int32_t) + num_of_columns * sizeof(double);
+    if (records > 0 && log_size >= header_size() + (long)records * record_size) {
+        found_seed = seed;
+        found_records = records;
+    }
+}
+
+/**
+ * Closes the log
+ **/
+Checkpoint::~Checkpoint(){
+    if (log != nullptr)
+        fclose(log);
+}
+
+/**
+ * Returns the size in bytes of the log header
+ **/
+long Checkpoint::header_size(){
+    return sizeof(uint32_t) * 2 + sweep.size() + sizeof(uint64_t) + sizeof(int32_t) * 3;
+}
+
+/**
+ * Returns the number of environments a checkpoint on disk holds (0 when there is none)
+ **/
+uint64_t Checkpoint::get_num_of_found(){
+    return found_records;
+}
+
+/**
+ * Returns the seed to run with: the one of the checkpoint found when the configured one is 0 or the
+ * same, otherwise the configured one (the checkpoint is then dropped)
+ **/
+unsigned long Checkpoint::get_seed(unsigned long configured){
+    if (found_records == 0)
+        return configured;
+    if (configured == 0 || configured == found_seed)
+        return found_seed;
+
+    std::cout << "Checkpoint " << file_name << " has seed " << found_seed << ", starting from scratch" << std::endl;
+    found_records = 0;
+    return configured;
+}
+
+/**
+ * Reads the results and the learning curves (when given) of the checkpoint found, and starts the log
+ * of this run with the given seed. Returns the number of environments restored
+ **/
+uint64_t Checkpoint::restore(unsigned long seed, const std::vector<std::vector<double> *> &results,
+                             LearningCurves *curves){
+    if (interval < 0)
+        return 0;
+
+    if (found_records > 0 && seed == found_seed) {
+        log = fopen(file_name.c_str(), "r+b");
+        if (log == nullptr) {
+            std::cerr << "Cannot write " << file_name << std::endl;
+            return 0;
+        }
+        num_of_records = read_records(results);
+
+        // The learning curves cover every record of the state, they do not fit when some were dropped
+        bool fits = true;
+        if (curves != nullptr) {
+            std::ifstream state(state_file_name, std::ifstream::binary);
+            state.seekg(sizeof(uint32_t) + sizeof(uint64_t));
+            fits = num_of_records == found_records && curves->load(state);
+        }
+        if (!fits) {
+            std::cout << "Checkpoint " << state_file_name << " is damaged, starting from scratch" << std::endl;
+            fclose(log);
+            log = nullptr;
+            found_records = num_of_records = 0;
+            done.assign(done.size(), false);
+        }
+    }
+
+    if (log != nullptr) {
+        // Records past the ones read were saved by a run interrupted in the middle of a save, or are damaged
+        fflush(log);
+        if (ftruncate(fileno(log), header_size() + num_of_records * (2 * sizeof(int32_t) +
+                                                                   num_of_columns * sizeof(double))) != 0)
+            return 0;
+        fseek(log, 0, SEEK_END);
+    } else {
+        log = fopen(file_name.c_str(), "wb");
+        if (log == nullptr) {
+            std::cerr << "Cannot write " << file_name << std::endl;
+            return 0;
+        }
+        uint32_t magic = CHECKPOINT_MAGIC, length = sweep.size();
+        uint64_t log_seed = seed;
+        int32_t header[3] = {num_of_configs, num_of_envs, num_of_columns};
+        fwrite(&magic, sizeof(magic), 1, log);
+        fwrite(&length, sizeof(length), 1, log);
+        fwrite(sweep.data(), 1, length, log);
+        fwrite(&log_seed, sizeof(log_seed), 1, log);
+        fwrite(header, sizeof(header), 1, log);
+        fflush(log);
+        write_state(curves);
+    }
+
+    last_save = std::chrono::steady_clock::now();
+    return num_of_records;
+}
+
+/**
+ * Reads the records the state covers from the log into the results, up to the first one that is cut
+ * short or names an environment outside the sweep, and returns how many were read
+ **/
+uint64_t Checkpoint::read_records(const std::vector<std::vector<double> *> &results){
+    fseek(log, header_size(), SEEK_SET);
+    std::vector<double> values(num_of_columns);
+    uint64_t records = 0;
+    for (; records < found_records; records++) {
+        int32_t key[2];
+        if (fread(key, sizeof(key), 1, log) != 1 ||
+            fread(values.data(), sizeof(double), num_of_columns, log) != (size_t)num_of_columns)
+            break;
+        if (key[0] < 0 || key[0] >= num_of_configs || key[1] < 0 || key[1] >= num_of_envs) {
+            std::cout << "Checkpoint " << file_name << " holds an environment outside the sweep at record "
+                      << records << ", dropping the records from there on" << std::endl;
+            break;
+        }
+        for (int column = 0; column < num_of_columns; column++)
+            (*results[column])[key[0] * num_of_envs + key[1]] = values[column];
+        done[key[0] * num_of_envs + key[1]] = true;
+    }
+    return records;
+}
+
+/**
+ * Returns true when an environment finished, in this run or the one resumed
+ **/
+bool Checkpoint::is_done(int config, int env){
+    return done[config * num_of_envs + env];
+}
+
+/**
+ * Marks an environment as finished, it is saved with the next save
+ **/
+void Checkpoint::add(int config, int env){
+    if (log == nullptr || done[config * num_of_envs + env])
+        return;
+    done[config * num_of_envs + env] = true;
+    unsaved.push_back(config * num_of_envs + env);
+}
+
+/**
+ * Saves the environments finished since the last save when interval seconds passed (always when
+ * forced). No job may run meanwhile, so the curves match the saved environments
+ **/
+bool Checkpoint::save(const std::vector<std::vector<double> *> &results, LearningCurves *curves, bool force){
+    if (log == nullptr)
+        return true;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - last_save;
+    if (!force && elapsed.count() < interval)
+        return true;
+
+    // Append the new records and make sure they are on disk before the state covers them
+    std::vector<double> values(num_of_columns);
+    for (size_t i = 0; i < unsaved.size(); i++) {
+        int32_t key[2] = {unsaved[i] / num_of_envs, unsaved[i] % num_of_envs};
+        for (int column = 0; column < num_of_columns; column++)
+            values[column] = (*results[column])[unsaved[i]];
+        fwrite(key, sizeof(key), 1, log);
+        fwrite(values.data(), sizeof(double), num_of_columns, log);
+    }
+    if (fflush(log) != 0 || fsync(fileno(log)) != 0)
+        return false;
+    num_of_records += unsaved.size();
+    unsaved.clear();
+
+    last_save = std::chrono::steady_clock::now();
+    return write_state(curves);
+}
+
+/**
+ * Writes the state file (records covered and the learning curves) through a temporary file
+ **/
+bool Checkpoint::write_state(LearningCurves *curves){
+    std::string temp_name = state_file_name + ".tmp";
+    {
+        std::ofstream state(temp_name, std::ofstream::binary | std::ofstream::trunc);
+        uint32_t magic = CHECKPOINT_MAGIC;
+        state.write((const char *)&magic, sizeof(magic));
+        state.write((const char *)&num_of_records, sizeof(num_of_records));
+        if (curves != nullptr)
+            curves->save(state);
+        if (!state.good())
+            return false;
+    }
+    return rename(temp_name.c_str(), state_file_name.c_str()) == 0;
+}
+
+/**
+ * Deletes the checkpoint files once the sweep is complete
+ **/
+void Checkpoint::remove(){
+    if (log == nullptr)
+        return;
+    fclose(log);
+    log = nullptr;
+    unlink(file_name.c_str());
+    unlink(state_file_name.c_str());
+}
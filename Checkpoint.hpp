@@ -0,0 +1,115 @@
+#ifndef CHECKPOINT_CLASS
+#define CHECKPOINT_CLASS
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+
+#define CHECKPOINT_MAGIC 0x504b4342 // "BCKP", first word of both checkpoint files
+#define CHECKPOINT_CHUNK_JOBS 8 // Jobs per thread run between two chances to save a checkpoint
+
+class LearningCurves;
+
+/**
+ * Progress of a sweep saved while it runs, so that an interrupted run resumes where it stopped. The results of
+ * every finished environment (one value per result array, e.g. % optimal arm and % reward of every agent) are
+ * appended to a binary log (file_name), and the state of the learning curves is rewritten next to it
+ * (file_name.state) with the number of log records it covers. A save only writes the environments finished
+ * since the last one, at most once every interval seconds.
+ *
+ * Every environment is keyed by (seed, config, env), so an environment that did not finish is simply run again
+ * and the resumed run gives the same stats and curves as an uninterrupted one. The checkpoint belongs to a
+ * sweep description (every setting that changes the results): another sweep starts from scratch
+ **/
+class Checkpoint {
+    private:
+        // Log and state file names, and the description of the sweep
+        std::string file_name, state_file_name, sweep;
+        // Seconds between two saves, negative when checkpoints are off
+        double interval;
+        // Number of configurations, environments per configuration and result arrays
+        int num_of_configs, num_of_envs, num_of_columns;
+        // Seed of the checkpoint found on disk (0 for none) and records of it covered by its state
+        unsigned long found_seed;
+        uint64_t found_records;
+        // Records saved in the log, open for appending (nullptr before the first save)
+        uint64_t num_of_records;
+        FILE *log;
+        // Finished environments, index = config * num_of_envs + env, and the ones not saved yet
+        std::vector<bool> done;
+        std::vector<int> unsaved;
+        std::chrono::steady_clock::time_point last_save;
+
+        /**
+         * Returns the size in bytes of the log header
+         **/
+        long header_size();
+
+        /**
+         * Writes the state file (records covered and the learning curves) through a temporary file
+         **/
+        bool write_state(LearningCurves *curves);
+
+        /**
+         * Reads the records the state covers from the log into the results, up to the first one that is cut
+         * short or names an environment outside the sweep, and returns how many were read
+         **/
+        uint64_t read_records(const std::vector<std::vector<double> *> &results);
+
+    public:
+        /**
+         * Constructor that takes the log file name, the seconds between saves (negative turns checkpoints off),
+         * the description of the sweep, its number of configurations, environments and result arrays. It
+         * looks for a checkpoint of the same sweep on disk
+         **/
+        Checkpoint(const std::string &file_name, double secs, const std::string &sweep, int configs, int envs,
+                   int columns);
+
+        /**
+         * Closes the log
+         **/
+        ~Checkpoint();
+
+        /**
+         * Returns the number of environments a checkpoint on disk holds (0 when there is none)
+         **/
+        uint64_t get_num_of_found();
+
+        /**
+         * Returns the seed to run with: the one of the checkpoint found when the configured one is 0 or the
+         * same, otherwise the configured one (the checkpoint is then dropped)
+         **/
+        unsigned long get_seed(unsigned long configured);
+
+        /**
+         * Reads the results and the learning curves (when given) of the checkpoint found, and starts the log
+         * of this run with the given seed. Returns the number of environments restored
+         **/
+        uint64_t restore(unsigned long seed, const std::vector<std::vector<double> *> &results,
+                         LearningCurves *curves);
+
+        /**
+         * Returns true when an environment finished, in this run or the one resumed
+         **/
+        bool is_done(int config, int env);
+
+        /**
+         * Marks an environment as finished, it is saved with the next save
+         **/
+        void add(int config, int env);
+
+        /**
+         * Saves the environments finished since the last save when interval seconds passed (always when
+         * forced). No job may run meanwhile, so the curves match the saved environments
+         **/
+        bool save(const std::vector<std::vector<double> *> &results, LearningCurves *curves, bool force);
+
+        /**
+         * Deletes the checkpoint files once the sweep is complete
+         **/
+        void remove();
+};
+
+#endif
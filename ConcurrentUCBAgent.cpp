@@ -0,0 +1,161 @@
+#include "ConcurrentUCBAgent.hpp"
+#include "UCBAgent.hpp"
+#include <cmath>
+#include <climits>
+#include <algorithm>
+// Bits of a counter holding the rewards, the pulls are above them
+#define COUNTER_REWARD_BITS 32
+
+/**
+ * Constructor of a view that reads every arm on its first decision
+ **/
+ConcurrentUCBView::ConcurrentUCBView()
+:use_index(false)
+,counted(0)
+,rounds(0)
+,next_arm(0)
+,decisions(0) {}
+
+/**
+ * Constructor that takes the number of arms, the confidence value c, the number of counter shards and
+ * the decisions in which a view reads every arm again
+ **/
+ConcurrentUCBAgent::ConcurrentUCBAgent(int n, double conf, int shards, int refresh)
+:num_of_arms(n)
+,num_of_shards(shards > 0 ? shards : 1)
+,stride((n + 7) / 8 * 8)
+,c(conf)
+,refresh_every(refresh > 0 ? refresh : 1)
+,refresh_slice((n + refresh_every - 1) / refresh_every)
+,counters((size_t)num_of_shards * stride) {
+    reset();
+}
+
+/**
+ * Sets every counter back to 0, only while no other thread uses the agent
+ **/
+void ConcurrentUCBAgent::reset(){
+    for (auto &counter : counters)
+        counter.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Sums the shards of an arm into its sample mean and number of pulls
+ **/
+void ConcurrentUCBAgent::read_arm(int arm, double &arm_est, int &arm_pulled){
+    uint64_t pulls = 0, rewards = 0;
+    for (int shard = 0; shard < num_of_shards; shard++) {
+        uint64_t counter = counters[(size_t)shard * stride + arm].load(std::memory_order_relaxed);
+        pulls += counter >> COUNTER_REWARD_BITS;
+        rewards += counter & ((1ULL << COUNTER_REWARD_BITS) - 1);
+    }
+    arm_est = (pulls > 0) ? (double)rewards / pulls : CONCURRENT_UCB_INITIAL_EST;
+    arm_pulled = (pulls < INT_MAX) ? (int)pulls : INT_MAX;
+}
+
+/**
+ * Reads every arm into a view that has not decided yet
+ **/
+void ConcurrentUCBAgent::refresh_all(ConcurrentUCBView &view){
+    view.est.resize(num_of_arms);
+    view.pulled.resize(num_of_arms);
+    view.counted = 0;
+    for (int arm = 0; arm < num_of_arms; arm++) {
+        read_arm(arm, view.est[arm], view.pulled[arm]);
+        view.counted += view.pulled[arm];
+    }
+    view.rounds = view.counted;
+    view.next_arm = 0;
+
+    // The index is built from the counters in O(n)
+    view.use_index = num_of_arms >= UCB_INDEX_MIN_ARMS;
+    if (view.use_index) {
+        view.index.reset(num_of_arms, c, CONCURRENT_UCB_INITIAL_EST);
+        view.index.assign(view.est.data(), view.pulled.data(), log(view.rounds + 1));
+    }
+}
+
+/**
+ * Reads the next arms of a view, the index only recomputes the ones that changed
+ **/
+void ConcurrentUCBAgent::refresh_next(ConcurrentUCBView &view){
+    for (int i = 0; i < refresh_slice; i++) {
+        int arm = view.next_arm;
+        if (++view.next_arm == num_of_arms)
+            view.next_arm = 0;
+
+        double arm_est;
+        int arm_pulled;
+        read_arm(arm, arm_est, arm_pulled);
+        if (arm_est == view.est[arm] && arm_pulled == view.pulled[arm])
+            continue;
+
+        // The decisions of the view counted on this arm are replaced by the feedback counted so far
+        view.counted += arm_pulled - view.pulled[arm];
+        view.est[arm] = arm_est;
+        view.pulled[arm] = arm_pulled;
+        if (view.use_index)
+            view.index.update(arm, arm_est, arm_pulled);
+    }
+}
+
+/**
+ * Returns the first arm with the highest bound in the view, -1 when no bound is above 0, and counts it
+ * as pulled in the view. Safe to call from many threads at once, each with a view of its own
+ **/
+int ConcurrentUCBAgent::choose(ConcurrentUCBView &view){
+    if (view.est.size() != (size_t)num_of_arms)
+        refresh_all(view);
+    else
+        refresh_next(view);
+
+    // Pending pulls dropped by the refresh can lower the sum, t never goes back
+    view.rounds = std::max(view.rounds, view.counted);
+    double log_iter = log(view.rounds + 1);
+    int arm = view.use_index ? view.index.argmax(log_iter)
+                             : ucb_argmax(view.est.data(), view.pulled.data(), num_of_arms, c, log_iter);
+    if (arm >= 0) {
+        view.pulled[arm]++;
+        view.counted++;
+        if (view.use_index)
+            view.index.update(arm, view.est[arm], view.pulled[arm]);
+    }
+    view.rounds++;
+    view.decisions++;
+    return arm;
+}
+
+/**
+ * Counts n rewards in the counters of a shard (any int, taken modulo the number of shards). Safe to call from
+ * many threads at once, threads that report often should use shards of their own
+ **/
+void ConcurrentUCBAgent::apply_feedback(int shard, const Feedback *batch, int n){
+    // A negative shard would index before the counters, it wraps around like any other
+    int row_shard = shard % num_of_shards;
+    if (row_shard < 0)
+        row_shard += num_of_shards;
+    std::atomic<uint64_t> *row = counters.data() + (size_t)row_shard * stride;
+    for (int i = 0; i < n; i++)
+        row[batch[i].arm].fetch_add((1ULL << COUNTER_REWARD_BITS) | (uint64_t)batch[i].reward,
+                                    std::memory_order_relaxed);
+}
+
+/**
+ * Returns the number of feedbacks counted so far
+ **/
+long ConcurrentUCBAgent::get_rounds(){
+    long total = 0;
+    for (auto &counter : counters)
+        total += counter.load(std::memory_order_relaxed) >> COUNTER_REWARD_BITS;
+    return total;
+}
+
+/**
+ * Returns the rewards counted so far
+ **/
+long ConcurrentUCBAgent::get_points(){
+    long total = 0;
+    for (auto &counter : counters)
+        total += counter.load(std::memory_order_relaxed) & ((1ULL << COUNTER_REWARD_BITS) - 1);
+    return total;
+}
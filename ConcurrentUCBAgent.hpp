@@ -0,0 +1,133 @@
+#ifndef CONCURRENTUCBAGENT_CLASS
+#define CONCURRENTUCBAGENT_CLASS
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "Agent.hpp"
+#include "AlignedAllocator.hpp"
+#include "UCBIndex.hpp"
+#define CONCURRENT_UCB_SHARDS 8 // Counter shards the feedback threads are spread over
+#define CONCURRENT_UCB_REFRESH 64 // Decisions in which a view reads every arm from the shared counters again
+#define CONCURRENT_UCB_INITIAL_EST 0.5 // Estimate of an arm without feedback
+
+
+/**
+ * Private copy of the counters of a ConcurrentUCBAgent held by one request thread. Decisions only read
+ * and write the view, and every decision refreshes a few of its arms from the shared counters. A view
+ * belongs to one agent
+ **/
+class ConcurrentUCBView {
+    friend class ConcurrentUCBAgent;
+
+    private:
+        // Sample mean and number of pulls of every arm as last read, plus the decisions of this view since
+        std::vector<double, AlignedAllocator<double>> est;
+        std::vector<int, AlignedAllocator<int>> pulled;
+        // Incremental index of the bounds, used for large numbers of arms
+        UCBIndex index;
+        bool use_index;
+        // Sum of pulled, and the t - 1 of the bound (never decreasing, unlike the sum)
+        long counted, rounds;
+        // Next arm to refresh and decisions made so far
+        int next_arm;
+        long decisions;
+
+    public:
+        /**
+         * Constructor of a view that reads every arm on its first decision
+         **/
+        ConcurrentUCBView();
+
+        /**
+         * Returns the number of decisions made with this view
+         **/
+        long get_decisions(){ return decisions; }
+};
+
+/**
+ * UCB agent shared by many threads as an in-process decision service: request threads call choose with a
+ * view of their own while feedback threads report rewards with apply_feedback, without any lock.
+ *
+ * Every arm has one 64 bit counter per shard holding pulls << 32 | rewards, so one relaxed atomic add counts
+ * a feedback with its reward and a shard never holds a pull without its reward. A feedback thread adds to
+ * its own shard (shards are separate cache lines), so threads reporting the same arm do not fight over
+ * one counter. A view decides on its own copy with the vector kernel of UCBAgent (or a UCBIndex from
+ * UCB_INDEX_MIN_ARMS arms on), so decisions never write shared memory. Every decision first sums the shards
+ * of the next n / refresh_every arms (round robin) with relaxed loads and only touches the index for the
+ * arms that changed, so no decision pays for a refresh of every arm.
+ *
+ * Consistency is relaxed: a decision sees the feedback of an arm from at most refresh_every decisions ago,
+ * and a view counts its own decisions as pulls until the arm is read again so it does not repeat an arm while
+ * the rewards are pending. The estimates are sample means (rewards / pulls), which unlike the update of UCBAgent do not
+ * depend on the order the feedback arrives in. Rewards are 0 or 1 and a shard counts at most 2^32 - 1 pulls
+ * of an arm
+ **/
+class ConcurrentUCBAgent {
+    private:
+        // Number of arms, counter shards and counters per shard (the arms rounded up to a cache line)
+        int num_of_arms, num_of_shards, stride;
+        // Upper Confidence Value c
+        double c;
+        // Decisions in which a view reads every arm again, and arms read per decision
+        int refresh_every, refresh_slice;
+        // Counter of every arm in every shard, shard s holds arms [s * stride, s * stride + num_of_arms)
+        std::vector<std::atomic<uint64_t>, AlignedAllocator<std::atomic<uint64_t>>> counters;
+
+        /**
+         * Sums the shards of an arm into its sample mean and number of pulls
+         **/
+        void read_arm(int arm, double &arm_est, int &arm_pulled);
+
+        /**
+         * Reads every arm into a view that has not decided yet
+         **/
+        void refresh_all(ConcurrentUCBView &view);
+
+        /**
+         * Reads the next arms of a view, the index only recomputes the ones that changed
+         **/
+        void refresh_next(ConcurrentUCBView &view);
+
+    public:
+        /**
+         * Constructor that takes the number of arms, the confidence value c, the number of counter shards and
+         * the decisions in which a view reads every arm again
+         **/
+        ConcurrentUCBAgent(int n, double conf = 2, int shards = CONCURRENT_UCB_SHARDS,
+                           int refresh = CONCURRENT_UCB_REFRESH);
+
+        /**
+         * Returns the first arm with the highest bound in the view, -1 when no bound is above 0, and counts it
+         * as pulled in the view. Safe to call from many threads at once, each with a view of its own
+         **/
+        int choose(ConcurrentUCBView &view);
+
+        /**
+         * Counts n rewards in the counters of a shard (any int, taken modulo the number of shards). Safe to call from
+         * many threads at once, threads that report often should use shards of their own
+         **/
+        void apply_feedback(int shard, const Feedback *batch, int n);
+
+        /**
+         * Returns the number of feedbacks counted so far
+         **/
+        long get_rounds();
+
+        /**
+         * Returns the rewards counted so far
+         **/
+        long get_points();
+
+        /**
+         * Returns the number of arms
+         **/
+        int get_arms_size(){ return num_of_arms; }
+
+        /**
+         * Sets every counter back to 0, only while no other thread uses the agent
+         **/
+        void reset();
+};
+
+#endif
@@ -0,0 +1,414 @@
+#include "DumpWriter.hpp"
+#include "LearningCurves.hpp"
+#include <cstring>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+/**
+ * Constructor that takes the number of arms, the number of environments per configuration and
+ * the memory used by the ring
+ **/
+DumpWriter::DumpWriter(int n, int envs, size_t bytes)
+:num_of_arms(n)
+,num_of_envs(envs)
+,ring_bytes(bytes)
+,capacity(0)
+,mask(0)
+,enqueue_pos(0)
+,dequeue_pos(0)
+,stopping(false)
+,full_waits(0)
+,wait_ns(0)
+,max_occupancy(0)
+,binary(false)
+,trace(n)
+,curves(nullptr)
+,next_env(0)
+,pending_bytes(0)
+,spill(nullptr)
+,spilled_bytes(0) {}
+
+/**
+ * Closes the file if it is still open
+ **/
+DumpWriter::~DumpWriter(){
+    close();
+    if (spill != nullptr)
+        std::fclose(spill);
+}
+
+/**
+ * Allocates the ring, opens the dump file and starts the writer thread. labels and headings are the
+ * agent labels and the headings of their per-arm values (label i of a snapshot refers to labels[i])
+ **/
+bool DumpWriter::open(const std::string &file_name, bool binary_trace, const std::vector<std::string> &l,
+                      const std::vector<std::string> &h){
+    close();
+    binary = binary_trace;
+    labels = l;
+    headings = h;
+
+    // Large write buffer so the dump goes to disk in big blocks
+    file_buffer.resize(1 << 20);
+    file.rdbuf()->pubsetbuf(file_buffer.data(), file_buffer.size());
+    if (binary)
+        file.open(file_name, std::ofstream::trunc | std::ofstream::binary);
+    else
+        file.open(file_name, std::ofstream::trunc);
+    if (!file.is_open())
+        return false;
+
+    // Set up the output style preferred
+    file << std::fixed;
+
+    //sets the printing double precision to 2 decimal points
+    file << std::setprecision(2);
+
+    if (binary)
+        trace.write_header(file, labels, headings);
+
+    // The ring is kept for a later open, a writer that only feeds curves never allocates it
+    if (capacity == 0) {
+        // Largest power of two number of records that fits in ring_bytes
+        size_t record_bytes = sizeof(TraceRecord) + num_of_arms * sizeof(double);
+        capacity = DUMP_RING_MIN_RECORDS;
+        while (capacity * 2 * record_bytes <= ring_bytes)
+            capacity *= 2;
+        mask = capacity - 1;
+
+        sequences = std::vector<std::atomic<size_t>>(capacity);
+        for (size_t i = 0; i < capacity; i++)
+            sequences[i].store(i, std::memory_order_relaxed);
+        records.resize(capacity);
+        values.resize(capacity * num_of_arms);
+        enqueue_pos = dequeue_pos = 0;
+    }
+
+    stopping = false;
+    worker = std::thread(&DumpWriter::work, this);
+    return true;
+}
+
+/**
+ * Waits for every record to be written and closes the file
+ **/
+void DumpWriter::close(){
+    if (!worker.joinable())
+        return;
+
+    stopping.store(true, std::memory_order_release);
+    worker.join();
+
+    // Environments that never ended (e.g. an interrupted job) are still written, in order
+    for (auto &env : pending)
+        write_pending(env.second);
+    pending.clear();
+    pending_bytes = 0;
+    if (binary)
+        trace.flush(file);
+    file.close();
+}
+
+/**
+ * Feeds every environment and snapshot to the given learning curves as well (nullptr for none)
+ **/
+void DumpWriter::set_curves(LearningCurves *c){ curves = c; }
+
+/**
+ * Queues the arm probabilities of an environment, must come before its snapshots
+ **/
+void DumpWriter::write_environment(int config, int env, const double *probs){
+    if (curves != nullptr)
+        curves->begin_environment(config, env, probs, num_of_arms);
+    if (!worker.joinable())
+        return;
+
+    TraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind = TRACE_ENVIRONMENT;
+    record.config = config;
+    record.env = env;
+    push(record, probs);
+}
+
+/**
+ * Queues a snapshot of an agent, iter is the number of iterations shown in the dump
+ **/
+void DumpWriter::write_snapshot(int config, int env, int label, int iter, int optm_chosen, int points,
+                                const double *probs){
+    if (curves != nullptr)
+        curves->add_snapshot(config, env, label, iter, optm_chosen, points);
+    if (!worker.joinable())
+        return;
+
+    TraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind = TRACE_SNAPSHOT;
+    record.config = config;
+    record.env = env;
+    record.label = label;
+    record.iter = iter;
+    record.optm_chosen = optm_chosen;
+    record.points = points;
+    push(record, probs);
+}
+
+/**
+ * Marks the end of an environment, none of its records may follow
+ **/
+void DumpWriter::end_environment(int config, int env){
+    if (curves != nullptr)
+        curves->end_environment(config, env);
+    if (!worker.joinable())
+        return;
+
+    TraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind = DUMP_END;
+    record.config = config;
+    record.env = env;
+    push(record, nullptr);
+}
+
+/**
+ * Prints how often and how long the simulation waited on a full ring, and what was spilled
+ **/
+void DumpWriter::print_backpressure(std::ostream &out){
+    out << "Dump writer: " << enqueue_pos.load() << " records through a ring of " << capacity
+        << " (highest occupancy " << max_occupancy << "), simulation waited on a full ring "
+        << full_waits.load() << " times for " << std::fixed << std::setprecision(3)
+        << wait_ns.load() / 1e6 << " ms" << std::endl;
+    if (spilled_bytes > 0)
+        out << "Dump writer: " << spilled_bytes << " bytes of environments waiting for their turn went through "
+            << "the spill file" << std::endl;
+}
+
+/**
+ * Copies a record into the ring, waits for a free slot when the ring is full
+ **/
+void DumpWriter::push(const TraceRecord &record, const double *probs){
+    PROFILE_BEGIN(PHASE_SNAPSHOT);
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    bool waited = false;
+    std::chrono::steady_clock::time_point wait_start;
+
+    // Bounded multi-producer queue: a slot is free for position pos when its sequence is pos
+    // and holds a record for the reader when its sequence is pos + 1
+    for (;;) {
+        size_t seq = sequences[pos & mask].load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            // The ring is full, let the writer thread catch up
+            if (!waited) {
+                waited = true;
+                wait_start = std::chrono::steady_clock::now();
+                full_waits.fetch_add(1, std::memory_order_relaxed);
+            }
+            std::this_thread::yield();
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (waited)
+        wait_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - wait_start).count(), std::memory_order_relaxed);
+
+    size_t slot = pos & mask;
+    records[slot] = record;
+    if (probs != nullptr)
+        memcpy(&values[slot * num_of_arms], probs, num_of_arms * sizeof(double));
+    sequences[slot].store(pos + 1, std::memory_order_release);
+    PROFILE_END(PHASE_SNAPSHOT);
+}
+
+/**
+ * Takes the oldest record out of the ring, returns false when it is empty
+ **/
+bool DumpWriter::pop(TraceRecord &record, std::vector<double> &probs){
+    // Only the writer thread takes records out, so dequeue_pos needs no compare and swap
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    size_t slot = pos & mask;
+    if (sequences[slot].load(std::memory_order_acquire) != pos + 1)
+        return false;
+
+    size_t occupancy = enqueue_pos.load(std::memory_order_relaxed) - pos;
+    if (occupancy > max_occupancy)
+        max_occupancy = occupancy;
+
+    record = records[slot];
+    if (record.kind != DUMP_END)
+        memcpy(probs.data(), &values[slot * num_of_arms], num_of_arms * sizeof(double));
+    sequences[slot].store(pos + capacity, std::memory_order_release);
+    dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Takes records out of the ring until it is closed and empty
+ **/
+void DumpWriter::work(){
+    TraceRecord record;
+    std::vector<double> probs(num_of_arms);
+    int idle = 0;
+
+    for (;;) {
+        if (pop(record, probs)) {
+            PROFILE_BEGIN(PHASE_DUMP);
+            write_record(record, probs.data());
+            PROFILE_END(PHASE_DUMP);
+            idle = 0;
+            continue;
+        }
+
+        // Every record pushed before close() is visible once the ring is found empty after stopping
+        if (stopping.load(std::memory_order_acquire)) {
+            if (!pop(record, probs))
+                break;
+            write_record(record, probs.data());
+            continue;
+        }
+
+        // Nothing to write, back off from spinning to sleeping so the simulation keeps the core
+        if (++idle < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    file.flush();
+}
+
+/**
+ * Formats a record and writes it to the file or to the buffer of its environment
+ **/
+void DumpWriter::write_record(const TraceRecord &record, const double *probs){
+    int position = record.config * num_of_envs + record.env;
+    auto found = pending.find(position);
+    if (found == pending.end()) {
+        found = pending.insert(std::make_pair(position, PendingEnvironment())).first;
+        found->second.buffer.copyfmt(file);
+    }
+    PendingEnvironment &env = found->second;
+    bool buffered = position != next_env;
+    std::ostream &out = buffered ? (std::ostream &)env.buffer : (std::ostream &)file;
+    std::streamoff before = buffered ? (std::streamoff)env.buffer.tellp() : 0;
+
+    if (record.kind == DUMP_END) {
+        // The probabilities are only needed to format snapshots
+        env.ended = true;
+        std::vector<double>().swap(env.probs);
+        flush_pending();
+        return;
+    } else if (binary) {
+        // An environment waiting for its turn keeps its raw records, they go to the trace's blocks in dump order
+        if (buffered) {
+            out.write((const char *)&record, sizeof(record));
+            out.write((const char *)probs, num_of_arms * sizeof(double));
+        } else {
+            trace.write_record(file, record, probs);
+        }
+    } else if (record.kind == TRACE_ENVIRONMENT) {
+        env.probs.assign(probs, probs + num_of_arms);
+    } else {
+        print_trace_snapshot(out, labels[record.label], headings[record.label], record, num_of_arms,
+                             probs, env.probs.empty() ? nullptr : env.probs.data());
+    }
+
+    if (buffered) {
+        pending_bytes += (std::streamoff)env.buffer.tellp() - before;
+        if (pending_bytes > DUMP_PENDING_BYTES)
+            spill_pending();
+    }
+}
+
+/**
+ * Writes out the buffers of the environments that are now next in the dump
+ **/
+void DumpWriter::flush_pending(){
+    while (!pending.empty() && pending.begin()->first == next_env) {
+        PendingEnvironment &env = pending.begin()->second;
+        write_pending(env);
+        if (!env.ended)
+            break;
+        pending.erase(pending.begin());
+        next_env++;
+    }
+}
+
+/**
+ * Writes buffered bytes of an environment to the file. A binary trace buffers raw records (the fixed
+ * part and the per-arm values, one after the other), which go to the trace's column blocks here
+ **/
+void DumpWriter::write_buffered(const char *bytes, size_t count){
+    if (!binary) {
+        file.write(bytes, count);
+        return;
+    }
+
+    size_t record_bytes = sizeof(TraceRecord) + num_of_arms * sizeof(double);
+    staged_probs.resize(num_of_arms);
+    for (size_t offset = 0; offset + record_bytes <= count; offset += record_bytes) {
+        TraceRecord record;
+        memcpy(&record, bytes + offset, sizeof(record));
+        memcpy(staged_probs.data(), bytes + offset + sizeof(record), num_of_arms * sizeof(double));
+        trace.write_record(file, record, staged_probs.data());
+    }
+}
+
+/**
+ * Writes the spilled parts and the buffer of a pending environment to the file and empties them
+ **/
+void DumpWriter::write_pending(PendingEnvironment &env){
+    std::vector<char> chunk;
+    for (auto &part : env.spilled) {
+        chunk.resize(part.second);
+        std::fseek(spill, part.first, SEEK_SET);
+        if (std::fread(chunk.data(), 1, part.second, spill) != part.second) {
+            std::cerr << "Cannot read back the dump spill file" << std::endl;
+            break;
+        }
+        write_buffered(chunk.data(), part.second);
+    }
+    env.spilled.clear();
+
+    std::string buffered = env.buffer.str();
+    write_buffered(buffered.data(), buffered.size());
+    pending_bytes -= buffered.size();
+    env.buffer.str("");
+}
+
+/**
+ * Moves the buffers of every pending environment to the spill file
+ **/
+void DumpWriter::spill_pending(){
+    if (spill == nullptr) {
+        spill = std::tmpfile();
+        if (spill == nullptr) {
+            // Keep buffering in memory rather than lose records
+            std::cerr << "Cannot create the dump spill file" << std::endl;
+            return;
+        }
+    }
+
+    // Parts are appended at the end, the file is only read back when their environment is written out
+    std::fseek(spill, 0, SEEK_END);
+    for (auto &env : pending) {
+        std::string buffered = env.second.buffer.str();
+        if (buffered.empty())
+            continue;
+        long offset = std::ftell(spill);
+        if (std::fwrite(buffered.data(), 1, buffered.size(), spill) != buffered.size()) {
+            std::cerr << "Cannot write the dump spill file" << std::endl;
+            return;
+        }
+        env.second.spilled.push_back(std::make_pair(offset, buffered.size()));
+        env.second.buffer.str("");
+        pending_bytes -= buffered.size();
+        spilled_bytes += buffered.size();
+    }
+}
@@ -0,0 +1,182 @@
+#ifndef DUMPWRITER_CLASS
+#define DUMPWRITER_CLASS
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include "Trace.hpp"
+#include "Profiler.hpp"
+
+class LearningCurves;
+
+// Memory used by the ring of records, the number of records it holds depends on the number of arms
+#define DUMP_RING_BYTES (8 << 20)
+// Smallest number of records in the ring
+#define DUMP_RING_MIN_RECORDS 16
+// Memory held by the buffers of environments that cannot be written yet, more goes to a spill file
+#define DUMP_PENDING_BYTES (16 << 20)
+// Kind of record closing an environment, no record of it follows
+#define DUMP_END 2
+
+/**
+ * Writes the per-iteration dump (text or binary trace) on its own thread. The simulation threads only
+ * copy the raw numbers of a record into a bounded lock-free ring, the writer thread takes them out,
+ * formats them and writes them to the file. Records of an environment are written in (config, env)
+ * order once every environment before it has ended, so the dump does not depend on the number of threads.
+ * The ring is only allocated by open(), and once the buffers of the environments waiting for their turn
+ * exceed DUMP_PENDING_BYTES they are moved to a temporary spill file, so the memory stays bounded.
+ *
+ * Learning curves set with set_curves get every environment and snapshot too, so they can be collected
+ * with or without a dump file open
+ **/
+class DumpWriter {
+    private:
+        // Number of arms of every record and number of environments per configuration
+        int num_of_arms, num_of_envs;
+        // Ring of records: memory it may use, sequence number, fixed part and per-arm values of every slot
+        size_t ring_bytes, capacity, mask;
+        std::vector<std::atomic<size_t>> sequences;
+        std::vector<TraceRecord> records;
+        std::vector<double> values;
+        // Next slot to fill and next slot to take out, kept on separate cache lines
+        alignas(64) std::atomic<size_t> enqueue_pos;
+        alignas(64) std::atomic<size_t> dequeue_pos;
+        alignas(64) std::atomic<bool> stopping;
+        // Backpressure statistics: records pushed while the ring was full, time spent waiting for a
+        // free slot (ns) and the highest number of records waiting in the ring
+        std::atomic<uint64_t> full_waits, wait_ns;
+        size_t max_occupancy;
+
+        // Output file, its write buffer and the text or binary format
+        std::ofstream file;
+        std::vector<char> file_buffer;
+        bool binary;
+        TraceWriter trace;
+        std::vector<std::string> labels, headings;
+        std::thread worker;
+        // Learning curves fed with the snapshots, nullptr when there are none
+        LearningCurves *curves;
+
+        /**
+         * Records of an environment that cannot be written yet (the (offset, size) of the parts moved to the
+         * spill file, then the buffer), its arm probabilities (text dump, until it ends) and whether it has ended
+         **/
+        struct PendingEnvironment {
+            std::vector<std::pair<long, size_t>> spilled;
+            std::ostringstream buffer;
+            std::vector<double> probs;
+            bool ended;
+            PendingEnvironment() : ended(false) {}
+        };
+        // Environments started but not written out, by position in the dump
+        std::map<int, PendingEnvironment> pending;
+        // Position in the dump of the environment written straight to the file
+        int next_env;
+        // Bytes in the buffers of pending, temporary file they are moved to beyond DUMP_PENDING_BYTES
+        // (nullptr until then) and bytes moved so far
+        size_t pending_bytes;
+        std::FILE *spill;
+        uint64_t spilled_bytes;
+        // Per-arm values of a raw record read back from a buffer (binary trace)
+        std::vector<double> staged_probs;
+
+        /**
+         * Copies a record into the ring, waits for a free slot when the ring is full
+         **/
+        void push(const TraceRecord &record, const double *probs);
+
+        /**
+         * Takes the oldest record out of the ring, returns false when it is empty
+         **/
+        bool pop(TraceRecord &record, std::vector<double> &probs);
+
+        /**
+         * Takes records out of the ring until it is closed and empty
+         **/
+        void work();
+
+        /**
+         * Formats a record and writes it to the file or to the buffer of its environment
+         **/
+        void write_record(const TraceRecord &record, const double *probs);
+
+        /**
+         * Writes out the buffers of the environments that are now next in the dump
+         **/
+        void flush_pending();
+
+        /**
+         * Writes buffered bytes of an environment to the file. A binary trace buffers raw records (the fixed
+         * part and the per-arm values, one after the other), which go to the trace's column blocks here
+         **/
+        void write_buffered(const char *bytes, size_t count);
+
+        /**
+         * Writes the spilled parts and the buffer of a pending environment to the file and empties them
+         **/
+        void write_pending(PendingEnvironment &env);
+
+        /**
+         * Moves the buffers of every pending environment to the spill file
+         **/
+        void spill_pending();
+
+    public:
+        /**
+         * Constructor that takes the number of arms, the number of environments per configuration and
+         * the memory used by the ring
+         **/
+        DumpWriter(int n = 10, int envs = 1, size_t ring_bytes = DUMP_RING_BYTES);
+
+        /**
+         * Closes the file if it is still open
+         **/
+        ~DumpWriter();
+
+        /**
+         * Allocates the ring, opens the dump file and starts the writer thread. labels and headings are the
+         * agent labels and the headings of their per-arm values (label i of a snapshot refers to labels[i])
+         **/
+        bool open(const std::string &file_name, bool binary_trace, const std::vector<std::string> &labels,
+                  const std::vector<std::string> &headings);
+
+        /**
+         * Waits for every record to be written and closes the file
+         **/
+        void close();
+
+        /**
+         * Feeds every environment and snapshot to the given learning curves as well (nullptr for none)
+         **/
+        void set_curves(LearningCurves *c);
+
+        /**
+         * Queues the arm probabilities of an environment, must come before its snapshots
+         **/
+        void write_environment(int config, int env, const double *probs);
+
+        /**
+         * Queues a snapshot of an agent, iter is the number of iterations shown in the dump
+         **/
+        void write_snapshot(int config, int env, int label, int iter, int optm_chosen, int points,
+                            const double *probs);
+
+        /**
+         * Marks the end of an environment, none of its records may follow
+         **/
+        void end_environment(int config, int env);
+
+        /**
+         * Prints how often and how long the simulation waited on a full ring, and what was spilled
+         **/
+        void print_backpressure(std::ostream &out);
+};
+
+#endif
@@ -1,34 +1,62 @@
 #include "Environment.hpp"
+#include "ThresholdKernel.hpp"
+#include <algorithm>
+#include <thread>
 
 /**
- * Constructor that takes number of arms (n)
+ * Constructor that takes number of arms (n) and the random stream of the environment
  **/
-Environment::Environment(int n) {
-    for(int i = 0; i < n; i++) {
-        arms.push_back(Arm());
+Environment::Environment(int n, Rng r){ regenerate(n, r); }
+
+/**
+ * Draws n new arms from r in place, the arms are only reallocated when n grows
+ **/
+void Environment::regenerate(int n, Rng r){
+    rng = r;
+    thresholds.resize(n);
+
+    // Every thread draws its part from its position in the stream, so the arms do not depend on the threads
+    int num_of_threads = 1;
+    if (n >= 2 * ENV_PARALLEL_MIN_ARMS) {
+        static const int num_of_cores = std::thread::hardware_concurrency();
+        num_of_threads = std::min(num_of_cores, n / ENV_PARALLEL_MIN_ARMS);
+    }
+    if (num_of_threads <= 1) {
+        draw_arms(0, n, rng);
+    } else {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_of_threads; t++) {
+            int first = (long)n * t / num_of_threads, last = (long)n * (t + 1) / num_of_threads;
+            Rng part = rng;
+            part.skip(first);
+            threads.push_back(std::thread(&Environment::draw_arms, this, first, last, part));
+        }
+        for (auto &thread : threads)
+            thread.join();
     }
-    optm_prob_index = get_optm_prob_arg();
-} 
+    rng.skip(n);
+    optm_prob_index = drift.is_drifting() ? drift.start(thresholds.data(), n, r) : get_optm_prob_arg();
+}
+
+/**
+ * Draws the thresholds of arms [first, last) from r, which is at the position of arm first
+ **/
+void Environment::draw_arms(int first, int last, Rng r){
+    for (int i = first; i < last; i++)
+        thresholds[i] = Arm::random_threshold(r.next_u64());
+}
 
 /**
  * Returns argument with the highest probability
  **/
 int Environment::get_optm_prob_arg() {
-    int optm_index = -1;
-    double optm_val = 0;
-    for (int i = 0; i < arms.size(); i++) {
-        if (arms[i].get_prob() > optm_val) {
-            optm_index = i;
-            optm_val = arms[i].get_prob();
-        }
-    }
-    return optm_index;
+    return threshold_argmax(thresholds.data(), thresholds.size());
 }
 
 /**
  * returns the arms vector
  **/
-int Environment::get_arms_size(){ return arms.size(); }
+int Environment::get_arms_size(){ return thresholds.size(); }
 
 /**
  * Returns 1 if the choice is optimal (greatest probability), otherwise 0;
@@ -40,14 +68,67 @@ int Environment::is_optimal(int choice) { return (optm_prob_index == choice) ? 1
  **/
 void Environment::print_arm_probs(std::ostream &file){
     file << "Arm Success Probs: \t\t";
-    for (auto arm : arms)
-        file << arm.get_prob() << " " << NUM_SPACE;
+    for (uint64_t threshold : thresholds)
+        file << Arm::threshold_prob(threshold) << " " << NUM_SPACE;
     file << std::endl;
 }
 
+/**
+ * Copies the arm probabilities of producing reward to out
+ **/
+void Environment::get_arm_probs(double *out){
+    for (size_t i = 0; i < thresholds.size(); i++)
+        out[i] = Arm::threshold_prob(thresholds[i]);
+}
+
+/**
+ * Returns the reward thresholds of the arms (see Rng::bernoulli_threshold)
+ **/
+const uint64_t *Environment::get_thresholds(){ return thresholds.data(); }
+
 /**
  * Pull the chosen arm and return reward
  **/
 int Environment::pull_chosen_arm(int choice){
-    return arms[choice].pull_arm();
-}
\ No newline at end of file
+    return rng.next_bernoulli(thresholds[choice]);
+}
+
+/**
+ * Pull the chosen arm with the given reward stream and return reward, so several agents can
+ * share the environment with streams of their own
+ **/
+int Environment::pull_chosen_arm(int choice, Rng &r){
+    return r.next_bernoulli(thresholds[choice]);
+}
+
+/**
+ * Pulls choices[i] for i < n in order and writes the rewards to out_rewards, exactly like n calls of
+ * pull_chosen_arm(choices[i], r). The random bits are drawn in blocks of ENV_PULL_BLOCK and compared
+ * with the integer thresholds of the arms in a separate loop the compiler can vectorize
+ **/
+void Environment::pull_many(const int *choices, int n, int *out_rewards, Rng &r){
+    uint64_t block[ENV_PULL_BLOCK];
+    for (int first = 0; first < n; first += ENV_PULL_BLOCK) {
+        int count = std::min(n - first, ENV_PULL_BLOCK);
+        r.fill(block, count);
+        for (int i = 0; i < count; i++)
+            out_rewards[first + i] = Rng::bernoulli(block[i], thresholds[choices[first + i]]);
+    }
+}
+
+/**
+ * Same as pull_many with the stream of the environment
+ **/
+void Environment::pull_many(const int *choices, int n, int *out_rewards){ pull_many(choices, n, out_rewards, rng); }
+
+/**
+ * Replaces the random stream used to produce rewards
+ **/
+void Environment::set_rng(Rng r){ rng = r; }
+
+/**
+ * Makes the environment non-stationary as set by d (DRIFT_NONE makes it stationary again), from the
+ * next regenerate on. The changes come from the stream of the environment forked with ENV_DRIFT_STREAM,
+ * so they only depend on the key of the environment and not on the agents playing it
+ **/
+void Environment::set_drift(const Drift &d){ drift.set(d); }
\ No newline at end of file
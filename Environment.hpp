@@ -1,26 +1,53 @@
 #ifndef ENVIRONMENT_CLASS
 #define ENVIRONMENT_CLASS
 #define NUM_SPACE std::setw(5) // Formatting support for printing an array
+#define ENV_PULL_BLOCK 64 // Number of random values drawn at once by pull_many
+#define ENV_PARALLEL_MIN_ARMS (1 << 18) // Arms per thread from which the arms are drawn by several threads
 
 #include <vector>
 #include <iostream>
 #include <iomanip>
 #include "Arm.hpp"
+#include "ArmDrift.hpp"
 
+/**
+ * Arms of a slot machine, stored as one contiguous column of integer reward thresholds (see Arm): 8 bytes
+ * per arm that give both the reward draw and the exact probability (threshold - 1) / 2^53, so environments
+ * with millions of arms stay compact. Large environments are drawn by several threads from the counter
+ * based stream, with the same arms as one thread, and the best arm is found by a vector kernel.
+ *
+ * A non-stationary environment (see set_drift) changes its arms as it is played and keeps its best arm
+ * current with a ThresholdTree
+ **/
 class Environment{
     private:
-        std::vector<Arm> arms; // Collection of arms available
+        std::vector<uint64_t> thresholds; // Reward threshold of every arm available
         int optm_prob_index;
+        Rng rng; // Random stream used to generate the arms and their rewards
+        // Changes of a non-stationary environment, with the best arm kept current while they happen
+        ArmDrift drift;
         /**
          * Returns argument with the highest probability
          **/
         int get_optm_prob_arg();
-        
+
+        /**
+         * Draws the thresholds of arms [first, last) from r, which is at the position of arm first
+         **/
+        void draw_arms(int first, int last, Rng r);
+
+
     public:
         /**
-         * Constructor that takes number of arms (n)
+         * Constructor that takes number of arms (n) and the random stream of the environment
          **/
-        Environment(int n = 10);
+        Environment(int n = 10, Rng r = Rng());
+
+        /**
+         * Draws n new arms from r in place, the arms are only reallocated when n grows
+         **/
+        void regenerate(int n, Rng r);
+
         /**
          * returns the arms vector
          **/
@@ -36,10 +63,64 @@ class Environment{
          **/
         void print_arm_probs(std::ostream &file = std::cout);
 
+        /**
+         * Copies the arm probabilities of producing reward to out
+         **/
+        void get_arm_probs(double *out);
+
+        /**
+         * Returns the reward thresholds of the arms (see Rng::bernoulli_threshold)
+         **/
+        const uint64_t *get_thresholds();
+
         /**
          * Pull the chosen arm and return reward
          **/
         int pull_chosen_arm(int choice);
+
+        /**
+         * Pull the chosen arm with the given reward stream and return reward, so several agents can
+         * share the environment with streams of their own
+         **/
+        int pull_chosen_arm(int choice, Rng &r);
+
+        /**
+         * Pulls choices[i] for i < n in order and writes the rewards to out_rewards, exactly like n calls of
+         * pull_chosen_arm(choices[i], r). The random bits are drawn in blocks of ENV_PULL_BLOCK and compared
+         * with the integer thresholds of the arms in a separate loop the compiler can vectorize
+         **/
+        void pull_many(const int *choices, int n, int *out_rewards, Rng &r);
+
+        /**
+         * Same as pull_many with the stream of the environment
+         **/
+        void pull_many(const int *choices, int n, int *out_rewards);
+
+        /**
+         * Replaces the random stream used to produce rewards
+         **/
+        void set_rng(Rng r);
+
+        /**
+         * Makes the environment non-stationary as set by d (DRIFT_NONE makes it stationary again), from the
+         * next regenerate on. The changes come from the stream of the environment forked with ENV_DRIFT_STREAM,
+         * so they only depend on the key of the environment and not on the agents playing it
+         **/
+        void set_drift(const Drift &d);
+
+        /**
+         * Returns true when the arms change while the environment is played
+         **/
+        bool is_drifting(){ return drift.is_drifting(); }
+
+        /**
+         * Moves a non-stationary environment on by one round, called once the arm of a round is pulled.
+         * The best arm is kept current by the max-tree in O(log n) per changed arm, so is_optimal stays O(1)
+         **/
+        void next_round(){
+            if (drift.next_round())
+                optm_prob_index = drift.change(thresholds.data(), thresholds.size());
+        }
 };
 
 #endif
\ No newline at end of file
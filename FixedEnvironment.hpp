@@ -0,0 +1,113 @@
+#ifndef FIXEDENVIRONMENT_CLASS
+#define FIXEDENVIRONMENT_CLASS
+
+#include <array>
+#include <iostream>
+#include <iomanip>
+#include "Arm.hpp"
+#include "ArmDrift.hpp"
+#define NUM_SPACE std::setw(5) // Formatting support for printing an array
+
+/**
+ * Environment with a number of arms N known at compile time, for the agents specialized for N (FixedUCBAgent,
+ * FixedLRAgent). The reward thresholds live in a std::array, so the loops over the arms have a constant trip
+ * count the compiler can unroll and vectorize. The arms, rewards and changes of a drift are drawn exactly like
+ * Environment(N, r) draws them, so an agent plays the same game on either
+ **/
+template <int N>
+class FixedEnvironment {
+    static_assert(N > 0, "an environment needs at least one arm");
+
+    private:
+        // Reward threshold of every arm (see Arm) and index of the arm with the highest probability
+        std::array<uint64_t, N> thresholds;
+        int optm_prob_index;
+        // Random stream used to generate the arms
+        Rng rng;
+        // Changes of a non-stationary environment, with the best arm kept current while they happen
+        ArmDrift drift;
+
+        /**
+         * Returns the first arm with the highest threshold (above 1), like threshold_argmax
+         **/
+        int get_optm_prob_arg(){
+            int optm_index = -1;
+            uint64_t optm_val = 1;
+            for (int i = 0; i < N; i++) {
+                if (thresholds[i] > optm_val) {
+                    optm_index = i;
+                    optm_val = thresholds[i];
+                }
+            }
+            return optm_index;
+        }
+
+    public:
+        /**
+         * Constructor that takes the number of arms, which has to be N, and the random stream of the environment
+         **/
+        FixedEnvironment(int n = N, Rng r = Rng()){ regenerate(n, r); }
+
+        /**
+         * Draws N new arms from r in place, n is only there to match Environment::regenerate
+         **/
+        void regenerate(int, Rng r){
+            rng = r;
+            for (int i = 0; i < N; i++)
+                thresholds[i] = Arm::random_threshold(rng.next_u64());
+            optm_prob_index = drift.is_drifting() ? drift.start(thresholds.data(), N, r) : get_optm_prob_arg();
+        }
+
+        /**
+         * Returns the number of arms
+         **/
+        int get_arms_size(){ return N; }
+
+        /**
+         * Returns 1 if the choice is optimal (greatest probability), otherwise 0
+         **/
+        int is_optimal(int choice){ return (optm_prob_index == choice) ? 1 : 0; }
+
+        /**
+         * Prints the arm probabilities of producing reward
+         **/
+        void print_arm_probs(std::ostream &file = std::cout){
+            file << "Arm Success Probs: \t\t";
+            for (int i = 0; i < N; i++)
+                file << Arm::threshold_prob(thresholds[i]) << " " << NUM_SPACE;
+            file << std::endl;
+        }
+
+        /**
+         * Copies the arm probabilities of producing reward to out
+         **/
+        void get_arm_probs(double *out){
+            for (int i = 0; i < N; i++)
+                out[i] = Arm::threshold_prob(thresholds[i]);
+        }
+
+        /**
+         * Pull the chosen arm with the given reward stream and return reward
+         **/
+        int pull_chosen_arm(int choice, Rng &r){ return r.next_bernoulli(thresholds[choice]); }
+
+        /**
+         * Makes the environment non-stationary as set by d, from the next regenerate on (see Environment::set_drift)
+         **/
+        void set_drift(const Drift &d){ drift.set(d); }
+
+        /**
+         * Returns true when the arms change while the environment is played
+         **/
+        bool is_drifting(){ return drift.is_drifting(); }
+
+        /**
+         * Moves a non-stationary environment on by one round, called once the arm of a round is pulled
+         **/
+        void next_round(){
+            if (drift.next_round())
+                optm_prob_index = drift.change(thresholds.data(), N);
+        }
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef FIXEDLRAGENT_CLASS
+#define FIXEDLRAGENT_CLASS
+
+#include <array>
+#include "Agent.hpp"
+#include "LRAgent.hpp"
+#include "FixedEnvironment.hpp"
+
+/**
+ * LinearRewardUpdate for N arms known at compile time: the probabilities live in a std::array and the L(r-p)
+ * and L(r-i) updates are the dense double updates of LinearRewardUpdateOf<double> with a constant trip count,
+ * so they give the same probabilities. Only below LR_TREE_MIN_ARMS, where LRAgent updates densely as well
+ **/
+template <int N>
+class FixedLinearRewardUpdate {
+    static_assert(N < LR_TREE_MIN_ARMS, "from LR_TREE_MIN_ARMS arms on LRAgent keeps a tree instead");
+
+    private:
+        // Probability of agent picking each arm
+        std::array<double, N> arm_probs;
+        // Alpha and Beta variables from the L(r-p) and L(r-i) functions
+        double alpha, beta;
+
+    public:
+        /**
+         * Constructor that takes the alpha and beta values
+         **/
+        FixedLinearRewardUpdate(double a = 0.1, double b = 0.1)
+        :alpha(a)
+        ,beta(b) {}
+
+        /**
+         * Sets the alpha and beta values
+         **/
+        void set_rates(double a, double b){
+            alpha = a;
+            beta = b;
+        }
+
+        /**
+         * Sets every arm to probability 1/N
+         **/
+        void reset(int){ arm_probs.fill(1.0/N); }
+
+        /**
+         * Changes the probabilities based on the L(r-p)/L(r-i) algorithms
+         **/
+        void update(int choice, int reward, int){
+            if(reward == 1){
+                arm_probs[choice] = arm_probs[choice] + alpha * (1.0 - arm_probs[choice]);
+                for(int i = 0; i < N; i++)
+                    if (i != choice)
+                        arm_probs[i] = (1.0 - alpha) * arm_probs[i];
+            } else {
+                arm_probs[choice] = (1.0 - beta) * arm_probs[choice];
+                for(int i = 0; i < N; i++)
+                    if (i != choice)
+                        arm_probs[i] = (beta/((double)N-1.0)) + (1.0 - beta) * arm_probs[i];
+            }
+        }
+
+        /**
+         * Learns from n rewards in order, one update after the other
+         **/
+        void update_batch(const Feedback *batch, int n, int round){
+            for (int i = 0; i < n; i++)
+                update(batch[i].arm, batch[i].reward, round + i);
+        }
+
+        /**
+         * Returns the first arm whose cumulative probability reaches num, or -1 when the total is below num
+         **/
+        int sample(double num){
+            double total = 0.0;
+            for(int i = 0; i < N; i++){
+                total += arm_probs[i];
+                if (total >= num)
+                    return i;
+            }
+            return -1;
+        }
+
+        /**
+         * Returns the probability of every arm, the values written to the dump
+         **/
+        const double *values(){ return arm_probs.data(); }
+
+        /**
+         * Prints the agent's probabilities to choose each arm
+         **/
+        void print_values(std::ostream &file){
+            file << "Agent Choices Probs: \t";
+            for (int i = 0; i < N; i++)
+                file << arm_probs[i] << " " << NUM_SPACE;
+            file << std::endl;
+        }
+};
+
+/**
+ * LRAgent for N arms known at compile time, playing a FixedEnvironment<N>. It picks the same arms and gets the
+ * same rewards as an LRAgent on Environment(N, r) with the same streams, but never fast forwards. q2
+ * dispatches to it for the arm counts it is built for (fixed_agents), other arm counts play the LRAgent
+ **/
+template <int N>
+class FixedLRAgent : public Agent<ProbabilitySelection, FixedLinearRewardUpdate<N>, FixedEnvironment<N>> {
+    private:
+        typedef Agent<ProbabilitySelection, FixedLinearRewardUpdate<N>, FixedEnvironment<N>> Base;
+
+    public:
+        /**
+         * Default constructor
+         **/
+        FixedLRAgent(FixedEnvironment<N> &env, const std::string &l, double beta = 0.1, double alpha = 0.1)
+        :Base(env, l, ProbabilitySelection(), FixedLinearRewardUpdate<N>(alpha, beta)) {}
+
+        /**
+         * Resets the agent variables and takes a new environment, choices use r and rewards use r.fork(1)
+         **/
+        void change_parameters(FixedEnvironment<N> &env, double a, double b, Rng r = Rng()){
+            this->update.set_rates(a, b);
+            Base::change_parameters(env, r);
+        }
+};
+
+#endif
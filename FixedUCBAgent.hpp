@@ -0,0 +1,154 @@
+#ifndef FIXEDUCBAGENT_CLASS
+#define FIXEDUCBAGENT_CLASS
+
+#include <array>
+#include <cmath>
+#include "Agent.hpp"
+#include "FixedEnvironment.hpp"
+
+/**
+ * SampleMeanUpdate for N arms known at compile time: the estimates and pulls live in std::arrays and every
+ * loop has a constant trip count
+ **/
+template <int N>
+class FixedSampleMeanUpdate {
+    private:
+        // Estimated probability of each arm producing a reward and number of times it was pulled
+        std::array<double, N> est_arm_reward_prob;
+        std::array<int, N> times_arm_pulled;
+
+    public:
+        /**
+         * Sets every estimate to 0.5 with no pulls
+         **/
+        void reset(int){
+            est_arm_reward_prob.fill(0.5);
+            times_arm_pulled.fill(0);
+        }
+
+        /**
+         * Counts the pull and moves the estimate of the chosen arm towards the reward
+         **/
+        void update(int choice, int reward, int round){
+            times_arm_pulled[choice]++;
+            double est_choice_prob = est_arm_reward_prob[choice];
+            est_arm_reward_prob[choice] = est_choice_prob + ((reward - est_choice_prob)/round);
+        }
+
+        /**
+         * Learns from n rewards in order, the first of them in round
+         **/
+        void update_batch(const Feedback *batch, int n, int round){
+            for (int i = 0; i < n; i++)
+                update(batch[i].arm, batch[i].reward, round + i);
+        }
+
+        /**
+         * Returns the estimate of every arm
+         **/
+        const double *estimates(){ return est_arm_reward_prob.data(); }
+
+        /**
+         * Returns the estimate of every arm, the values written to the dump
+         **/
+        const double *values(){ return est_arm_reward_prob.data(); }
+
+        /**
+         * Returns the number of pulls of every arm
+         **/
+        const int *pulls(){ return times_arm_pulled.data(); }
+
+        /**
+         * Prints the agent's estimated probabilities of each arm producing reward
+         **/
+        void print_values(std::ostream &file){
+            file << "Estimated Arm Probs: \t";
+            for (int i = 0; i < N; i++)
+                file << est_arm_reward_prob[i] << " " << NUM_SPACE;
+            file << std::endl;
+        }
+};
+
+/**
+ * UCBSelection for N arms known at compile time: the bounds of every arm and their argmax in one loop of N
+ * steps, with the same bounds and ties as the UCB kernels so it picks the same arm
+ **/
+template <int N>
+class FixedUCBSelection {
+    private:
+        // Upper Confidence Value c
+        double c;
+
+    public:
+        // The choice only depends on the estimates
+        static const bool uses_rng = false;
+
+        /**
+         * Constructor that takes the confidence value c
+         **/
+        FixedUCBSelection(double conf = 2)
+        :c(conf) {}
+
+        /**
+         * Sets the confidence value c
+         **/
+        void set_confidence(double conf){ c = conf; }
+
+        /**
+         * Nothing to reset, the estimates belong to the update policy
+         **/
+        void reset(int, FixedSampleMeanUpdate<N> &){}
+
+        /**
+         * Returns the first arm with the highest bound, -1 when no bound is above 0
+         **/
+        int choose(FixedSampleMeanUpdate<N> &update, int round, Rng &){
+            const double *est = update.estimates();
+            const int *pulled = update.pulls();
+            double log_iter = log(round);
+
+            int lrg_index = -1;
+            double lrg_val = 0;
+            for (int i = 0; i < N; i++) {
+                double prob_ucb = est[i] + c * sqrt(log_iter / (pulled[i] + 1));
+                if (prob_ucb > lrg_val) {
+                    lrg_index = i;
+                    lrg_val = prob_ucb;
+                }
+            }
+            return lrg_index;
+        }
+
+        /**
+         * Nothing to observe, every choice scans the arms
+         **/
+        void observe(int, FixedSampleMeanUpdate<N> &){}
+};
+
+/**
+ * UCBAgent for N arms known at compile time, playing a FixedEnvironment<N>. It picks the same arms and gets the
+ * same rewards as a UCBAgent on Environment(N, r) with the same streams. q1 dispatches to it for the arm counts
+ * it is built for (fixed_agents), larger or other arm counts play the UCBAgent
+ **/
+template <int N>
+class FixedUCBAgent : public Agent<FixedUCBSelection<N>, FixedSampleMeanUpdate<N>, FixedEnvironment<N>> {
+    private:
+        typedef Agent<FixedUCBSelection<N>, FixedSampleMeanUpdate<N>, FixedEnvironment<N>> Base;
+
+    public:
+        /**
+         * Default constructor
+         **/
+        FixedUCBAgent(FixedEnvironment<N> &env, const std::string &l, double conf = 2)
+        :Base(env, l, FixedUCBSelection<N>(conf)) {}
+
+        /**
+         * Resets the agent variables and takes a new environment whose rewards come from r
+         **/
+        void change_parameters(FixedEnvironment<N> &env, double conf, Rng r = Rng()){
+            this->selection.set_confidence(conf);
+            Base::change_parameters(env, r);
+        }
+};
+
+#endif
@@ -1,140 +1,273 @@
 #include "LRAgent.hpp"
+#include <cmath>
+#include <algorithm>
 
 /**
- * Default constructor
+ * Constructor that takes the alpha and beta values
  **/
-LRAgent::LRAgent(Environment env, std::string l, double beta, double alpha)
-:alpha(alpha)
-,beta(beta)
-,optm_chosen(0)
-,iter_number(1)
-,points(0)
-,curr_env(env)
-,label(l) {
-    int n = env.get_arms_size();
-    for (int i = 0; i < n; i++)
-        arm_probs.push_back(1.0/n);
+template <class Prob>
+LinearRewardUpdateOf<Prob>::LinearRewardUpdateOf(double a, double b)
+:use_tree(false)
+,alpha(a)
+,beta(b) {}
+
+/**
+ * Sets the alpha and beta values
+ **/
+template <class Prob>
+void LinearRewardUpdateOf<Prob>::set_rates(double a, double b){
+    alpha = a;
+    beta = b;
 }
 
 /**
- * returns the cumulative rewards collected
+ * Sets every arm to probability 1/n, in a tree when there are enough arms
  **/
-int LRAgent::get_points(){ return points; }
+template <class Prob>
+void LinearRewardUpdateOf<Prob>::reset(int n){
+    Prob initial;
+    store_value(1.0/n, initial);
+    arm_probs.assign(n, initial);
+
+    use_tree = n >= LR_TREE_MIN_ARMS;
+    if (use_tree)
+        prob_tree.reset(n);
+}
 
 /**
- * Prints the agent's probabilities to choose each arm
+ * Returns the probability of every arm, the values written to the dump
  **/
-void LRAgent::print_arm_sel_probs(std::ostream &file){ 
-    file << "Agent Choices Probs: \t";
-    for (auto prob : arm_probs)
-        file << prob << " " << NUM_SPACE;
-    file << std::endl;
+template <class Prob>
+const double *LinearRewardUpdateOf<Prob>::values(){
+    // In tree mode arm_probs is unused, the probabilities are copied from the tree
+    if (use_tree) {
+        dump_values.resize(arm_probs.size());
+        for (size_t i = 0; i < arm_probs.size(); i++)
+            dump_values[i] = prob_tree.get(i);
+        return dump_values.data();
+    }
+    return stored_values(arm_probs.data(), arm_probs.size(), dump_values);
 }
 
 /**
- * Chooses an arm to pull based on the arm probabilities
+ * Draws k different arms without replacement, each one with its probability among the arms not drawn
+ * yet, writes them to choices and returns how many were drawn (fewer when no probability is left)
  **/
-int LRAgent::choose_arm(){ 
-    double num = rand()/double(RAND_MAX);
+template <class Prob>
+int LinearRewardUpdateOf<Prob>::sample_distinct(int k, Rng &rng, int *choices){
+    int n = arm_probs.size();
+    k = std::min(k, n);
+
     double total = 0.0;
-    for(int i = 0; i < arm_probs.size(); i++){
-        total += arm_probs[i];
-        if (total >= num)
-            return i;
+    if (use_tree) {
+        total = prob_tree.total();
+    } else {
+        picked.assign(n, 0);
+        for (int i = 0; i < n; i++)
+            total += stored_value(arm_probs[i]);
+    }
+
+    double drawn_mass = 0.0;
+    int count = 0;
+    for (; count < k; count++) {
+        double left = total - drawn_mass;
+        if (left <= 0)
+            break;
+        double num = rng.next_double() * left;
+
+        int arm = -1;
+        if (use_tree) {
+            // The drawn arms are skipped by moving num up by their probability before the arm found, until
+            // that stops changing (at most once per drawn arm)
+            double skipped = 0.0;
+            while (true) {
+                arm = prob_tree.sample(num + skipped);
+                if (arm < 0)
+                    break;
+                double before = 0.0;
+                for (int j = 0; j < count; j++)
+                    if (choices[j] <= arm)
+                        before += prob_tree.get(choices[j]);
+                if (before == skipped)
+                    break;
+                skipped = before;
+            }
+
+            // Rounding can leave num above what is left or on an arm of probability 0 drawn already
+            if (arm < 0 || std::find(choices, choices + count, arm) != choices + count)
+                for (arm = 0; std::find(choices, choices + count, arm) != choices + count; arm++);
+        } else {
+            // The last arm left is taken when rounding leaves num above the cumulative probability
+            double cumulative = 0.0;
+            for (int i = 0; i < n; i++) {
+                if (picked[i])
+                    continue;
+                arm = i;
+                cumulative += stored_value(arm_probs[i]);
+                if (cumulative >= num)
+                    break;
+            }
+            picked[arm] = 1;
+        }
+
+        choices[count] = arm;
+        drawn_mass += get_prob(arm);
     }
-    return -1;
+    return count;
+}
+
+/**
+ * Prints the agent's probabilities to choose each arm
+ **/
+template <class Prob>
+void LinearRewardUpdateOf<Prob>::print_values(std::ostream &file){
+    const double *probs = values();
+    file << "Agent Choices Probs: \t";
+    for (size_t i = 0; i < arm_probs.size(); i++)
+        file << probs[i] << " " << NUM_SPACE;
+    file << std::endl;
 }
 
 /**
- * Executes a single round of game and updates arm probabilities
+ * Default constructor
+ **/
+template <class Prob, class Env>
+LRAgentOf<Prob, Env>::LRAgentOf(Env &env, const std::string &l, double beta, double alpha)
+:Base(env, l, ProbabilitySelection(), LinearRewardUpdateOf<Prob>(alpha, beta))
+,fast_forward(false)
+,optm_arm(-1)
+,weights_rounds(0) {}
+
+/**
+ * Resets the agent variables and takes a new environment, choices use r and rewards use r.fork(1)
  **/
-void LRAgent::exec_round(){
-    int choice, reward;
-    double est_choice_prob;
+template <class Prob, class Env>
+void LRAgentOf<Prob, Env>::change_parameters(Env &env, double a, double b, Rng r){
+    update.set_rates(a, b);
+    Base::change_parameters(env, r);
 
-    // Choose an arm
-    choice = choose_arm();
+    if (fast_forward) {
+        int n = env.get_arms_size();
+        env_probs.resize(n);
+        env.get_arm_probs(env_probs.data());
+        optm_arm = -1;
+        for (int i = 0; i < n; i++)
+            if (env.is_optimal(i))
+                optm_arm = i;
 
-    if(choice == -1){
-        return;
-    }
-    
-    //Add 1 to optimal chosen variable if the optimal arm is chosen else add 0 (do nothing)
-    optm_chosen += curr_env.is_optimal(choice);
-
-    // Pulls the arm and returns the reward (0 or 1)
-    reward = curr_env.pull_chosen_arm(choice);
-
-    // Adds the reward to the total points accumulated
-    points += reward;
-
-    // Changes the probabilities based on the L(r-p)/L(r-i) algorithms
-    if(reward == 1){
-        arm_probs[choice] = arm_probs[choice] + alpha * (1.0 - arm_probs[choice]);
-        for(int i = 0; i < arm_probs.size(); i++)
-            if (i != choice)
-                arm_probs[i] = (1.0 - alpha) * arm_probs[i];
-    } else {
-        arm_probs[choice] = (1.0 - beta) * arm_probs[choice];
-        for(int i = 0; i < arm_probs.size(); i++)
-            if (i != choice)
-                arm_probs[i] = (beta/((double)arm_probs.size()-1.0)) + (1.0 - beta) * arm_probs[i];
+        // Every arm starts at probability 1/n, env_probs holds the weights while they are assigned
+        for (int i = 0; i < n; i++)
+            env_probs[i] /= n;
+        reward_weights.assign(env_probs.data(), n);
+        env.get_arm_probs(env_probs.data());
+        weights_rounds = 0;
     }
-    iter_number++;
 }
 
 /**
- * Return the percentage of iterations where reward was received
+ * Turns skipping the rounds without a reward of L(r-i) on or off, takes effect with the next
+ * change_parameters
+ **/
+template <class Prob, class Env>
+void LRAgentOf<Prob, Env>::set_fast_forward(bool on){ fast_forward = on; }
+
+/**
+ * Plays count rounds, event by event with fast forward on an L(r-i) agent without a reward tape in a
+ * stationary environment, otherwise one after the other
  **/
-double LRAgent::get_reward_percent(){
-    return (double)points / (double)iter_number;
+template <class Prob, class Env>
+void LRAgentOf<Prob, Env>::run_rounds(int count){
+    if (!fast_forward || update.get_beta() != 0 || tape != nullptr || curr_env->is_drifting()) {
+        Base::run_rounds(count);
+        return;
+    }
+
+    // Rounds played one by one since the last event (a mixed caller, or a tape attached before) changed the
+    // probabilities behind the weights' back
+    if (rounds != weights_rounds)
+        refresh_reward_weights();
+    while (count > 0)
+        count -= skip_to_reward(count);
+    weights_rounds = rounds;
 }
 
 /**
- * Return the percentage of iterations where optimal arm was chosen
+ * Recomputes the reward chance of every arm from the current probabilities
  **/
-double LRAgent::get_optm_percent(){
-    return (double)optm_chosen / (double)iter_number;
+template <class Prob, class Env>
+void LRAgentOf<Prob, Env>::refresh_reward_weights(){
+    int n = env_probs.size();
+    weights.resize(n);
+    for (int i = 0; i < n; i++)
+        weights[i] = update.get_prob(i) * env_probs[i];
+    reward_weights.assign(weights.data(), n);
+    weights_rounds = rounds;
 }
 
 /**
- * Prints the agent's statistics
+ * Plays the rounds up to and including the next rewarded one, at most max_rounds, in one event
+ * and returns the number of rounds played
  **/
-void LRAgent::print_agent_stats(std::ostream &file){
-        file << "-------------------------------------" << label << "---------------------------------------\n";
-        file << "Optimal Action Chosen:\t" << std::setw(5) << optm_chosen 
-                << "/" << iter_number << std::endl;
+template <class Prob, class Env>
+int LRAgentOf<Prob, Env>::skip_to_reward(int max_rounds){
+    // Chance of a reward in a round
+    double reward_prob = reward_weights.total();
 
-        file << "Percentage:\t" << std::setw(20) 
-                << ((double)optm_chosen / (double)iter_number) * 100 
-                << "%" << std::endl;
+    // Rounds before the next reward, all of them when there is none left to play
+    int skipped = max_rounds;
+    if (reward_prob >= 1) {
+        skipped = 0;
+    } else if (reward_prob > 0) {
+        double geometric = floor(log(1.0 - rng.next_double()) / log1p(-reward_prob));
+        if (geometric < max_rounds)
+            skipped = (int)geometric;
+    }
 
-        file << "Success Rate:\t" << std::setw(13) << points
-                << "/" << iter_number << std::endl;
+    // The optimal arm is chosen in a binomial number of the rounds without a reward
+    if (skipped > 0 && optm_arm >= 0 && reward_prob < 1) {
+        double optm_share = update.get_prob(optm_arm) * (1.0 - env_probs[optm_arm]) / (1.0 - reward_prob);
+        optm_share = std::min(std::max(optm_share, 0.0), 1.0);
+        if (skipped <= LR_SKIP_BERNOULLI_MAX) {
+            for (int i = 0; i < skipped; i++)
+                optm_chosen += (rng.next_double() < optm_share) ? 1 : 0;
+        } else {
+            optm_chosen += rng.next_binomial(skipped, optm_share);
+        }
+    }
+    rounds += skipped;
+    if (skipped == max_rounds)
+        return skipped;
 
-        file << "Percentage:\t" << std::setw(20) 
-                << ((double)points / (double)iter_number) * 100 
-                << "%" << std::endl << std::endl;
+    // The rewarded round: arm i with probability prob[i] * p[i] / reward_prob
+    int choice = reward_weights.sample(rng.next_double() * reward_prob);
+    if (choice < 0)
+        choice = env_probs.size() - 1;
+    optm_chosen += (choice == optm_arm) ? 1 : 0;
+    points++;
+    update.update(choice, 1, rounds + 1);
+    selection.observe(choice, update);
+    rounds++;
 
-        print_arm_sel_probs(file);
-        curr_env.print_arm_probs(file);
-        file << "----------------------------------------------------------------------------------\n\n" << std::endl;
+    // Same update of the weights, every probability is scaled by 1 - alpha and the rewarded one gains alpha
+    reward_weights.transform_all(1.0 - update.get_alpha(), 0.0);
+    reward_weights.add(choice, update.get_alpha() * env_probs[choice]);
+    return skipped + 1;
 }
+
 /**
- * Resets the agent variables and produces a new set of arm probabilities
+ * Draws k different arms for one request from the agent's probabilities, without replacement, and
+ * returns how many were written to choices. Their rewards are learnt later with apply_feedback
  **/
-void LRAgent::change_parameters(Environment &env, double a, double b){
-    curr_env = env;
-    points = 0;
-    iter_number = 0;
-    optm_chosen = 0;
-    arm_probs.clear();
-
-    int n = curr_env.get_arms_size();
-    for (int i = 0; i < n; i++){
-        arm_probs.push_back(1.0/n);
-    }
-    
-    alpha = a;
-    beta = b;
+template <class Prob, class Env>
+int LRAgentOf<Prob, Env>::choose_without_replacement(int k, int *choices){
+    return update.sample_distinct(k, rng, choices);
 }
+
+// The precisions the agent is built with
+template class LinearRewardUpdateOf<double>;
+template class LinearRewardUpdateOf<float>;
+template class LinearRewardUpdateOf<FixedProb>;
+template class LRAgentOf<double>;
+template class LRAgentOf<float>;
+template class LRAgentOf<FixedProb>;
+template class LRAgentOf<double, BatchLane>;
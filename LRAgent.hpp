@@ -3,70 +3,383 @@
 
 #include <vector>
 #include <iomanip>
-#include "Environment.hpp"
+#include "Agent.hpp"
+#include "BatchEnvironment.hpp"
+#include "ArmProbTree.hpp"
+#include "Precision.hpp"
 #define NUM_SPACE std::setw(5) // Formatting support for printing an array
+#define LR_TREE_MIN_ARMS 64 // Arm count from which the probability tree beats the dense updates
+#define LR_SKIP_BERNOULLI_MAX 16 // Skipped rounds up to which the optimal arm count is drawn round by round
 
 
 /**
- * Agent class representing an agent who is playing the slot machine
+ * Update policy of the L(r-p) and L(r-i) algorithms: a probability of picking every arm, moved towards the
+ * chosen arm by alpha on a reward and away from it by beta otherwise (beta = 0 is L(r-i)).
+ *
+ * The probabilities are stored as Prob: double, or float or FixedProb (fixed point) to halve the bytes every
+ * update and draw reads per arm. In a reduced format every other arm is updated in that format and the chosen
+ * arm takes what is left of 1, so rounding errors cannot make the sum drift away from 1 over the rounds
+ * (after an update it is exactly 1 in fixed point). From LR_TREE_MIN_ARMS arms on a round only touches O(log n) nodes of the
+ * ArmProbTree, which stays in double for every format
  **/
-class LRAgent {
+template <class Prob>
+class LinearRewardUpdateOf {
     private:
         // Probability of agent picking each arm
-        std::vector<double> arm_probs;
-        // Cumulative points
-        int points, optm_chosen , iter_number;
+        std::vector<Prob> arm_probs;
+        // Probability of agent picking each arm as a tree, used instead of arm_probs for large numbers of arms
+        ArmProbTree prob_tree;
+        bool use_tree;
         // Alpha and Beta variables from the L(r-p) and L(r-i) functions
         double alpha, beta;
-        // Current Environment
-        Environment curr_env;
-        // Label for the type of algorithm
-        std::string label;
+        // Probabilities converted to double for the dump
+        std::vector<double> dump_values;
+        // Change of every arm by the corrections of a batch of feedback, and arms already drawn by
+        // sample_distinct (dense probabilities only)
+        std::vector<double> batch_delta;
+        std::vector<char> picked;
+
+        /**
+         * Folds a batch of feedback into the dense probabilities in one pass over the arms. Every update maps
+         * all probabilities p to keep * p + share and then corrects the chosen arm, so the whole batch is one
+         * such map plus a correction of every chosen arm scaled by the factors of the updates after it.
+         * Rounding differs from one update at a time, in a reduced format the arm of the last update takes
+         * what is left of 1
+         **/
+        template <class T>
+        void fold_batch(std::vector<T> &probs, const Feedback *batch, int count){
+            int n = probs.size();
+            double share = (n > 1) ? beta/((double)n-1.0) : 0.0;
+
+            // Walking back from the last feedback, scale is the product of the factors of the updates after it
+            double scale = 1.0, offset = 0.0;
+            int last = -1;
+            batch_delta.assign(n, 0.0);
+            for (int j = count - 1; j >= 0; j--) {
+                int arm = batch[j].arm;
+                if (batch[j].reward == 1) {
+                    batch_delta[arm] += alpha * scale;
+                    scale *= 1.0 - alpha;
+                } else if (beta != 0) {
+                    offset += share * scale;
+                    batch_delta[arm] -= share * scale;
+                    scale *= 1.0 - beta;
+                } else {
+                    // L(r-i) learns nothing without a reward
+                    continue;
+                }
+                if (last == -1)
+                    last = arm;
+            }
+            if (last == -1)
+                return;
+
+            for (int i = 0; i < n; i++)
+                store_value(scale * stored_value(probs[i]) + offset + batch_delta[i], probs[i]);
+            take_remainder(probs, last);
+        }
+
+        /**
+         * Dense update of the probabilities in double
+         **/
+        void dense_update(std::vector<double> &probs, int choice, int reward){
+            int n = probs.size();
+            if(reward == 1){
+                probs[choice] = probs[choice] + alpha * (1.0 - probs[choice]);
+                for(int i = 0; i < n; i++)
+                    if (i != choice)
+                        probs[i] = (1.0 - alpha) * probs[i];
+            } else {
+                probs[choice] = (1.0 - beta) * probs[choice];
+                for(int i = 0; i < n; i++)
+                    if (i != choice)
+                        probs[i] = (beta/((double)n-1.0)) + (1.0 - beta) * probs[i];
+            }
+        }
+
+        /**
+         * Double probabilities are left as the updates made them
+         **/
+        void take_remainder(std::vector<double> &, int){}
+
+        /**
+         * Sets the probability of an arm to what the other float probabilities (summed in double) leave of 1
+         **/
+        void take_remainder(std::vector<float> &probs, int arm){
+            int n = probs.size();
+
+            // Four independent partial sums, so the additions do not wait on each other
+            double sums[4] = {0, 0, 0, 0};
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                for (int lane = 0; lane < 4; lane++)
+                    sums[lane] += probs[i + lane];
+            for (; i < n; i++)
+                sums[0] += probs[i];
+            double others = (sums[0] + sums[1]) + (sums[2] + sums[3]) - probs[arm];
+            probs[arm] = (others < 1) ? 1.0 - others : 0;
+        }
+
+        /**
+         * Sets the probability of an arm to what the other fixed-point probabilities leave of FIXED_PROB_ONE
+         **/
+        void take_remainder(std::vector<FixedProb> &probs, int arm){
+            uint64_t total = 0;
+            for (size_t i = 0; i < probs.size(); i++)
+                total += probs[i];
+            uint64_t others = total - probs[arm];
+            probs[arm] = (others < FIXED_PROB_ONE) ? (FixedProb)(FIXED_PROB_ONE - others) : 0;
+        }
+
+        /**
+         * Dense update of float probabilities, the chosen arm takes what is left of 1 (summed in double)
+         **/
+        void dense_update(std::vector<float> &probs, int choice, int reward){
+            if (reward == 0 && beta == 0)
+                return;
+            int n = probs.size();
+            float keep = (reward == 1) ? 1.0 - alpha : 1.0 - beta;
+            float share = (reward == 1) ? 0.0 : beta/((double)n-1.0);
+
+            // Every arm is updated without a branch, the chosen one is overwritten after the sum
+            for (int i = 0; i < n; i++)
+                probs[i] = share + keep * probs[i];
+            take_remainder(probs, choice);
+        }
+
+        /**
+         * Dense update of fixed-point probabilities with integer arithmetic (rounded to nearest), the chosen arm
+         * takes what is left of FIXED_PROB_ONE so the probabilities sum to exactly 1
+         **/
+        void dense_update(std::vector<FixedProb> &probs, int choice, int reward){
+            if (reward == 0 && beta == 0)
+                return;
+            int n = probs.size();
+            FixedProb keep, share;
+            store_value((reward == 1) ? 1.0 - alpha : 1.0 - beta, keep);
+            store_value((reward == 1) ? 0.0 : beta/((double)n-1.0), share);
+
+            // Every arm is updated without a branch, the chosen one is overwritten after the sum
+            uint64_t total = 0;
+            for (int i = 0; i < n; i++) {
+                probs[i] = share + (FixedProb)(((uint64_t)probs[i] * keep + FIXED_PROB_ONE / 2) >> FIXED_PROB_BITS);
+                total += probs[i];
+            }
+            uint64_t others = total - probs[choice];
+            probs[choice] = (others < FIXED_PROB_ONE) ? (FixedProb)(FIXED_PROB_ONE - others) : 0;
+        }
 
     public:
         /**
-         * Default constructor
+         * Constructor that takes the alpha and beta values
+         **/
+        LinearRewardUpdateOf(double a = 0.1, double b = 0.1);
+
+        /**
+         * Sets the alpha and beta values
+         **/
+        void set_rates(double a, double b);
+
+        /**
+         * Sets every arm to probability 1/n, in a tree when there are enough arms
+         **/
+        void reset(int n);
+
+        /**
+         * Changes the probabilities based on the L(r-p)/L(r-i) algorithms
+         **/
+        void update(int choice, int reward, int){
+            if(use_tree){
+                // Same update as below written as one transform of every arm plus a correction of the chosen one
+                if(reward == 1){
+                    prob_tree.transform_all(1.0 - alpha, 0.0);
+                    prob_tree.add(choice, alpha);
+                } else {
+                    double share = beta/((double)arm_probs.size()-1.0);
+                    prob_tree.transform_all(1.0 - beta, share);
+                    prob_tree.add(choice, -share);
+                }
+            } else {
+                dense_update(arm_probs, choice, reward);
+            }
+        }
+
+        /**
+         * Learns from n rewards in order: the dense probabilities take the whole batch in one pass over the
+         * arms, the tree takes one O(log n) update per feedback
+         **/
+        void update_batch(const Feedback *batch, int n, int round){
+            if (use_tree) {
+                for (int i = 0; i < n; i++)
+                    update(batch[i].arm, batch[i].reward, round + i);
+            } else {
+                fold_batch(arm_probs, batch, n);
+            }
+        }
+
+        /**
+         * Returns the probability of picking an arm
          **/
-        LRAgent(Environment env, std::string l, double beta = 0.1, double alpha = 0.1);
+        double get_prob(int arm){ return use_tree ? prob_tree.get(arm) : stored_value(arm_probs[arm]); }
 
         /**
-         * returns the cumulative rewards collected
+         * Returns the alpha value
          **/
-        int get_points();
+        double get_alpha(){ return alpha; }
+
+        /**
+         * Returns the beta value, 0 for L(r-i)
+         **/
+        double get_beta(){ return beta; }
+
+        /**
+         * Returns the first arm whose cumulative probability reaches num, or -1 when the total is below num
+         **/
+        int sample(double num){
+            if (use_tree)
+                return prob_tree.sample(num);
+
+            double total = 0.0;
+            int n = arm_probs.size();
+            for(int i = 0; i < n; i++){
+                total += stored_value(arm_probs[i]);
+                if (total >= num)
+                    return i;
+            }
+            return -1;
+        }
+
+        /**
+         * Draws k different arms without replacement, each one with its probability among the arms not drawn
+         * yet, writes them to choices and returns how many were drawn (fewer when no probability is left)
+         **/
+        int sample_distinct(int k, Rng &rng, int *choices);
+
+        /**
+         * Returns the probability of every arm, the values written to the dump
+         **/
+        const double *values();
 
         /**
          * Prints the agent's probabilities to choose each arm
          **/
-        void print_arm_sel_probs(std::ostream &file = std::cout);
-        
+        void print_values(std::ostream &file);
+};
+
+typedef LinearRewardUpdateOf<double> LinearRewardUpdate;
+
+/**
+ * Selection policy drawing an arm from the probabilities of the update policy
+ **/
+class ProbabilitySelection {
+    public:
+        // Every choice draws a number from the agent's stream
+        static const bool uses_rng = true;
+
+        /**
+         * Nothing to reset, the probabilities belong to the update policy
+         **/
+        template <class Update>
+        void reset(int, Update &){}
+
         /**
-         * Chooses an arm to pull based on the arm probabilities
+         * Draws an arm with the probabilities of the update policy
          **/
-        int choose_arm();
+        template <class Update>
+        int choose(Update &update, int, Rng &rng){ return update.sample(rng.next_double()); }
 
         /**
-         * Executes a single round of game and updates arm probabilities
+         * Nothing to observe
          **/
-        void exec_round();
+        template <class Update>
+        void observe(int, Update &){}
+};
+
+/**
+ * Agent class representing an agent who is playing the slot machine with the L(r-p) or L(r-i) algorithm.
+ *
+ * With fast forward on, an L(r-i) agent (beta = 0) skips the rounds without a reward: they leave the
+ * probabilities unchanged, so with q = sum of prob[i] * p[i] (p the arm probabilities of the environment) the
+ * number of rounds before the next reward is geometric with parameter q, the optimal arm is chosen in a
+ * binomial number of them and the rewarded arm is i with probability prob[i] * p[i] / q. The weights
+ * prob[i] * p[i] live in an ArmProbTree: a reward scales all of them by 1 - alpha and adds alpha * p[c] to the
+ * rewarded arm c, so q and the draw of the rewarded arm cost O(log n). An event costs about as much as one
+ * rewarded round, so the rounds run about 1 / q times faster. The results have the same distribution as
+ * with exec_round but come from other draws, so they are not the same numbers.
+ *
+ * The probabilities of the agent are stored as Prob (LRAgent for double, FloatLRAgent for float and
+ * FixedPointLRAgent for FixedProb), see LinearRewardUpdateOf, and it plays an Env (BatchLRAgent plays one
+ * environment of a BatchEnvironment)
+ **/
+template <class Prob, class Env = Environment>
+class LRAgentOf : public Agent<ProbabilitySelection, LinearRewardUpdateOf<Prob>, Env> {
+    private:
+        typedef Agent<ProbabilitySelection, LinearRewardUpdateOf<Prob>, Env> Base;
+        using Base::update;
+        using Base::selection;
+        using Base::rng;
+        using Base::points;
+        using Base::optm_chosen;
+        using Base::rounds;
+        using Base::curr_env;
+        using Base::tape;
+
+        // Should run_rounds skip the rounds without a reward? (only used by L(r-i) without a reward tape in a
+        // stationary environment)
+        bool fast_forward;
+        // Arm probabilities of the environment and its optimal arm, taken by change_parameters for fast forward
+        std::vector<double> env_probs;
+        int optm_arm;
+        // Chance of a reward of every arm in a round, prob[i] * p[i], the rounds played when it last matched
+        // the probabilities (exec_round and apply_feedback do not keep it up to date) and scratch space
+        ArmProbTree reward_weights;
+        int weights_rounds;
+        std::vector<double> weights;
 
         /**
-         * Return the percentage of iterations where reward was received
+         * Plays the rounds up to and including the next rewarded one, at most max_rounds, in one event
+         * and returns the number of rounds played
          **/
-        double get_reward_percent();
+        int skip_to_reward(int max_rounds);
 
         /**
-         * Return the percentage of iterations where optimal arm was chosen
+         * Recomputes the reward chance of every arm from the current probabilities
          **/
-        double get_optm_percent();
+        void refresh_reward_weights();
 
+    public:
         /**
-         * Prints the agent's statistics
+         * Default constructor
          **/
-        void print_agent_stats(std::ostream &file = std::cout);
+        LRAgentOf(Env &env, const std::string &l, double beta = 0.1, double alpha = 0.1);
+
         /**
-         * Resets the agent variables and produces a new set of arm probabilities
+         * Resets the agent variables and takes a new environment, choices use r and rewards use r.fork(1)
          **/
-        void change_parameters(Environment &env, double a, double b);
+        void change_parameters(Env &env, double a, double b, Rng r = Rng());
+
+        /**
+         * Turns skipping the rounds without a reward of L(r-i) on or off, takes effect with the next
+         * change_parameters
+         **/
+        void set_fast_forward(bool on);
+
+        /**
+         * Plays count rounds, event by event with fast forward on an L(r-i) agent without a reward tape in a
+         * stationary environment, otherwise one after the other
+         **/
+        void run_rounds(int count);
+
+        /**
+         * Draws k different arms for one request from the agent's probabilities, without replacement, and
+         * returns how many were written to choices. Their rewards are learnt later with apply_feedback
+         **/
+        int choose_without_replacement(int k, int *choices);
 };
 
-#endif
\ No newline at end of file
+typedef LRAgentOf<double> LRAgent;
+typedef LRAgentOf<float> FloatLRAgent;
+typedef LRAgentOf<FixedProb> FixedPointLRAgent;
+typedef LRAgentOf<double, BatchLane> BatchLRAgent;
+
+#endif
@@ -0,0 +1,243 @@
+#include "LearningCurves.hpp"
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * Constructor that takes the number of configurations, environments per configuration and agent
+ * labels, the number of iterations and how often the agents take a snapshot
+ **/
+LearningCurves::LearningCurves(int configs, int envs, int labels, int num_of_iters, int freq)
+:num_of_configs(configs)
+,num_of_envs(envs)
+,num_of_labels(labels)
+,num_of_checkpoints(num_of_iters / freq)
+,print_freq(freq)
+,counts(configs * labels * num_of_checkpoints, 0)
+,means(configs * labels * num_of_checkpoints * CURVE_METRICS, 0)
+,m2s(configs * labels * num_of_checkpoints * CURVE_METRICS, 0)
+,playing(configs * envs, nullptr)
+,next_env(configs, 0)
+,num_of_waiting(0) {}
+
+/**
+ * Returns the snapshots of an environment, created when there are none yet
+ **/
+LearningCurves::EnvironmentCurve &LearningCurves::find(int config, int env){
+    auto found = pending.find(config * num_of_envs + env);
+    if (found == pending.end()) {
+        found = pending.insert(std::make_pair(config * num_of_envs + env, EnvironmentCurve())).first;
+        found->second.checkpoints.assign(num_of_labels, 0);
+        found->second.values.resize(num_of_labels * num_of_checkpoints * CURVE_METRICS);
+    }
+    return found->second;
+}
+
+/**
+ * Starts an environment with the given arm probabilities, the best one gives the regret
+ **/
+void LearningCurves::begin_environment(int config, int env, const double *probs, int num_of_arms){
+    double best = 0;
+    for (int i = 0; i < num_of_arms; i++)
+        if (probs[i] > best)
+            best = probs[i];
+
+    std::lock_guard<std::mutex> guard(lock);
+    EnvironmentCurve &curve = find(config, env);
+    curve.best_prob = best;
+    playing[config * num_of_envs + env] = &curve;
+}
+
+/**
+ * Records the next snapshot of an agent (label) in an environment
+ **/
+void LearningCurves::add_snapshot(int config, int env, int label, int iter, int optm_chosen, int points){
+    // Only this thread uses the curve until the environment ends, the map is only needed before it begins
+    EnvironmentCurve *playing_curve = playing[config * num_of_envs + env];
+    if (playing_curve == nullptr) {
+        std::lock_guard<std::mutex> guard(lock);
+        playing_curve = playing[config * num_of_envs + env] = &find(config, env);
+    }
+    EnvironmentCurve &curve = *playing_curve;
+    int checkpoint = curve.checkpoints[label]++;
+    if (checkpoint >= num_of_checkpoints || iter <= 0)
+        return;
+
+    double *values = &curve.values[(label * num_of_checkpoints + checkpoint) * CURVE_METRICS];
+    values[0] = (double)points / iter;
+    values[1] = (double)optm_chosen / iter;
+    values[2] = iter * curve.best_prob - points;
+}
+
+/**
+ * Ends an environment, which is added once every environment before it has ended. An environment
+ * that never began (e.g. skipped by sequential stopping) adds nothing
+ **/
+void LearningCurves::end_environment(int config, int env){
+    std::unique_lock<std::mutex> guard(lock);
+    find(config, env).ended = true;
+    playing[config * num_of_envs + env] = nullptr;
+    num_of_waiting++;
+
+    // Add the environments of the configuration that are now next, in order
+    bool any_added = false;
+    for (;;) {
+        auto found = pending.find(config * num_of_envs + next_env[config]);
+        if (found == pending.end() || !found->second.ended)
+            break;
+        add(config, found->second);
+        pending.erase(found);
+        next_env[config]++;
+        num_of_waiting--;
+        any_added = true;
+    }
+    if (any_added)
+        added.notify_all();
+
+    // Too many environments wait for earlier ones, wait for this one to be added before playing more
+    while (num_of_waiting > CURVE_MAX_WAITING && next_env[config] <= env)
+        added.wait(guard);
+}
+
+/**
+ * Adds the snapshots of an environment to the running means and variances
+ **/
+void LearningCurves::add(int config, const EnvironmentCurve &curve){
+    for (int label = 0; label < num_of_labels; label++) {
+        for (int checkpoint = 0; checkpoint < std::min(curve.checkpoints[label], num_of_checkpoints); checkpoint++) {
+            int index = (config * num_of_labels + label) * num_of_checkpoints + checkpoint;
+            long n = ++counts[index];
+            for (int metric = 0; metric < CURVE_METRICS; metric++) {
+                double value = curve.values[(label * num_of_checkpoints + checkpoint) * CURVE_METRICS + metric];
+                double delta = value - means[index * CURVE_METRICS + metric];
+                means[index * CURVE_METRICS + metric] += delta / n;
+                m2s[index * CURVE_METRICS + metric] += delta * (value - means[index * CURVE_METRICS + metric]);
+            }
+        }
+    }
+}
+
+/**
+ * Writes the size and the elements of a vector in binary
+ **/
+template <typename T>
+static void write_vector(std::ostream &out, const std::vector<T> &values){
+    uint64_t size = values.size();
+    out.write((const char *)&size, sizeof(size));
+    out.write((const char *)values.data(), size * sizeof(T));
+}
+
+/**
+ * Reads a vector written by write_vector, returns false when its size is not the expected one
+ **/
+template <typename T>
+static bool read_vector(std::istream &in, std::vector<T> &values, uint64_t expected){
+    uint64_t size = 0;
+    in.read((char *)&size, sizeof(size));
+    if (!in || size != expected)
+        return false;
+    values.resize(size);
+    in.read((char *)values.data(), size * sizeof(T));
+    return (bool)in;
+}
+
+/**
+ * Writes the running means and variances and the environments waiting to be added, for a checkpoint
+ **/
+void LearningCurves::save(std::ostream &out){
+    std::lock_guard<std::mutex> guard(lock);
+    write_vector(out, counts);
+    write_vector(out, means);
+    write_vector(out, m2s);
+    write_vector(out, next_env);
+
+    uint64_t num_of_pending = pending.size();
+    out.write((const char *)&num_of_pending, sizeof(num_of_pending));
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+        int32_t key = it->first;
+        char ended = it->second.ended;
+        out.write((const char *)&key, sizeof(key));
+        out.write((const char *)&it->second.best_prob, sizeof(it->second.best_prob));
+        out.write(&ended, sizeof(ended));
+        write_vector(out, it->second.checkpoints);
+        write_vector(out, it->second.values);
+    }
+}
+
+/**
+ * Reads what save wrote, returns false (and changes nothing) when it does not fit these curves
+ **/
+bool LearningCurves::load(std::istream &in){
+    std::vector<long> new_counts;
+    std::vector<double> new_means, new_m2s;
+    std::vector<int> new_next_env;
+    std::map<int, EnvironmentCurve> new_pending;
+    if (!read_vector(in, new_counts, counts.size()) || !read_vector(in, new_means, means.size()) ||
+        !read_vector(in, new_m2s, m2s.size()) || !read_vector(in, new_next_env, next_env.size()))
+        return false;
+
+    uint64_t num_of_pending = 0;
+    in.read((char *)&num_of_pending, sizeof(num_of_pending));
+    for (uint64_t i = 0; in && i < num_of_pending; i++) {
+        int32_t key = 0;
+        char ended = 0;
+        EnvironmentCurve curve;
+        in.read((char *)&key, sizeof(key));
+        in.read((char *)&curve.best_prob, sizeof(curve.best_prob));
+        in.read(&ended, sizeof(ended));
+        curve.ended = ended;
+        if (!read_vector(in, curve.checkpoints, num_of_labels) ||
+            !read_vector(in, curve.values, num_of_labels * num_of_checkpoints * CURVE_METRICS))
+            return false;
+        new_pending[key] = curve;
+    }
+    if (!in)
+        return false;
+
+    std::lock_guard<std::mutex> guard(lock);
+    counts.swap(new_counts);
+    means.swap(new_means);
+    m2s.swap(new_m2s);
+    next_env.swap(new_next_env);
+    pending.swap(new_pending);
+    playing.assign(playing.size(), nullptr);
+    num_of_waiting = 0;
+    for (auto it = pending.begin(); it != pending.end(); ++it)
+        num_of_waiting += it->second.ended ? 1 : 0;
+    return true;
+}
+
+/**
+ * Writes the curves as a tab separated file, one line per configuration, agent and checkpoint
+ * with the number of environments and the mean and standard deviation of every metric
+ **/
+bool LearningCurves::write(const std::string &file_name, const std::vector<std::string> &config_names,
+                           const std::vector<std::string> &labels){
+    std::ofstream file(file_name, std::ofstream::trunc);
+    if (!file.is_open())
+        return false;
+
+    file << "# config\tagent\titer\tenvs\treward_mean\treward_sd\toptimal_mean\toptimal_sd\tregret_mean\tregret_sd\n";
+    file << std::setprecision(6);
+    for (int config = 0; config < num_of_configs; config++) {
+        for (int label = 0; label < num_of_labels; label++) {
+            for (int checkpoint = 0; checkpoint < num_of_checkpoints; checkpoint++) {
+                int index = (config * num_of_labels + label) * num_of_checkpoints + checkpoint;
+                long n = counts[index];
+                if (n == 0)
+                    continue;
+
+                file << config_names[config] << "\t" << labels[label] << "\t" << (checkpoint + 1) * print_freq
+                     << "\t" << n;
+                for (int metric = 0; metric < CURVE_METRICS; metric++) {
+                    double sd = (n > 1) ? sqrt(m2s[index * CURVE_METRICS + metric] / (n - 1)) : 0;
+                    file << "\t" << means[index * CURVE_METRICS + metric] << "\t" << sd;
+                }
+                file << "\n";
+            }
+        }
+    }
+    return true;
+}
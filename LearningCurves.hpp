@@ -0,0 +1,109 @@
+#ifndef LEARNINGCURVES_CLASS
+#define LEARNINGCURVES_CLASS
+
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+
+#define CURVE_METRICS 3 // Reward rate, optimal arm rate and cumulative regret at every checkpoint
+#define CURVE_MAX_WAITING 256 // Ended environments kept for an earlier one before end_environment waits for it
+
+/**
+ * Learning curves of a sweep: the running mean and variance (Welford) over the environments of the reward
+ * rate, the optimal arm rate and the cumulative regret (iterations * best arm probability - rewards) of
+ * every agent at every print_freq checkpoint. It takes O(configs x agents x checkpoints) memory instead of
+ * the O(envs x iters) of the dump.
+ *
+ * The snapshots of an environment are kept until it ends and the environments of a configuration are added
+ * in order, so the curves do not depend on the number of threads. Every call may come from any thread, but
+ * the calls of an environment from the one thread playing it: its snapshots go to its own curve without the
+ * lock, which is only taken when an environment begins and ends. At most CURVE_MAX_WAITING ended environments
+ * wait for an earlier one, further ends wait for it to end instead (it is played by another thread, as the
+ * environments of a configuration are handed out in order)
+ **/
+class LearningCurves {
+    private:
+        // Number of configurations, environments per configuration, agent labels and checkpoints, and
+        // iterations between checkpoints
+        int num_of_configs, num_of_envs, num_of_labels, num_of_checkpoints, print_freq;
+        // Environments added, index = (config * num_of_labels + label) * num_of_checkpoints + checkpoint
+        std::vector<long> counts;
+        // Running mean and sum of squared deviations, index = the one of counts * CURVE_METRICS + metric
+        std::vector<double> means, m2s;
+
+        /**
+         * Snapshots of an environment that is played or waits for the environments before it
+         **/
+        struct EnvironmentCurve {
+            double best_prob;
+            std::vector<int> checkpoints;
+            std::vector<double> values;
+            bool ended;
+            EnvironmentCurve() : best_prob(0), ended(false) {}
+        };
+        // Environments started but not added, by config * num_of_envs + env
+        std::map<int, EnvironmentCurve> pending;
+        // Curve of every environment being played, by config * num_of_envs + env, only used by its thread
+        std::vector<EnvironmentCurve *> playing;
+        // Next environment of every configuration to add and number of ended environments in pending
+        std::vector<int> next_env;
+        int num_of_waiting;
+        std::mutex lock;
+        // Signalled when environments are added
+        std::condition_variable added;
+
+        /**
+         * Returns the snapshots of an environment, created when there are none yet
+         **/
+        EnvironmentCurve &find(int config, int env);
+
+        /**
+         * Adds the snapshots of an environment to the running means and variances
+         **/
+        void add(int config, const EnvironmentCurve &curve);
+
+    public:
+        /**
+         * Constructor that takes the number of configurations, environments per configuration and agent
+         * labels, the number of iterations and how often the agents take a snapshot
+         **/
+        LearningCurves(int configs, int envs, int labels, int num_of_iters, int freq);
+
+        /**
+         * Starts an environment with the given arm probabilities, the best one gives the regret
+         **/
+        void begin_environment(int config, int env, const double *probs, int num_of_arms);
+
+        /**
+         * Records the next snapshot of an agent (label) in an environment
+         **/
+        void add_snapshot(int config, int env, int label, int iter, int optm_chosen, int points);
+
+        /**
+         * Ends an environment, which is added once every environment before it has ended. An environment
+         * that never began (e.g. skipped by sequential stopping) adds nothing
+         **/
+        void end_environment(int config, int env);
+
+        /**
+         * Writes the running means and variances and the environments waiting to be added, for a checkpoint
+         **/
+        void save(std::ostream &out);
+
+        /**
+         * Reads what save wrote, returns false (and changes nothing) when it does not fit these curves
+         **/
+        bool load(std::istream &in);
+
+        /**
+         * Writes the curves as a tab separated file, one line per configuration, agent and checkpoint
+         * with the number of environments and the mean and standard deviation of every metric
+         **/
+        bool write(const std::string &file_name, const std::vector<std::string> &config_names,
+                   const std::vector<std::string> &labels);
+};
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef POLICYSWEEP_FUNCS
+#define POLICYSWEEP_FUNCS
+
+#include <vector>
+#include <algorithm>
+#include "Environment.hpp"
+#include "BatchAgent.hpp"
+#include "SweepRunner.hpp"
+#include "DumpWriter.hpp"
+#include "RewardTape.hpp"
+
+/**
+ * Runs one environment with every agent of agents. Every agent plays the rounds up to the next multiple of
+ * print_freq with run_rounds (the agents only draw from their own streams, so the order in which they play
+ * does not matter), then their snapshots are queued on the dump writer (agent i with label i) when there is
+ * one. env_probs is scratch space for the arm probabilities written to the dump
+ **/
+template <class AgentType, class Env>
+void run_policy_environment(std::vector<AgentType> &agents, Env &env, int config, int env_index,
+                            int num_of_iters, int print_freq, DumpWriter *dump_writer,
+                            std::vector<double> &env_probs){
+    if (dump_writer != nullptr) {
+        env_probs.resize(env.get_arms_size());
+        env.get_arm_probs(env_probs.data());
+        dump_writer->write_environment(config, env_index, env_probs.data());
+    }
+
+    for (int iter_num = 0; iter_num < num_of_iters;) {
+        // Execute the iterations (rounds) up to the next print for every agent
+        int next_print = std::min(num_of_iters, (iter_num / print_freq + 1) * print_freq);
+        for (auto &agent : agents)
+            agent.run_rounds(next_print - iter_num);
+        iter_num = next_print;
+
+        // Print out once very print_freq number of times
+        if (iter_num % print_freq == 0 && dump_writer != nullptr) {
+            for (size_t i = 0; i < agents.size(); i++)
+                agents[i].trace_agent_stats(*dump_writer, config, env_index, (int)i);
+        }
+    }
+    if (dump_writer != nullptr)
+        dump_writer->end_environment(config, env_index);
+}
+
+/**
+ * Runs a sweep of num_of_configs configurations x num_of_envs environments on the runner with copies of
+ * the prototype agents (one set per worker), for any agent type with the interface of Agent. The environments
+ * are of the agent's EnvironmentType (an Environment, or a FixedEnvironment<N> for the agents specialized for N).
+ *
+ * Environment env of configuration config is keyed by (seed, config, env) and agent i gets the stream
+ * (seed, config, env, i + 1). Before every environment setup(agent, i, config, env, rng) is called for
+ * every agent, which sets the parameters of the configuration and calls change_parameters.
+ * The results of agent i are stored at (i * num_of_configs + config) * num_of_envs + env of optm
+ * (% optimal arm chosen) and point (% reward collected), which are resized to fit.
+ *
+ * Every worker keeps one environment that is regenerated in place for each of its jobs and its agents
+ * only refer to it, so once the first job of a worker has sized everything a job allocates nothing.
+ *
+ * With reward tapes (common random numbers, see generate_reward_tapes) environment env is keyed by
+ * (seed, 0, env) for every configuration and every agent replays tapes[env], so all configurations play
+ * the same environments with the same rewards.
+ *
+ * When jobs is given only those jobs (config * num_of_envs + env) run and the results of the others are
+ * left as they are, so a sweep can run in waves.
+ *
+ * With a drift (see Environment::set_drift) the environments change while they are played, so every agent
+ * plays its own copy of environment env: the copies are regenerated from the same key and change the same
+ * way, whatever the agents do
+ **/
+template <class AgentType, class Setup>
+void run_policy_sweep(SweepRunner &runner, const std::vector<AgentType> &prototypes, int num_of_configs,
+                      int num_of_envs, int num_of_arms, int num_of_iters, int print_freq, unsigned long seed,
+                      DumpWriter *dump_writer, Setup setup, std::vector<double> &optm, std::vector<double> &point,
+                      const std::vector<RewardTape> *tapes = nullptr, const std::vector<int> *jobs = nullptr,
+                      const Drift &drift = Drift()){
+    int num_of_agents = prototypes.size();
+    optm.resize(num_of_agents * num_of_configs * num_of_envs);
+    point.resize(num_of_agents * num_of_configs * num_of_envs);
+
+    // Agents, environments (one per agent when they drift) and dump scratch space, one of each per worker thread
+    std::vector<std::vector<AgentType>> worker_agents(runner.get_num_of_threads(), prototypes);
+    typedef typename AgentType::EnvironmentType Env;
+    Env prototype_env(0);
+    prototype_env.set_drift(drift);
+    std::vector<std::vector<Env>> worker_envs(runner.get_num_of_threads(), std::vector<Env>(
+        (drift.mode == DRIFT_NONE) ? 1 : num_of_agents, prototype_env));
+    std::vector<std::vector<double>> worker_probs(runner.get_num_of_threads());
+
+    int num_of_jobs = (jobs != nullptr) ? jobs->size() : num_of_configs * num_of_envs;
+    runner.run(num_of_jobs, [&](int job_index, int worker, std::ostream &) {
+        int job = (jobs != nullptr) ? (*jobs)[job_index] : job_index;
+        int config = job / num_of_envs;
+        int env_index = job % num_of_envs;
+        std::vector<AgentType> &agents = worker_agents[worker];
+
+        // Regenerate the environments of the worker with the indicated number of arms, keyed by (seed, config, environment)
+        std::vector<Env> &envs = worker_envs[worker];
+        for (auto &env : envs)
+            env.regenerate(num_of_arms, Rng(seed, (tapes != nullptr) ? 0 : config, env_index));
+
+        // Change the parameters of the agents to accomodate for the current configuration
+        for (int i = 0; i < num_of_agents; i++) {
+            setup(agents[i], i, config, envs[std::min(i, (int)envs.size() - 1)], Rng(seed, config, env_index, i + 1));
+            if (tapes != nullptr)
+                agents[i].use_reward_tape(&(*tapes)[env_index]);
+        }
+
+        run_policy_environment(agents, envs[0], config, env_index, num_of_iters, print_freq, dump_writer,
+                               worker_probs[worker]);
+
+        for (int i = 0; i < num_of_agents; i++) {
+            optm[(i * num_of_configs + config) * num_of_envs + env_index] = agents[i].get_optm_percent();
+            point[(i * num_of_configs + config) * num_of_envs + env_index] = agents[i].get_reward_percent();
+        }
+    });
+}
+
+/**
+ * Runs the same sweep as run_policy_sweep (same arguments, results, dump and curves) with the environments
+ * played in lockstep batches. Consecutive jobs of the same configuration (in the order of jobs) form batches
+ * of up to batch_size environments in a BatchEnvironment, and every prototype agent plays all of them as a
+ * BatchAgent. AgentType plays a BatchLane (BatchUCBAgent, BatchLRAgent), and setup is called with the lane of
+ * the environment.
+ *
+ * Every worker keeps its batches, agents and streams and regenerates them in place, so once the first job of a
+ * worker has sized everything a job allocates nothing. With a drift every agent plays its own copy of the batch
+ **/
+template <class AgentType, class Setup>
+void run_batch_sweep(SweepRunner &runner, const std::vector<AgentType> &prototypes, int batch_size,
+                     int num_of_configs, int num_of_envs, int num_of_arms, int num_of_iters, int print_freq,
+                     unsigned long seed, DumpWriter *dump_writer, Setup setup, std::vector<double> &optm,
+                     std::vector<double> &point, const std::vector<RewardTape> *tapes = nullptr,
+                     const std::vector<int> *jobs = nullptr, const Drift &drift = Drift()){
+    int num_of_agents = prototypes.size();
+    optm.resize(num_of_agents * num_of_configs * num_of_envs);
+    point.resize(num_of_agents * num_of_configs * num_of_envs);
+
+    // Jobs to run and the first job of every batch (followed by the end of the jobs)
+    std::vector<int> all_jobs;
+    if (jobs == nullptr)
+        for (int job = 0; job < num_of_configs * num_of_envs; job++)
+            all_jobs.push_back(job);
+    const std::vector<int> &run_jobs = (jobs != nullptr) ? *jobs : all_jobs;
+    std::vector<int> batch_first;
+    for (int i = 0; i < (int)run_jobs.size(); i++)
+        if (batch_first.empty() || i - batch_first.back() == batch_size ||
+            run_jobs[i] / num_of_envs != run_jobs[batch_first.back()] / num_of_envs)
+            batch_first.push_back(i);
+    batch_first.push_back(run_jobs.size());
+
+    // Batched agents of every kind, batches (one per agent when they drift), environment streams and dump scratch
+    // space, one of each per worker thread
+    int num_of_workers = runner.get_num_of_threads();
+    std::vector<std::vector<BatchAgent<AgentType>>> worker_agents(num_of_workers);
+    for (auto &agents : worker_agents)
+        for (int i = 0; i < num_of_agents; i++)
+            agents.push_back(BatchAgent<AgentType>(prototypes[i], batch_size));
+    BatchEnvironment prototype_env(0, num_of_arms);
+    prototype_env.set_drift(drift);
+    std::vector<std::vector<BatchEnvironment>> worker_envs(num_of_workers, std::vector<BatchEnvironment>(
+        (drift.mode == DRIFT_NONE) ? 1 : num_of_agents, prototype_env));
+    std::vector<std::vector<Rng>> worker_rngs(num_of_workers);
+    std::vector<std::vector<double>> worker_probs(num_of_workers, std::vector<double>(num_of_arms));
+
+    runner.run(batch_first.size() - 1, [&](int batch_index, int worker, std::ostream &) {
+        int first = batch_first[batch_index], count = batch_first[batch_index + 1] - first;
+        int config = run_jobs[first] / num_of_envs;
+        std::vector<BatchAgent<AgentType>> &agents = worker_agents[worker];
+
+        // Regenerate the batches of the worker, environment env keyed by (seed, config, env)
+        std::vector<Rng> &rngs = worker_rngs[worker];
+        rngs.clear();
+        for (int e = 0; e < count; e++)
+            rngs.push_back(Rng(seed, (tapes != nullptr) ? 0 : config, run_jobs[first + e] % num_of_envs));
+        std::vector<BatchEnvironment> &envs = worker_envs[worker];
+        for (auto &env : envs)
+            env.regenerate(count, num_of_arms, rngs.data());
+
+        // Change the parameters of the agents of every environment to accomodate for the current configuration
+        for (int i = 0; i < num_of_agents; i++) {
+            BatchEnvironment &env = envs[std::min(i, (int)envs.size() - 1)];
+            for (int e = 0; e < count; e++) {
+                int env_index = run_jobs[first + e] % num_of_envs;
+                setup(agents[i].get_agent(e), i, config, env.lane(e), Rng(seed, config, env_index, i + 1));
+                if (tapes != nullptr)
+                    agents[i].get_agent(e).use_reward_tape(&(*tapes)[env_index]);
+            }
+            agents[i].start(env);
+        }
+
+        // The dump writer puts the records of every environment back in the order of run_policy_sweep
+        for (int e = 0; dump_writer != nullptr && e < count; e++) {
+            envs[0].get_arm_probs(e, worker_probs[worker].data());
+            dump_writer->write_environment(config, run_jobs[first + e] % num_of_envs, worker_probs[worker].data());
+        }
+
+        for (int iter_num = 0; iter_num < num_of_iters;) {
+            // Execute the iterations (rounds) up to the next print in every environment, agent by agent
+            int next_print = std::min(num_of_iters, (iter_num / print_freq + 1) * print_freq);
+            for (auto &agent : agents)
+                agent.run_rounds(next_print - iter_num);
+            iter_num = next_print;
+
+            // Print out once very print_freq number of times
+            if (iter_num % print_freq == 0 && dump_writer != nullptr) {
+                for (int e = 0; e < count; e++)
+                    for (int i = 0; i < num_of_agents; i++)
+                        agents[i].get_agent(e).trace_agent_stats(*dump_writer, config,
+                                                                 run_jobs[first + e] % num_of_envs, i);
+            }
+        }
+
+        for (int e = 0; e < count; e++) {
+            int env_index = run_jobs[first + e] % num_of_envs;
+            if (dump_writer != nullptr)
+                dump_writer->end_environment(config, env_index);
+            for (int i = 0; i < num_of_agents; i++) {
+                optm[(i * num_of_configs + config) * num_of_envs + env_index] = agents[i].get_agent(e).get_optm_percent();
+                point[(i * num_of_configs + config) * num_of_envs + env_index] = agents[i].get_agent(e).get_reward_percent();
+            }
+        }
+    });
+}
+
+/**
+ * Generates the reward tape of every environment of a sweep on the runner: environment env is keyed by
+ * (seed, 0, env) and its tape holds num_of_iters rewards per arm drawn from the environment's stream
+ * forked with 1, enough for any agent. The tapes take num_of_envs * num_of_arms * num_of_iters / 8 bytes
+ **/
+inline void generate_reward_tapes(SweepRunner &runner, int num_of_envs, int num_of_arms, int num_of_iters,
+                                  unsigned long seed, std::vector<RewardTape> &tapes){
+    tapes.resize(num_of_envs);
+    std::vector<std::vector<double>> worker_probs(runner.get_num_of_threads(), std::vector<double>(num_of_arms));
+
+    runner.run(num_of_envs, [&](int env_index, int worker, std::ostream &) {
+        Rng rng(seed, 0, env_index);
+        Environment env(num_of_arms, rng);
+        env.get_arm_probs(worker_probs[worker].data());
+        tapes[env_index].generate(worker_probs[worker].data(), num_of_arms, num_of_iters, rng.fork(1));
+    });
+}
+
+#endif
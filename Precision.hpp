@@ -0,0 +1,66 @@
+#ifndef PRECISION_FUNCS
+#define PRECISION_FUNCS
+
+#include <cstdint>
+#include <vector>
+#define FIXED_PROB_BITS 31 // Fraction bits of a FixedProb
+#define FIXED_PROB_ONE (1ULL << FIXED_PROB_BITS) // 1.0 as a FixedProb
+
+/**
+ * Probability stored in fixed point: an unsigned 32 bit multiple of 2^-31, so 1.0 is 2^31. Half the size of a
+ * double, and sums of probabilities are exact integers
+ **/
+typedef uint32_t FixedProb;
+
+/**
+ * Returns a stored value as a double
+ **/
+inline double stored_value(double value){ return value; }
+
+/**
+ * Returns a stored value as a double
+ **/
+inline double stored_value(float value){ return value; }
+
+/**
+ * Returns a stored value as a double, exact for a fixed-point probability
+ **/
+inline double stored_value(FixedProb value){ return value * (1.0 / FIXED_PROB_ONE); }
+
+/**
+ * Stores a value in double precision
+ **/
+inline void store_value(double value, double &out){ out = value; }
+
+/**
+ * Stores a value rounded to the nearest float
+ **/
+inline void store_value(double value, float &out){ out = (float)value; }
+
+/**
+ * Stores a probability rounded to the nearest multiple of 2^-31, clamped to [0, 1]
+ **/
+inline void store_value(double value, FixedProb &out){
+    if (value <= 0)
+        out = 0;
+    else
+        out = (value >= 1) ? (FixedProb)FIXED_PROB_ONE : (FixedProb)(value * FIXED_PROB_ONE + 0.5);
+}
+
+/**
+ * Returns n stored values as doubles, the values themselves when they are stored as doubles
+ **/
+inline const double *stored_values(const double *values, int, std::vector<double> &){ return values; }
+
+/**
+ * Returns n stored values as doubles, converted into out
+ **/
+template <class T>
+const double *stored_values(const T *values, int n, std::vector<double> &out){
+    out.resize(n);
+    for (int i = 0; i < n; i++)
+        out[i] = stored_value(values[i]);
+    return out.data();
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include "Profiler.hpp"
+
+#ifdef BANDIT_PROFILE
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+// Names of the phases in the table and the trace
+static const char *phase_names[PHASE_COUNT] = { "select", "pull", "update", "snapshot", "dump" };
+
+/**
+ * One call of a phase
+ **/
+struct ProfileEvent {
+    uint64_t start, end;
+    int phase;
+};
+
+/**
+ * Counters of one thread, only written by that thread
+ **/
+struct ThreadProfile {
+    int thread;
+    uint64_t calls[PHASE_COUNT];
+    uint64_t cycles[PHASE_COUNT];
+    uint64_t histogram[PHASE_COUNT][PROFILE_BUCKETS];
+    std::vector<ProfileEvent> events;
+};
+
+// Counters of every thread that recorded a call, kept after the thread ends
+static std::mutex profiles_mutex;
+static std::vector<std::unique_ptr<ThreadProfile>> profiles;
+static thread_local ThreadProfile *thread_profile = nullptr;
+
+// Cycles and time when the program started, to turn cycles into microseconds
+static const uint64_t start_cycles = profile_cycles();
+static const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+/**
+ * Returns the counters of the calling thread, registering them on its first call
+ **/
+static ThreadProfile &get_thread_profile(){
+    if (thread_profile == nullptr) {
+        std::unique_ptr<ThreadProfile> profile(new ThreadProfile());
+        profile->events.reserve(PROFILE_MAX_EVENTS);
+
+        std::lock_guard<std::mutex> lock(profiles_mutex);
+        profile->thread = profiles.size();
+        thread_profile = profile.get();
+        profiles.push_back(std::move(profile));
+    }
+    return *thread_profile;
+}
+
+/**
+ * Records one call of a phase that ran from start to end (in cycles) on the calling thread
+ **/
+void Profiler::record(ProfilePhase phase, uint64_t start, uint64_t end){
+    ThreadProfile &profile = get_thread_profile();
+    uint64_t cycles = end - start;
+
+    profile.calls[phase]++;
+    profile.cycles[phase] += cycles;
+
+    // Bucket b holds the calls that took [2^b, 2^(b+1)) cycles
+    int bucket = 63 - __builtin_clzll(cycles | 1);
+    if (bucket >= PROFILE_BUCKETS)
+        bucket = PROFILE_BUCKETS - 1;
+    profile.histogram[phase][bucket]++;
+
+    if (profile.events.size() < PROFILE_MAX_EVENTS) {
+        ProfileEvent event = { start, end, phase };
+        profile.events.push_back(event);
+    }
+}
+
+/**
+ * Prints a table of the phases of every thread merged together and writes the kept events as a
+ * Chrome trace (chrome://tracing or ui.perfetto.dev) to trace_file_name
+ **/
+void Profiler::report(std::ostream &out, const std::string &trace_file_name){
+    std::lock_guard<std::mutex> lock(profiles_mutex);
+
+    uint64_t calls[PHASE_COUNT] = {}, cycles[PHASE_COUNT] = {}, histogram[PHASE_COUNT][PROFILE_BUCKETS] = {};
+    uint64_t total_cycles = 0;
+    for (auto &profile : profiles) {
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            calls[phase] += profile->calls[phase];
+            cycles[phase] += profile->cycles[phase];
+            total_cycles += profile->cycles[phase];
+            for (int bucket = 0; bucket < PROFILE_BUCKETS; bucket++)
+                histogram[phase][bucket] += profile->histogram[phase][bucket];
+        }
+    }
+
+    // Percentiles are the upper bound of the histogram bucket they fall in
+    auto percentile = [&](int phase, double fraction) {
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+            seen += histogram[phase][bucket];
+            if (seen >= fraction * calls[phase])
+                return (uint64_t)2 << bucket;
+        }
+        return (uint64_t)0;
+    };
+
+    out << "\nProfile (" << profiles.size() << " threads, cycles)\n";
+    out << std::left << std::setw(10) << "phase" << std::right << std::setw(14) << "calls" << std::setw(18) << "cycles"
+        << std::setw(10) << "share" << std::setw(12) << "mean" << std::setw(12) << "p50 <=" << std::setw(12) << "p99 <=" << std::endl;
+    out << "----------------------------------------------------------------------------------------" << std::endl;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        if (calls[phase] == 0)
+            continue;
+        out << std::left << std::setw(10) << phase_names[phase] << std::right << std::setw(14) << calls[phase]
+            << std::setw(18) << cycles[phase] << std::fixed << std::setprecision(1)
+            << std::setw(9) << 100.0 * cycles[phase] / total_cycles << "%"
+            << std::setw(12) << (double)cycles[phase] / calls[phase]
+            << std::setw(12) << percentile(phase, 0.5) << std::setw(12) << percentile(phase, 0.99) << std::endl;
+    }
+    out << "----------------------------------------------------------------------------------------" << std::endl;
+
+    // Chrome trace of the kept events, with the cycles turned into microseconds since the start
+    double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count();
+    double cycles_per_us = (profile_cycles() - start_cycles) / elapsed_us;
+
+    std::ofstream trace_file(trace_file_name, std::ofstream::trunc);
+    trace_file << std::fixed << std::setprecision(3);
+    trace_file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (auto &profile : profiles) {
+        for (auto &event : profile->events) {
+            trace_file << (first ? "\n" : ",\n") << "{\"name\":\"" << phase_names[event.phase]
+                       << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << profile->thread
+                       << ",\"ts\":" << (event.start - start_cycles) / cycles_per_us
+                       << ",\"dur\":" << (event.end - event.start) / cycles_per_us << "}";
+            first = false;
+        }
+    }
+    trace_file << "\n]}" << std::endl;
+}
+
+#endif
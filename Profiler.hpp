@@ -0,0 +1,76 @@
+#ifndef PROFILER_CLASS
+#define PROFILER_CLASS
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+
+/**
+ * Profiler of the phases of a round. Building with -DBANDIT_PROFILE (make PROFILE=1) turns the PROFILE_*
+ * macros into per-thread cycle counters, call counts and cycle histograms of every phase. Without it they
+ * expand to nothing, so the instrumented code compiles exactly as if the macros were not there
+ **/
+
+// Phases that are timed
+enum ProfilePhase {
+    PHASE_SELECT,   // Choosing the arm to pull
+    PHASE_PULL,     // Pulling the chosen arm
+    PHASE_UPDATE,   // Updating the estimates or probabilities with the reward
+    PHASE_SNAPSHOT, // Copying a snapshot into the dump writer's ring (simulation thread)
+    PHASE_DUMP,     // Formatting and writing a record to the dump file (writer thread)
+    PHASE_COUNT
+};
+
+// Number of log2 buckets of the cycle histograms
+#define PROFILE_BUCKETS 48
+// Events kept per thread for the Chrome trace, later events are only counted
+#define PROFILE_MAX_EVENTS 100000
+
+#ifdef BANDIT_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+/**
+ * Returns the time stamp counter of the CPU
+ **/
+inline uint64_t profile_cycles(){ return __rdtsc(); }
+#else
+#include <chrono>
+
+/**
+ * Returns a monotonic clock in nanoseconds where the CPU has no time stamp counter
+ **/
+inline uint64_t profile_cycles(){ return std::chrono::steady_clock::now().time_since_epoch().count(); }
+#endif
+
+/**
+ * Collects the timings of every thread and reports them
+ **/
+class Profiler {
+    public:
+        /**
+         * Records one call of a phase that ran from start to end (in cycles) on the calling thread
+         **/
+        static void record(ProfilePhase phase, uint64_t start, uint64_t end);
+
+        /**
+         * Prints a table of the phases of every thread merged together and writes the kept events as a
+         * Chrome trace (chrome://tracing or ui.perfetto.dev) to trace_file_name
+         **/
+        static void report(std::ostream &out, const std::string &trace_file_name);
+};
+
+#define PROFILE_BEGIN(phase) uint64_t profile_start_##phase = profile_cycles()
+#define PROFILE_END(phase) Profiler::record(phase, profile_start_##phase, profile_cycles())
+#define PROFILE_REPORT(out, trace_file_name) Profiler::report(out, trace_file_name)
+
+#else
+
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+#define PROFILE_REPORT(out, trace_file_name)
+
+#endif
+
+#endif
@@ -0,0 +1,42 @@
+#include "RewardTape.hpp"
+
+/**
+ * Constructor of an empty tape
+ **/
+RewardTape::RewardTape()
+:num_of_arms(0)
+,length(0)
+,words_per_arm(0) {}
+
+/**
+ * Generates length rewards for each of the n arms with the given probabilities from the stream r.
+ * The tape takes n * length / 8 bytes and is only reallocated when it grows
+ **/
+void RewardTape::generate(const double *probs, int n, int len, Rng r){
+    num_of_arms = n;
+    length = len;
+    words_per_arm = (len + 63) / 64;
+    bits.resize(num_of_arms * words_per_arm);
+
+    for (int arm = 0; arm < num_of_arms; arm++) {
+        Rng rng = r.fork(arm);
+        double p = probs[arm] < 0 ? 0 : (probs[arm] > 1 ? 1 : probs[arm]);
+        uint64_t threshold = (uint64_t)(p * 4294967296.0);
+        uint64_t *row = &bits[arm * words_per_arm];
+
+        for (int word = 0; word < words_per_arm; word++) {
+            if (threshold >= 4294967296ULL) {
+                row[word] = ~0ULL;
+                continue;
+            }
+
+            // Below the lowest set bit of the threshold the word stays 0, so start there
+            uint64_t value = 0;
+            for (int bit = (threshold == 0) ? 32 : __builtin_ctzll(threshold); bit < 32; bit++) {
+                uint64_t random = rng.next_u64();
+                value = ((threshold >> bit) & 1) ? (value | random) : (value & random);
+            }
+            row[word] = value;
+        }
+    }
+}
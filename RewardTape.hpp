@@ -0,0 +1,50 @@
+#ifndef REWARDTAPE_CLASS
+#define REWARDTAPE_CLASS
+
+#include <vector>
+#include <cstdint>
+#include "Rng.hpp"
+
+/**
+ * Pre-generated rewards of an environment (common random numbers): bit k of the tape of an arm is the
+ * reward of the k-th pull of that arm. Every agent and configuration replaying the tape gets the same reward
+ * for the same pull, so differences between them are not drowned in reward noise.
+ *
+ * The bits of an arm are generated 64 at a time: with t = p * 2^32, a word of independent Bernoulli(p) bits
+ * is built from the lowest set bit of t up with word = bit ? (word | random) : (word & random), so a word
+ * costs at most 32 random draws instead of 64 comparisons. Arm i uses the stream r.fork(i), so a longer
+ * tape starts with the bits of a shorter one
+ **/
+class RewardTape {
+    private:
+        // Number of arms, pulls recorded per arm and 64 bit words per arm
+        int num_of_arms, length, words_per_arm;
+        // Rewards of every arm, one row of words per arm
+        std::vector<uint64_t> bits;
+
+    public:
+        /**
+         * Constructor of an empty tape
+         **/
+        RewardTape();
+
+        /**
+         * Generates length rewards for each of the n arms with the given probabilities from the stream r.
+         * The tape takes n * length / 8 bytes and is only reallocated when it grows
+         **/
+        void generate(const double *probs, int n, int len, Rng r);
+
+        /**
+         * Returns the number of pulls recorded per arm
+         **/
+        int get_length() const { return length; }
+
+        /**
+         * Returns the reward (0 or 1) of the given pull (0 based) of an arm
+         **/
+        int reward(int arm, int pull) const {
+            return (bits[arm * words_per_arm + (pull >> 6)] >> (pull & 63)) & 1;
+        }
+};
+
+#endif
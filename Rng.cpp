@@ -0,0 +1,76 @@
+#include "Rng.hpp"
+#include <cmath>
+
+/**
+ * Constructor that takes the key of the stream
+ **/
+Rng::Rng(uint64_t seed, uint64_t config, uint64_t env, uint64_t agent)
+:key(mix(mix(mix(mix(seed) + config) + env) + agent))
+,counter(0) {}
+
+
+/**
+ * Returns a new stream whose key is derived from the key of this stream and the given index
+ **/
+Rng Rng::fork(uint64_t stream) const {
+    Rng child;
+    child.key = mix(key + stream + 1);
+    return child;
+}
+
+/**
+ * Returns a Binomial(n, p) draw. Small means are drawn by inversion from 0, larger ones by inversion
+ * searching outwards from the mode, so a draw takes O(1 + sqrt(n p (1 - p))) values of the stream
+ * and only depends on the stream, not on the standard library
+ **/
+int Rng::next_binomial(int n, double p){
+    if (n <= 0 || p <= 0)
+        return 0;
+    if (p >= 1)
+        return n;
+    // The number of failures of the complement keeps p at most 1/2
+    if (p > 0.5)
+        return n - next_binomial(n, 1.0 - p);
+
+    double q = 1.0 - p, ratio = p / q;
+    double u = next_double();
+    if (n * p < RNG_BINOMIAL_SEARCH_MEAN) {
+        // Walk up the probabilities from P(0) = q^n until they add up to u
+        double prob = pow(q, n);
+        for (int k = 0; k < n; k++) {
+            if (u < prob)
+                return k;
+            u -= prob;
+            prob *= ratio * (n - k) / (k + 1);
+        }
+        return n;
+    }
+
+    // Walk outwards from the mode, one step up and one step down at a time, until the probabilities add up to u
+    int mode = (int)((n + 1) * p);
+    double prob_mode = exp(lgamma(n + 1.0) - lgamma(mode + 1.0) - lgamma(n - mode + 1.0) + mode * log(p) +
+                           (n - mode) * log1p(-p));
+    if (u < prob_mode)
+        return mode;
+    u -= prob_mode;
+    int up = mode, down = mode;
+    double prob_up = prob_mode, prob_down = prob_mode;
+    while (up < n || down > 0) {
+        if (up < n) {
+            prob_up *= ratio * (n - up) / (up + 1);
+            up++;
+            if (u < prob_up)
+                return up;
+            u -= prob_up;
+        }
+        if (down > 0) {
+            prob_down *= (double)down / ((n - down + 1) * ratio);
+            down--;
+            if (u < prob_down)
+                return down;
+            u -= prob_down;
+        }
+    }
+    // Rounding left u above the total, the mode is as good as any
+    return mode;
+}
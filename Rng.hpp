@@ -0,0 +1,102 @@
+#ifndef RNG_CLASS
+#define RNG_CLASS
+
+#include <cstdint>
+#define RNG_BINOMIAL_SEARCH_MEAN 30 // Below this mean a binomial draw searches up from 0, from it on outwards from the mode
+
+/**
+ * Counter based random number stream. Every stream is keyed by (seed, config, env, agent) and the
+ * n-th value of a stream only depends on its key and n, so runs are reproducible no matter how
+ * many threads or processes share the work
+ **/
+class Rng {
+    private:
+        // Key of the stream
+        uint64_t key;
+        // Number of values drawn from the stream
+        uint64_t counter;
+
+        /**
+         * SplitMix64 finalizer, maps a 64 bit value to a well mixed 64 bit value
+         **/
+        static uint64_t mix(uint64_t z) {
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+    public:
+        // The stream is a uniform random bit generator, its draws are spelled out below so they do not depend on the library
+        typedef uint64_t result_type;
+        static constexpr uint64_t min() { return 0; }
+        static constexpr uint64_t max() { return ~0ULL; }
+
+        /**
+         * Constructor that takes the key of the stream
+         **/
+        Rng(uint64_t seed = 0, uint64_t config = 0, uint64_t env = 0, uint64_t agent = 0);
+
+        /**
+         * Returns the next 64 random bits of the stream
+         **/
+        uint64_t next_u64() { return mix(key + (++counter) * 0x9e3779b97f4a7c15ULL); }
+
+        /**
+         * Same as next_u64, for code that takes a uniform random bit generator
+         **/
+        uint64_t operator()() { return next_u64(); }
+
+        /**
+         * Returns the next random double in [0, 1)
+         **/
+        double next_double() { return (int64_t)(next_u64() >> 11) * (1.0 / 9007199254740992.0); }
+
+        /**
+         * Writes the next n values of the stream to out, the same values as n calls of next_u64. Every value
+         * only depends on the key and its counter, so the loop has no dependency between iterations
+         **/
+        void fill(uint64_t *out, int n) {
+            for (int i = 0; i < n; i++)
+                out[i] = mix(key + (counter + i + 1) * 0x9e3779b97f4a7c15ULL);
+            counter += n;
+        }
+
+        /**
+         * Skips the next n values of the stream, so parts of a long fill can be drawn by different threads
+         **/
+        void skip(uint64_t n) { counter += n; }
+
+        /**
+         * Returns the integer threshold of a Bernoulli(p) draw: next_bernoulli(bernoulli_threshold(p)) is 1
+         * exactly when next_double() <= p would be, without the conversion to double
+         **/
+        static uint64_t bernoulli_threshold(double p) {
+            if (p < 0)
+                return 0;
+            return (p >= 1) ? (1ULL << 53) + 1 : (uint64_t)(p * 9007199254740992.0) + 1;
+        }
+
+        /**
+         * Returns 1 with the probability whose threshold is given (see bernoulli_threshold), otherwise 0
+         **/
+        int next_bernoulli(uint64_t threshold) { return ((next_u64() >> 11) < threshold) ? 1 : 0; }
+
+        /**
+         * Returns the Bernoulli draw of a value taken from fill with the given threshold
+         **/
+        static int bernoulli(uint64_t value, uint64_t threshold) { return ((value >> 11) < threshold) ? 1 : 0; }
+
+        /**
+         * Returns a Binomial(n, p) draw. Small means are drawn by inversion from 0, larger ones by inversion
+         * searching outwards from the mode, so a draw takes O(1 + sqrt(n p (1 - p))) values of the stream
+         * and only depends on the stream, not on the standard library
+         **/
+        int next_binomial(int n, double p);
+
+        /**
+         * Returns a new stream whose key is derived from the key of this stream and the given index
+         **/
+        Rng fork(uint64_t stream) const;
+};
+
+#endif
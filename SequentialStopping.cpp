@@ -0,0 +1,143 @@
+#include "SequentialStopping.hpp"
+#include <cmath>
+#include <algorithm>
+
+/**
+ * Constructor that takes the number of configurations and metrics, the environments available per
+ * configuration, the environments of the first and of every later wave, the target width of the
+ * confidence intervals and whether losing configurations are dropped
+ **/
+SequentialStopping::SequentialStopping(int configs, int metrics, int max_e, int min_e, int wave_e, double width,
+                                       bool drop)
+:num_of_configs(configs)
+,num_of_metrics(metrics)
+,max_envs(max_e)
+,min_envs(std::max(min_e, 2))
+,wave_envs(std::max(wave_e, 1))
+,target_width(width)
+,drop_losers(drop)
+,used(configs, 0)
+,target(configs, 0)
+,mean(configs * metrics, 0)
+,m2(configs * metrics, 0)
+,states(configs, ACTIVE) {}
+
+/**
+ * Returns the half width of the confidence interval of a metric of a configuration
+ **/
+double SequentialStopping::half_width(int config, int metric){
+    int n = used[config];
+    if (n < 2)
+        return INFINITY;
+    return SEQ_STOP_Z * sqrt(m2[config * num_of_metrics + metric] / (n - 1) / n);
+}
+
+/**
+ * Forgets every wave, the next one starts again from the first environment
+ **/
+void SequentialStopping::restart(){
+    std::fill(used.begin(), used.end(), 0);
+    std::fill(target.begin(), target.end(), 0);
+    std::fill(mean.begin(), mean.end(), 0);
+    std::fill(m2.begin(), m2.end(), 0);
+    std::fill(states.begin(), states.end(), ACTIVE);
+}
+
+/**
+ * Starts the next wave, returns false when every configuration has stopped
+ **/
+bool SequentialStopping::next_wave(){
+    bool any = false;
+    for (int config = 0; config < num_of_configs; config++) {
+        if (states[config] != ACTIVE)
+            continue;
+        target[config] = std::min(used[config] + (used[config] == 0 ? min_envs : wave_envs), max_envs);
+        any = true;
+    }
+    return any;
+}
+
+/**
+ * Returns the first environment of the current wave of a configuration
+ **/
+int SequentialStopping::wave_begin(int config){ return used[config]; }
+
+/**
+ * Returns the environment after the last one of the current wave of a configuration (equal to
+ * wave_begin when the configuration has stopped)
+ **/
+int SequentialStopping::wave_end(int config){ return (states[config] == ACTIVE) ? target[config] : used[config]; }
+
+/**
+ * Adds the values of the current wave and decides which configurations stop. values[metric] holds the
+ * values of a metric of every environment, index = config * max_envs + env
+ **/
+void SequentialStopping::end_wave(const std::vector<const double *> &values){
+    for (int config = 0; config < num_of_configs; config++) {
+        if (states[config] != ACTIVE)
+            continue;
+
+        // Welford's update with every new environment, in order
+        for (int env = used[config]; env < target[config]; env++) {
+            int n = env + 1;
+            for (int metric = 0; metric < num_of_metrics; metric++) {
+                int i = config * num_of_metrics + metric;
+                double value = values[metric][config * max_envs + env];
+                double delta = value - mean[i];
+                mean[i] += delta / n;
+                m2[i] += delta * (value - mean[i]);
+            }
+        }
+        used[config] = target[config];
+
+        bool converged = true;
+        for (int metric = 0; metric < num_of_metrics; metric++)
+            converged = converged && 2 * half_width(config, metric) <= target_width;
+        if (converged)
+            states[config] = CONVERGED;
+        else if (used[config] >= max_envs)
+            states[config] = EXHAUSTED;
+    }
+
+    if (!drop_losers)
+        return;
+
+    // Best configuration by the mean of the first metric among those not dropped
+    int best = -1;
+    for (int config = 0; config < num_of_configs; config++) {
+        if (states[config] == DROPPED)
+            continue;
+        if (best == -1 || mean[config * num_of_metrics] > mean[best * num_of_metrics])
+            best = config;
+    }
+
+    for (int config = 0; config < num_of_configs; config++) {
+        if (states[config] != ACTIVE || config == best)
+            continue;
+        if (mean[config * num_of_metrics] + half_width(config, 0) <
+            mean[best * num_of_metrics] - half_width(best, 0))
+            states[config] = DROPPED;
+    }
+}
+
+/**
+ * Returns the number of environments a configuration used
+ **/
+int SequentialStopping::get_used(int config){ return used[config]; }
+
+/**
+ * Returns the state of a configuration
+ **/
+SequentialStopping::State SequentialStopping::get_state(int config){ return states[config]; }
+
+/**
+ * Returns the name of a state as printed in the stats
+ **/
+std::string SequentialStopping::state_name(State state){
+    switch (state) {
+        case ACTIVE: return "active";
+        case CONVERGED: return "converged";
+        case DROPPED: return "dropped";
+        default: return "all envs";
+    }
+}
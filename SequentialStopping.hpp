@@ -0,0 +1,96 @@
+#ifndef SEQUENTIALSTOPPING_CLASS
+#define SEQUENTIALSTOPPING_CLASS
+
+#include <vector>
+#include <string>
+
+#define SEQ_STOP_Z 1.96 // Normal quantile of the confidence intervals (95%)
+
+/**
+ * Decides how many environments every configuration of a sweep needs. Environments are added in waves, and
+ * after every wave the running mean and variance of every metric of a configuration (e.g. % reward of
+ * each agent) give a confidence interval per metric. A configuration stops once every interval is narrower
+ * than the target width (a negative width never stops early), when it used every environment, or, when
+ * dropping is on, once the interval of its first metric lies entirely below the interval of the
+ * configuration with the best mean.
+ *
+ * Values are added in environment order and decisions are only taken between waves, so the environments a
+ * configuration uses do not depend on the number of threads
+ **/
+class SequentialStopping {
+    public:
+        // State of a configuration
+        enum State { ACTIVE, CONVERGED, DROPPED, EXHAUSTED };
+
+    private:
+        // Number of configurations and metrics, environments available per configuration, environments
+        // of the first wave and of every later one
+        int num_of_configs, num_of_metrics, max_envs, min_envs, wave_envs;
+        // Width of the confidence interval at which a configuration stops
+        double target_width;
+        // Should configurations that clearly lose be dropped?
+        bool drop_losers;
+        // Environments whose values were added and environments the current wave runs up to
+        std::vector<int> used, target;
+        // Running mean and sum of squared deviations, index = config * num_of_metrics + metric
+        std::vector<double> mean, m2;
+        // State of every configuration
+        std::vector<State> states;
+
+        /**
+         * Returns the half width of the confidence interval of a metric of a configuration
+         **/
+        double half_width(int config, int metric);
+
+    public:
+        /**
+         * Constructor that takes the number of configurations and metrics, the environments available per
+         * configuration, the environments of the first and of every later wave, the target width of the
+         * confidence intervals and whether losing configurations are dropped
+         **/
+        SequentialStopping(int configs, int metrics, int max_e, int min_e, int wave_e, double width, bool drop);
+
+        /**
+         * Forgets every wave, the next one starts again from the first environment
+         **/
+        void restart();
+
+        /**
+         * Starts the next wave, returns false when every configuration has stopped
+         **/
+        bool next_wave();
+
+        /**
+         * Returns the first environment of the current wave of a configuration
+         **/
+        int wave_begin(int config);
+
+        /**
+         * Returns the environment after the last one of the current wave of a configuration (equal to
+         * wave_begin when the configuration has stopped)
+         **/
+        int wave_end(int config);
+
+        /**
+         * Adds the values of the current wave and decides which configurations stop. values[metric] holds the
+         * values of a metric of every environment, index = config * max_envs + env
+         **/
+        void end_wave(const std::vector<const double *> &values);
+
+        /**
+         * Returns the number of environments a configuration used
+         **/
+        int get_used(int config);
+
+        /**
+         * Returns the state of a configuration
+         **/
+        State get_state(int config);
+
+        /**
+         * Returns the name of a state as printed in the stats
+         **/
+        static std::string state_name(State state);
+};
+
+#endif
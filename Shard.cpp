@@ -0,0 +1,334 @@
+#include "Shard.hpp"
+#include "ShardCoordinator.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <ctime>
+#include <unistd.h>
+
+/**
+ * Constructor that parses the command line, prefix names the result files (e.g. q1)
+ **/
+ShardRun::ShardRun(int argc, char **argv, const std::string &prefix)
+:mode(RUN)
+,program(argv[0])
+,prefix(prefix)
+,num_of_configs(1)
+,num_of_envs(1)
+,configs_per_shard(1)
+,envs_per_shard(1)
+,shard_index(-1)
+,num_of_workers(0)
+,connection(-1)
+,seed(0)
+,valid(true)
+,handed_out(false)
+,coordinated(false) {
+    for (int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        bool has_value = (i + 1 < argc && argv[i + 1][0] != '-');
+
+        if (arg == "--shard" && has_value && mode == RUN) {
+            mode = SHARD;
+            shard_index = atoi(argv[++i]);
+        } else if (arg == "--merge" && mode == RUN) {
+            mode = MERGE;
+            while (i + 1 < argc && argv[i + 1][0] != '-')
+                merge_files.push_back(argv[++i]);
+        } else if (arg == "--coordinate" && mode == RUN) {
+            mode = COORDINATE;
+            if (has_value)
+                num_of_workers = atoi(argv[++i]);
+        } else if (arg == "--worker" && has_value && mode == RUN) {
+            mode = WORKER;
+            socket_path = argv[++i];
+        } else if (arg == "--seed" && has_value) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else {
+            valid = false;
+        }
+    }
+
+    if (!valid)
+        std::cerr << "Usage: " << program << " [--shard i | --merge [files] | --coordinate [workers]] [--seed s]"
+                  << std::endl;
+}
+
+/**
+ * Closes the connection to the coordinator
+ **/
+ShardRun::~ShardRun(){
+    if (connection >= 0)
+        close(connection);
+}
+
+/**
+ * Returns false when the command line was not understood (the usage has been printed) or the shard to run
+ * could not be taken
+ **/
+bool ShardRun::is_valid(){
+    return valid;
+}
+
+/**
+ * Returns what the process does
+ **/
+ShardRun::Mode ShardRun::get_mode(){
+    return mode;
+}
+
+/**
+ * Returns true when the process only runs shards and writes their results, without stats
+ **/
+bool ShardRun::is_partial(){
+    return mode == SHARD || mode == WORKER;
+}
+
+/**
+ * Returns the seed of the sweep: the one given with --seed, otherwise the configured one, otherwise the
+ * time. A shard run alone returns 0 instead of the time, its seed has to match the other shards
+ **/
+unsigned long ShardRun::get_seed(unsigned long configured){
+    if (seed == 0)
+        seed = configured;
+    if (seed == 0 && mode != SHARD)
+        seed = time(NULL);
+    return seed;
+}
+
+/**
+ * Sets the grid of the sweep and the size of its shards (at least 1 x 1)
+ **/
+void ShardRun::set_grid(int configs, int envs, int configs_shard, int envs_shard){
+    num_of_configs = configs;
+    num_of_envs = envs;
+    configs_per_shard = std::max(1, std::min(configs_shard, configs));
+    envs_per_shard = std::max(1, std::min(envs_shard, envs));
+}
+
+/**
+ * Returns the number of shards of the grid
+ **/
+int ShardRun::get_num_of_shards(){
+    int config_blocks = (num_of_configs + configs_per_shard - 1) / configs_per_shard;
+    int env_blocks = (num_of_envs + envs_per_shard - 1) / envs_per_shard;
+    return config_blocks * env_blocks;
+}
+
+/**
+ * Returns the configurations and environments of a shard
+ **/
+Shard ShardRun::get_shard(int index){
+    int env_blocks = (num_of_envs + envs_per_shard - 1) / envs_per_shard;
+    Shard shard;
+    shard.first_config = (index / env_blocks) * configs_per_shard;
+    shard.num_of_configs = std::min(configs_per_shard, num_of_configs - shard.first_config);
+    shard.first_env = (index % env_blocks) * envs_per_shard;
+    shard.num_of_envs = std::min(envs_per_shard, num_of_envs - shard.first_env);
+    return shard;
+}
+
+/**
+ * Returns the name of the result file of a shard
+ **/
+std::string ShardRun::shard_file_name(int index){
+    std::ostringstream name;
+    name << prefix << "_shard_" << index;
+    return name.str();
+}
+
+/**
+ * Takes the next shard to run, returns false when there is none left: the whole grid once for RUN,
+ * the given shard once for SHARD, the shards of the coordinator for WORKER and none otherwise
+ **/
+bool ShardRun::next(Shard &shard){
+    if (mode == RUN || mode == SHARD) {
+        if (handed_out)
+            return false;
+        handed_out = true;
+
+        if (mode == RUN) {
+            shard.first_config = 0;
+            shard.num_of_configs = num_of_configs;
+            shard.first_env = 0;
+            shard.num_of_envs = num_of_envs;
+            return true;
+        }
+        if (shard_index < 0 || shard_index >= get_num_of_shards()) {
+            std::cerr << "Shard " << shard_index << " out of range, the sweep has " << get_num_of_shards()
+                      << " shards" << std::endl;
+            valid = false;
+            return false;
+        }
+        shard = get_shard(shard_index);
+        return true;
+    }
+
+    if (mode == WORKER) {
+        if (connection < 0)
+            connection = shard_connect(socket_path);
+        if (connection < 0) {
+            valid = false;
+            return false;
+        }
+
+        shard_index = shard_receive(connection);
+        if (shard_index < 0 || shard_index >= get_num_of_shards())
+            return false;
+        shard = get_shard(shard_index);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Writes the results of a shard that ran and tells the coordinator (SHARD and WORKER only).
+ * results are arrays indexed by config * num_of_envs + env, only the entries of the shard are written
+ **/
+bool ShardRun::finish(const Shard &shard, const std::vector<std::vector<double> *> &results){
+    if (!is_partial())
+        return true;
+
+    // Write to a temporary file first so that a worker that crashes never leaves half a result behind
+    std::string file_name = shard_file_name(shard_index);
+    std::string temp_name = file_name + ".tmp";
+    {
+        std::ofstream file(temp_name, std::ofstream::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Cannot write " << temp_name << std::endl;
+            return false;
+        }
+
+        file << "# " << prefix << " shard " << shard_index << "\n";
+        file << "seed " << seed << "\n";
+        file << "grid " << num_of_configs << " " << num_of_envs << " " << configs_per_shard << " " << envs_per_shard
+             << "\n";
+        file << "columns " << results.size() << "\n";
+        file << std::setprecision(17);
+        for (int config = shard.first_config; config < shard.first_config + shard.num_of_configs; config++) {
+            for (int env = shard.first_env; env < shard.first_env + shard.num_of_envs; env++) {
+                file << config << " " << env;
+                for (size_t column = 0; column < results.size(); column++)
+                    file << " " << (*results[column])[config * num_of_envs + env];
+                file << "\n";
+            }
+        }
+        if (!file.good())
+            return false;
+    }
+    if (rename(temp_name.c_str(), file_name.c_str()) != 0)
+        return false;
+
+    return mode != WORKER || shard_report(connection, shard_index);
+}
+
+/**
+ * Reads the results of every shard into results, returns false when a file is missing, belongs to
+ * another sweep or another split of it, or some environment has no result. The files of a coordinator
+ * are removed once merged
+ **/
+bool ShardRun::merge(const std::vector<std::vector<double> *> &results){
+    std::vector<std::string> files = merge_files;
+    if (files.empty())
+        for (int i = 0; i < get_num_of_shards(); i++)
+            files.push_back(shard_file_name(i));
+
+    std::vector<bool> found(num_of_configs * num_of_envs, false), merged(get_num_of_shards(), false);
+    unsigned long sweep_seed = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        std::ifstream file(files[i]);
+        if (!file.is_open()) {
+            std::cerr << "Cannot read " << files[i] << std::endl;
+            return false;
+        }
+
+        std::string line, key, file_prefix;
+        unsigned long file_seed = 0;
+        int index = -1, configs = 0, envs = 0, configs_shard = 0, envs_shard = 0;
+        size_t columns = 0;
+        std::getline(file, line);
+        std::istringstream title(line);
+        title >> key >> file_prefix >> key >> index;
+        file >> key >> file_seed >> key >> configs >> envs >> configs_shard >> envs_shard >> key >> columns;
+        if (!file || !title || file_prefix != prefix || configs != num_of_configs || envs != num_of_envs ||
+            columns != results.size()) {
+            std::cerr << files[i] << " is not a shard of this sweep" << std::endl;
+            return false;
+        }
+
+        // The shard has to be one of the current split, and only once
+        if (configs_shard != configs_per_shard || envs_shard != envs_per_shard || index < 0 ||
+            index >= get_num_of_shards()) {
+            std::cerr << files[i] << " is shard " << index << " of shards of " << configs_shard << " x "
+                      << envs_shard << ", the sweep is split into shards of " << configs_per_shard << " x "
+                      << envs_per_shard << std::endl;
+            return false;
+        }
+        if (merged[index]) {
+            std::cerr << files[i] << " holds shard " << index << " again" << std::endl;
+            return false;
+        }
+        merged[index] = true;
+        Shard shard = get_shard(index);
+        if (i > 0 && file_seed != sweep_seed) {
+            std::cerr << files[i] << " was run with seed " << file_seed << " instead of " << sweep_seed << std::endl;
+            return false;
+        }
+        sweep_seed = file_seed;
+
+        int config, env;
+        while (file >> config >> env) {
+            if (config < shard.first_config || config >= shard.first_config + shard.num_of_configs ||
+                env < shard.first_env || env >= shard.first_env + shard.num_of_envs) {
+                std::cerr << files[i] << " has an environment out of its shard" << std::endl;
+                return false;
+            }
+            for (size_t column = 0; column < results.size(); column++)
+                file >> (*results[column])[config * num_of_envs + env];
+            found[config * num_of_envs + env] = true;
+        }
+    }
+
+    int missing = 0;
+    for (size_t i = 0; i < found.size(); i++)
+        if (!found[i])
+            missing++;
+    if (missing > 0) {
+        std::cerr << missing << " environments have no result in the shards" << std::endl;
+        return false;
+    }
+
+    // The results of the workers of this process are merged, nothing needs them any more
+    if (coordinated)
+        for (size_t i = 0; i < files.size(); i++)
+            unlink(files[i].c_str());
+    return true;
+}
+
+/**
+ * Runs every shard on num_of_workers worker processes (this program with --worker) with the given
+ * seed, and turns the run into a merge of their results. Returns false when some shard failed
+ **/
+bool ShardRun::coordinate(unsigned long sweep_seed){
+    std::vector<std::string> worker_args;
+    worker_args.push_back("--seed");
+    worker_args.push_back(std::to_string(sweep_seed));
+    worker_args.push_back("--worker");
+
+    int workers = num_of_workers;
+    if (workers <= 0)
+        workers = std::max(1, (int)sysconf(_SC_NPROCESSORS_ONLN));
+
+    ShardCoordinator coordinator(program, worker_args);
+    if (!coordinator.run(get_num_of_shards(), workers))
+        return false;
+
+    mode = MERGE;
+    merge_files.clear();
+    coordinated = true;
+    return true;
+}
@@ -0,0 +1,129 @@
+#ifndef SHARD_CLASS
+#define SHARD_CLASS
+
+#include <vector>
+#include <string>
+
+/**
+ * Block of a sweep: a range of configurations times a range of environments
+ **/
+struct Shard {
+    int first_config, num_of_configs, first_env, num_of_envs;
+};
+
+/**
+ * How one process of a driver takes part in a sweep, from its command line:
+ *
+ *      (no arguments)              runs the whole sweep
+ *      --shard i                   runs shard i and writes its results to <prefix>_shard_i
+ *      --merge [files]             reads the results of every shard (<prefix>_shard_0... by default)
+ *                                  instead of running them, then prints the stats
+ *      --coordinate [workers]      runs every shard on worker processes, then merges them
+ *      --worker socket             runs the shards handed out by a coordinator (started by it)
+ *      --seed s                    seed of the sweep, needed by --shard when the configured seed is 0
+ *
+ * The sweep is split into shards of configs_per_shard configurations x envs_per_shard environments, in
+ * configuration major order. Every environment is keyed by (seed, config, env) no matter which process runs
+ * it, so the shards of one seed merge into exactly the results of a single process
+ **/
+class ShardRun {
+    public:
+        // What the process does
+        enum Mode { RUN, SHARD, MERGE, COORDINATE, WORKER };
+
+    private:
+        Mode mode;
+        // Path of the program (to start workers), prefix of the result files and socket of the coordinator
+        std::string program, prefix, socket_path;
+        // Grid of the sweep and its split into shards
+        int num_of_configs, num_of_envs, configs_per_shard, envs_per_shard;
+        // Shard of --shard, workers of --coordinate, connection of a worker (-1 when there is none)
+        int shard_index, num_of_workers, connection;
+        // Seed given with --seed, 0 when there is none
+        unsigned long seed;
+        // Result files of --merge
+        std::vector<std::string> merge_files;
+        // Was the command line understood (and the shard taken), was the only shard of RUN or SHARD handed out,
+        // and did this process write the result files as a coordinator (they are removed once merged)?
+        bool valid, handed_out, coordinated;
+
+        /**
+         * Returns the name of the result file of a shard
+         **/
+        std::string shard_file_name(int index);
+
+    public:
+        /**
+         * Constructor that parses the command line, prefix names the result files (e.g. q1)
+         **/
+        ShardRun(int argc, char **argv, const std::string &prefix);
+
+        /**
+         * Closes the connection to the coordinator
+         **/
+        ~ShardRun();
+
+        /**
+         * Returns false when the command line was not understood (the usage has been printed) or the shard to run
+         * could not be taken
+         **/
+        bool is_valid();
+
+        /**
+         * Returns what the process does
+         **/
+        Mode get_mode();
+
+        /**
+         * Returns true when the process only runs shards and writes their results, without stats
+         **/
+        bool is_partial();
+
+        /**
+         * Returns the seed of the sweep: the one given with --seed, otherwise the configured one, otherwise the
+         * time. A shard run alone returns 0 instead of the time, its seed has to match the other shards
+         **/
+        unsigned long get_seed(unsigned long configured);
+
+        /**
+         * Sets the grid of the sweep and the size of its shards (at least 1 x 1)
+         **/
+        void set_grid(int configs, int envs, int configs_shard, int envs_shard);
+
+        /**
+         * Returns the number of shards of the grid
+         **/
+        int get_num_of_shards();
+
+        /**
+         * Returns the configurations and environments of a shard
+         **/
+        Shard get_shard(int index);
+
+        /**
+         * Takes the next shard to run, returns false when there is none left: the whole grid once for RUN,
+         * the given shard once for SHARD, the shards of the coordinator for WORKER and none otherwise
+         **/
+        bool next(Shard &shard);
+
+        /**
+         * Writes the results of a shard that ran and tells the coordinator (SHARD and WORKER only).
+         * results are arrays indexed by config * num_of_envs + env, only the entries of the shard are written
+         **/
+        bool finish(const Shard &shard, const std::vector<std::vector<double> *> &results);
+
+        /**
+         * Reads the results of every shard into results, returns false when a file is missing, belongs to
+         * another sweep or another split of it, or some environment has no result. The files of a coordinator
+         * are removed once merged
+         **/
+        bool merge(const std::vector<std::vector<double> *> &results);
+
+        /**
+         * Runs every shard on num_of_workers worker processes (this program with --worker) with the given
+         * seed, and turns the run into a merge of their results. Returns false when some shard failed
+         **/
+        bool coordinate(unsigned long sweep_seed);
+};
+
+#endif
@@ -0,0 +1,283 @@
+#include "ShardCoordinator.hpp"
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <algorithm>
+#include <cstdlib>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+/**
+ * Sends a line to a connection, returns false when it is closed
+ **/
+static bool send_line(int fd, const std::string &line){
+    std::string message = line + "\n";
+    size_t sent = 0;
+    while (sent < message.size()) {
+        ssize_t n = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+/**
+ * Reads a line from a connection, returns false when it closes first
+ **/
+static bool receive_line(int fd, std::string &line){
+    line.clear();
+    char c;
+    for (;;) {
+        ssize_t n = recv(fd, &c, 1, 0);
+        if (n <= 0)
+            return false;
+        if (c == '\n')
+            return true;
+        line += c;
+    }
+}
+
+/**
+ * Constructor that takes the program started as a worker and its arguments before the socket path
+ **/
+ShardCoordinator::ShardCoordinator(const std::string &program, const std::vector<std::string> &worker_args)
+:program(program)
+,worker_args(worker_args)
+,listen_fd(-1)
+,num_of_done(0) {}
+
+/**
+ * Closes the socket and stops the workers that still run
+ **/
+ShardCoordinator::~ShardCoordinator(){
+    for (size_t i = 0; i < connections.size(); i++)
+        close(connections[i].fd);
+    for (size_t i = 0; i < workers.size(); i++) {
+        kill(workers[i], SIGTERM);
+        waitpid(workers[i], NULL, 0);
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+    if (!socket_dir.empty())
+        rmdir(socket_dir.c_str());
+}
+
+/**
+ * Starts a worker process, returns false when fork fails. The worker runs the executable of this
+ * process (/proc/self/exe) with program as argv[0], or program looked up in the PATH without /proc
+ **/
+bool ShardCoordinator::spawn(){
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+
+    if (pid == 0) {
+        std::vector<char *> args;
+        args.push_back(const_cast<char *>(program.c_str()));
+        for (size_t i = 0; i < worker_args.size(); i++)
+            args.push_back(const_cast<char *>(worker_args[i].c_str()));
+        args.push_back(const_cast<char *>(socket_path.c_str()));
+        args.push_back(NULL);
+        execv("/proc/self/exe", &args[0]);
+        execvp(program.c_str(), &args[0]);
+        _exit(127);
+    }
+
+    workers.push_back(pid);
+    return true;
+}
+
+/**
+ * Gives a connection the next shard of the queue, or tells it to exit when the queue is empty.
+ * Returns false when a shard was handed out too often
+ **/
+bool ShardCoordinator::assign(Connection &connection){
+    connection.shard = -1;
+    if (queue.empty()) {
+        send_line(connection.fd, "exit");
+        return true;
+    }
+
+    int shard = queue.front();
+    if (++attempts[shard] > SHARD_MAX_ATTEMPTS) {
+        std::cerr << "Shard " << shard << " failed " << SHARD_MAX_ATTEMPTS << " times" << std::endl;
+        return false;
+    }
+    queue.erase(queue.begin());
+
+    std::ostringstream line;
+    line << "shard " << shard;
+    connection.shard = shard;
+    if (!send_line(connection.fd, line.str()))
+        release(connection);
+    return true;
+}
+
+/**
+ * Puts the shard of a connection that closed back in the queue
+ **/
+void ShardCoordinator::release(Connection &connection){
+    if (connection.shard >= 0 && !done[connection.shard]) {
+        std::cerr << "Worker lost shard " << connection.shard << ", handing it out again" << std::endl;
+        queue.insert(queue.begin(), connection.shard);
+    }
+    connection.shard = -1;
+}
+
+/**
+ * Runs num_of_shards shards on up to num_of_workers workers, returns true once every shard is done
+ **/
+bool ShardCoordinator::run(int num_of_shards, int num_of_workers){
+    // The socket lives in a new directory only this user can enter, so no one else can take its name
+    // or connect to it
+    char dir_template[] = "/tmp/bandit_shards_XXXXXX";
+    if (mkdtemp(dir_template) == NULL) {
+        std::cerr << "Cannot create a directory for the socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    socket_dir = dir_template;
+    socket_path = socket_dir + "/socket";
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0 || bind(listen_fd, (sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(listen_fd, num_of_workers) != 0) {
+        std::cerr << "Cannot listen on " << socket_path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    for (int i = 0; i < num_of_shards; i++)
+        queue.push_back(i);
+    attempts.assign(num_of_shards, 0);
+    done.assign(num_of_shards, false);
+    num_of_done = 0;
+    int num_of_spawned = 0;
+
+    while (num_of_done < num_of_shards) {
+        // Keep enough workers for the shards left, replacing the ones that exited
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+            for (size_t i = 0; i < workers.size(); i++)
+                if (workers[i] == pid)
+                    workers.erase(workers.begin() + i--);
+
+        int needed = std::min(num_of_workers, num_of_shards - num_of_done);
+        while ((int)workers.size() < needed) {
+            if (num_of_spawned >= num_of_workers + num_of_shards * SHARD_MAX_ATTEMPTS) {
+                std::cerr << "Workers keep exiting, giving up" << std::endl;
+                return false;
+            }
+            if (!spawn()) {
+                std::cerr << "Cannot start a worker: " << strerror(errno) << std::endl;
+                return false;
+            }
+            num_of_spawned++;
+        }
+
+        std::vector<pollfd> fds(connections.size() + 1);
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (size_t i = 0; i < connections.size(); i++) {
+            fds[i + 1].fd = connections[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        if (poll(&fds[0], fds.size(), SHARD_POLL_MS) < 0 && errno != EINTR)
+            return false;
+
+        // Answer the workers first, as new connections are appended to the list
+        for (size_t i = 0; i < connections.size(); i++) {
+            if (fds[i + 1].revents == 0)
+                continue;
+
+            std::string line;
+            int shard = -1;
+            if (receive_line(connections[i].fd, line) && sscanf(line.c_str(), "done %d", &shard) == 1 &&
+                shard == connections[i].shard) {
+                done[shard] = true;
+                num_of_done++;
+                std::cout << "Shard " << shard << " done (" << num_of_done << "/" << num_of_shards << ")"
+                          << std::endl;
+                if (!assign(connections[i]))
+                    return false;
+                continue;
+            }
+
+            release(connections[i]);
+            close(connections[i].fd);
+            connections.erase(connections.begin() + i);
+            fds.erase(fds.begin() + i + 1);
+            i--;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            Connection connection;
+            connection.fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (connection.fd >= 0) {
+                connections.push_back(connection);
+                if (!assign(connections.back()))
+                    return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < connections.size(); i++)
+        send_line(connections[i].fd, "exit");
+    for (size_t i = 0; i < workers.size(); i++)
+        waitpid(workers[i], NULL, 0);
+    workers.clear();
+    return true;
+}
+
+/**
+ * Connects to the coordinator listening on socket_path, returns the descriptor or -1
+ **/
+int shard_connect(const std::string &socket_path){
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+        std::cerr << "Cannot connect to " << socket_path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Waits for the next shard from the coordinator, returns -1 when there is none left
+ **/
+int shard_receive(int fd){
+    std::string line;
+    int shard;
+    if (!receive_line(fd, line) || sscanf(line.c_str(), "shard %d", &shard) != 1)
+        return -1;
+    return shard;
+}
+
+/**
+ * Tells the coordinator that a shard is done
+ **/
+bool shard_report(int fd, int shard){
+    std::ostringstream line;
+    line << "done " << shard;
+    return send_line(fd, line.str());
+}
@@ -0,0 +1,90 @@
+#ifndef SHARDCOORDINATOR_CLASS
+#define SHARDCOORDINATOR_CLASS
+
+#include <vector>
+#include <string>
+#include <sys/types.h>
+
+#define SHARD_MAX_ATTEMPTS 3 // Times a shard is handed out before the coordinator gives up on it
+#define SHARD_POLL_MS 100 // How often the coordinator looks for workers that exited (milliseconds)
+
+/**
+ * Hands out the shards of a sweep to worker processes over a Unix socket. The coordinator starts the workers
+ * (program plus worker_args plus the socket path), gives every worker that connects a shard ("shard i") and
+ * the next one when it answers "done i", or "exit" when none is left. When a worker exits or its connection
+ * closes before it is done, its shard goes back to the queue and a new worker is started
+ **/
+class ShardCoordinator {
+    private:
+        // Connection of a worker and the shard it runs (-1 for none)
+        struct Connection {
+            int fd;
+            int shard;
+        };
+
+        // Program started as a worker and its arguments before the socket path
+        std::string program;
+        std::vector<std::string> worker_args;
+        // Private directory of the socket (mkdtemp, only the user can enter it), path and descriptor of the
+        // listening socket in it
+        std::string socket_dir, socket_path;
+        int listen_fd;
+        // Shards not handed out yet, times every shard was handed out and whether it is done
+        std::vector<int> queue;
+        std::vector<int> attempts;
+        std::vector<bool> done;
+        int num_of_done;
+        // Worker processes running and their connections
+        std::vector<pid_t> workers;
+        std::vector<Connection> connections;
+
+        /**
+         * Starts a worker process, returns false when fork fails. The worker runs the executable of this
+         * process (/proc/self/exe) with program as argv[0], or program looked up in the PATH without /proc
+         **/
+        bool spawn();
+
+        /**
+         * Gives a connection the next shard of the queue, or tells it to exit when the queue is empty.
+         * Returns false when a shard was handed out too often
+         **/
+        bool assign(Connection &connection);
+
+        /**
+         * Puts the shard of a connection that closed back in the queue
+         **/
+        void release(Connection &connection);
+
+    public:
+        /**
+         * Constructor that takes the program started as a worker and its arguments before the socket path
+         **/
+        ShardCoordinator(const std::string &program, const std::vector<std::string> &worker_args);
+
+        /**
+         * Closes the socket and stops the workers that still run
+         **/
+        ~ShardCoordinator();
+
+        /**
+         * Runs num_of_shards shards on up to num_of_workers workers, returns true once every shard is done
+         **/
+        bool run(int num_of_shards, int num_of_workers);
+};
+
+/**
+ * Connects to the coordinator listening on socket_path, returns the descriptor or -1
+ **/
+int shard_connect(const std::string &socket_path);
+
+/**
+ * Waits for the next shard from the coordinator, returns -1 when there is none left
+ **/
+int shard_receive(int fd);
+
+/**
+ * Tells the coordinator that a shard is done
+ **/
+bool shard_report(int fd, int shard);
+
+#endif
@@ -0,0 +1,74 @@
+#include "SweepRunner.hpp"
+
+/**
+ * Constructor that takes the number of threads (0 uses every available core)
+ **/
+SweepRunner::SweepRunner(int threads)
+:num_of_threads(threads)
+,next_job(0)
+,next_dump(0) {
+    if (num_of_threads <= 0)
+        num_of_threads = std::thread::hardware_concurrency();
+    if (num_of_threads <= 0)
+        num_of_threads = 1;
+}
+
+/**
+ * Returns the number of worker threads
+ **/
+int SweepRunner::get_num_of_threads(){ return num_of_threads; }
+
+/**
+ * Runs jobs 0 .. num_of_jobs-1 and waits for all of them to finish.
+ * When a dump stream is given every job writes to its own buffer and the buffers are
+ * written to the dump in job order, so the dump is the same for any number of threads
+ **/
+void SweepRunner::run(int num_of_jobs, Job job, std::ostream *dump){
+    next_job = 0;
+    next_dump = 0;
+    pending_dumps.clear();
+
+    // The calling thread works as well, so only spawn the extra workers
+    std::vector<std::thread> workers;
+    for (int worker = 1; worker < num_of_threads; worker++)
+        workers.push_back(std::thread(&SweepRunner::work, this, worker, num_of_jobs, std::ref(job), dump));
+    work(0, num_of_jobs, job, dump);
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+/**
+ * Takes jobs until none are left
+ **/
+void SweepRunner::work(int worker, int num_of_jobs, Job &job, std::ostream *dump){
+    // Stream without a buffer, writing to it does nothing
+    std::ostream null_stream(nullptr);
+
+    for (int curr_job = next_job++; curr_job < num_of_jobs; curr_job = next_job++) {
+        if (dump == nullptr) {
+            job(curr_job, worker, null_stream);
+            continue;
+        }
+
+        // Write to a private buffer that uses the same formatting as the dump file
+        std::ostringstream buffer;
+        buffer.copyfmt(*dump);
+        job(curr_job, worker, buffer);
+        flush_dump(curr_job, buffer.str(), *dump);
+    }
+}
+
+/**
+ * Queues the dump of a finished job and writes out every buffer that is now in order
+ **/
+void SweepRunner::flush_dump(int job, std::string buffer, std::ostream &dump){
+    std::lock_guard<std::mutex> lock(dump_mutex);
+    pending_dumps[job].swap(buffer);
+
+    while (!pending_dumps.empty() && pending_dumps.begin()->first == next_dump) {
+        dump << pending_dumps.begin()->second;
+        pending_dumps.erase(pending_dumps.begin());
+        next_dump++;
+    }
+}
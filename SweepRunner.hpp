@@ -0,0 +1,62 @@
+#ifndef SWEEPRUNNER_CLASS
+#define SWEEPRUNNER_CLASS
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+/**
+ * Runs a sweep of independent jobs (e.g. configuration x environment pairs) on a pool of threads
+ **/
+class SweepRunner {
+    public:
+        // A job receives its index, the index of the worker running it and the stream to dump to
+        typedef std::function<void(int job, int worker, std::ostream &dump)> Job;
+
+    private:
+        // Number of worker threads used for a sweep
+        int num_of_threads;
+        // Index of the next job to hand out
+        std::atomic<int> next_job;
+        // Guards the pending dump buffers and the dump file
+        std::mutex dump_mutex;
+        // Dump buffers of finished jobs waiting for the jobs before them
+        std::map<int, std::string> pending_dumps;
+        // Index of the next job whose dump buffer is written out
+        int next_dump;
+
+        /**
+         * Takes jobs until none are left
+         **/
+        void work(int worker, int num_of_jobs, Job &job, std::ostream *dump);
+
+        /**
+         * Queues the dump of a finished job and writes out every buffer that is now in order
+         **/
+        void flush_dump(int job, std::string buffer, std::ostream &dump);
+
+    public:
+        /**
+         * Constructor that takes the number of threads (0 uses every available core)
+         **/
+        SweepRunner(int threads = 0);
+
+        /**
+         * Returns the number of worker threads
+         **/
+        int get_num_of_threads();
+
+        /**
+         * Runs jobs 0 .. num_of_jobs-1 and waits for all of them to finish.
+         * When a dump stream is given every job writes to its own buffer and the buffers are
+         * written to the dump in job order, so the dump is the same for any number of threads
+         **/
+        void run(int num_of_jobs, Job job, std::ostream *dump = nullptr);
+};
+
+#endif
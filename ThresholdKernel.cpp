@@ -0,0 +1,156 @@
+#include "ThresholdKernel.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define THRESHOLD_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+// Signature shared by every kernel
+typedef int (*ThresholdArgmax)(const uint64_t *thresholds, int n);
+
+/**
+ * Scalar kernel used when the CPU has no supported vector extension
+ **/
+int threshold_argmax_scalar(const uint64_t *thresholds, int n){
+    int optm_index = -1;
+    uint64_t optm_val = 1;
+    for (int i = 0; i < n; i++) {
+        if (thresholds[i] > optm_val) {
+            optm_index = i;
+            optm_val = thresholds[i];
+        }
+    }
+    return optm_index;
+}
+
+/**
+ * Returns the first index from start on whose threshold is best, scalar tail of the vector kernels
+ **/
+static int find_first(const uint64_t *thresholds, int start, int n, uint64_t best){
+    for (int i = start; i < n; i++)
+        if (thresholds[i] == best)
+            return i;
+    return -1;
+}
+
+#ifdef THRESHOLD_KERNEL_X86
+/**
+ * AVX2 kernel, eight arms per step: the maximum first, then the first arm holding it
+ **/
+__attribute__((target("avx2")))
+static int threshold_argmax_avx2(const uint64_t *thresholds, int n){
+    // Two accumulators so consecutive steps do not wait on each other
+    __m256i best_a = _mm256_set1_epi64x(1), best_b = best_a;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(thresholds + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(thresholds + i + 4));
+        best_a = _mm256_blendv_epi8(best_a, a, _mm256_cmpgt_epi64(a, best_a));
+        best_b = _mm256_blendv_epi8(best_b, b, _mm256_cmpgt_epi64(b, best_b));
+    }
+    best_a = _mm256_blendv_epi8(best_a, best_b, _mm256_cmpgt_epi64(best_b, best_a));
+
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, best_a);
+    int64_t best = 1;
+    for (int lane = 0; lane < 4; lane++)
+        best = (lanes[lane] > best) ? lanes[lane] : best;
+    for (int j = i; j < n; j++)
+        best = ((int64_t)thresholds[j] > best) ? (int64_t)thresholds[j] : best;
+    if (best <= 1)
+        return -1;
+
+    const __m256i target = _mm256_set1_epi64x(best);
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m256i equal = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(thresholds + i)), target);
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(equal));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return find_first(thresholds, i, n, best);
+}
+
+/**
+ * AVX-512 kernel, sixteen arms per step: the maximum first, then the first arm holding it
+ **/
+__attribute__((target("avx512f")))
+static int threshold_argmax_avx512(const uint64_t *thresholds, int n){
+    // With less than two full vectors the shorter AVX2 steps waste fewer lanes
+    if (n < 32)
+        return threshold_argmax_avx2(thresholds, n);
+
+    __m512i best_a = _mm512_set1_epi64(1), best_b = best_a;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        best_a = _mm512_max_epi64(best_a, _mm512_loadu_si512(thresholds + i));
+        best_b = _mm512_max_epi64(best_b, _mm512_loadu_si512(thresholds + i + 8));
+    }
+    if (i < n) {
+        const __mmask8 valid_a = (__mmask8)((n - i >= 8) ? 0xff : (1u << (n - i)) - 1);
+        const __mmask8 valid_b = (__mmask8)((n - i <= 8) ? 0 : (1u << (n - i - 8)) - 1);
+        best_a = _mm512_mask_max_epi64(best_a, valid_a, best_a, _mm512_maskz_loadu_epi64(valid_a, thresholds + i));
+        best_b = _mm512_mask_max_epi64(best_b, valid_b, best_b,
+                                       _mm512_maskz_loadu_epi64(valid_b, thresholds + i + 8));
+    }
+    int64_t best = _mm512_reduce_max_epi64(_mm512_max_epi64(best_a, best_b));
+    if (best <= 1)
+        return -1;
+
+    const __m512i target = _mm512_set1_epi64(best);
+    for (i = 0; i + 8 <= n; i += 8) {
+        __mmask8 equal = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(thresholds + i), target);
+        if (equal != 0)
+            return i + __builtin_ctz(equal);
+    }
+    return find_first(thresholds, i, n, best);
+}
+#endif
+
+/**
+ * Picks the best kernel the CPU supports and stores its name
+ **/
+static ThresholdArgmax select_kernel(const char **name){
+#ifdef THRESHOLD_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        *name = "avx512";
+        return threshold_argmax_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return threshold_argmax_avx2;
+    }
+#endif
+    *name = "scalar";
+    return threshold_argmax_scalar;
+}
+
+// Name of the kernel picked by select_kernel
+static const char *kernel_name = "scalar";
+
+/**
+ * Returns the kernel picked for this CPU, selected once on first use
+ **/
+static ThresholdArgmax get_kernel(){
+    static const ThresholdArgmax kernel = select_kernel(&kernel_name);
+    return kernel;
+}
+
+/**
+ * Returns the index of the first arm with the highest integer reward threshold (see Rng::bernoulli_threshold),
+ * which is the arm with the highest probability, or -1 when every probability is 0 (threshold 1).
+ * Thresholds never exceed 2^53 + 1, so they compare as signed 64 bit integers. The best kernel the CPU
+ * supports (AVX-512, AVX2 or scalar) is picked the first time it is called, and every kernel returns exactly
+ * the same index as the scalar one
+ **/
+int threshold_argmax(const uint64_t *thresholds, int n){
+    return get_kernel()(thresholds, n);
+}
+
+/**
+ * Returns the name of the kernel picked by threshold_argmax ("avx512", "avx2" or "scalar")
+ **/
+const char *threshold_kernel_name(){
+    get_kernel();
+    return kernel_name;
+}
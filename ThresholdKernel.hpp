@@ -0,0 +1,25 @@
+#ifndef THRESHOLDKERNEL_FUNCS
+#define THRESHOLDKERNEL_FUNCS
+
+#include <cstdint>
+
+/**
+ * Returns the index of the first arm with the highest integer reward threshold (see Rng::bernoulli_threshold),
+ * which is the arm with the highest probability, or -1 when every probability is 0 (threshold 1).
+ * Thresholds never exceed 2^53 + 1, so they compare as signed 64 bit integers. The best kernel the CPU
+ * supports (AVX-512, AVX2 or scalar) is picked the first time it is called, and every kernel returns exactly
+ * the same index as the scalar one
+ **/
+int threshold_argmax(const uint64_t *thresholds, int n);
+
+/**
+ * Scalar kernel used when the CPU has no supported vector extension
+ **/
+int threshold_argmax_scalar(const uint64_t *thresholds, int n);
+
+/**
+ * Returns the name of the kernel picked by threshold_argmax ("avx512", "avx2" or "scalar")
+ **/
+const char *threshold_kernel_name();
+
+#endif
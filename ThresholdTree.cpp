@@ -0,0 +1,55 @@
+#include "ThresholdTree.hpp"
+
+/**
+ * Constructor of an empty tree
+ **/
+ThresholdTree::ThresholdTree()
+:num_of_arms(0)
+,size(1)
+,winner(2, -1) {}
+
+/**
+ * Builds the tree over n thresholds in O(n), nothing is allocated once it held as many arms
+ **/
+void ThresholdTree::build(const uint64_t *thresholds, int n){
+    num_of_arms = n;
+
+    size = 1;
+    while (size < num_of_arms)
+        size *= 2;
+
+    winner.assign(2 * size, -1);
+    for (int i = 0; i < num_of_arms; i++)
+        winner[size + i] = i;
+    for (int node = size - 1; node >= 1; node--)
+        recompute(thresholds, node);
+}
+
+/**
+ * Recomputes the winner of an internal node from its children
+ **/
+void ThresholdTree::recompute(const uint64_t *thresholds, int node){
+    int left = winner[2 * node], right = winner[2 * node + 1];
+
+    // Highest threshold wins, ties go to the lowest index (always the left one)
+    if (left == -1 || right == -1)
+        winner[node] = (left == -1) ? right : left;
+    else
+        winner[node] = (thresholds[right] > thresholds[left]) ? right : left;
+}
+
+/**
+ * Recomputes the path of an arm to the root after its threshold changed
+ **/
+void ThresholdTree::update(const uint64_t *thresholds, int arm){
+    for (int node = (size + arm) / 2; node >= 1; node /= 2)
+        recompute(thresholds, node);
+}
+
+/**
+ * Returns the index of the first arm with the highest threshold, or -1 when every probability is 0
+ **/
+int ThresholdTree::argmax(const uint64_t *thresholds){
+    int best = winner[1];
+    return (best == -1 || thresholds[best] <= 1) ? -1 : best;
+}
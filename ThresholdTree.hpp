@@ -0,0 +1,50 @@
+#ifndef THRESHOLDTREE_CLASS
+#define THRESHOLDTREE_CLASS
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * Max-tree over the reward thresholds of an environment (see Rng::bernoulli_threshold): every node stores
+ * the arm with the highest threshold in its subtree, ties going to the lowest index. Changing the threshold
+ * of one arm only recomputes its path to the root, so the best arm stays known in O(log n) per change
+ * and the tree always returns the same arm as threshold_argmax.
+ *
+ * The tree only holds arm indices, the thresholds are passed to every call so that a copy of the
+ * environment that owns them keeps a valid tree
+ **/
+class ThresholdTree {
+    private:
+        // Number of arms and number of leaves (power of two)
+        int num_of_arms, size;
+        // Winning arm of every node (-1 for empty leaves), node 1 is the root and leaves start at size
+        std::vector<int> winner;
+
+        /**
+         * Recomputes the winner of an internal node from its children
+         **/
+        void recompute(const uint64_t *thresholds, int node);
+
+    public:
+        /**
+         * Constructor of an empty tree
+         **/
+        ThresholdTree();
+
+        /**
+         * Builds the tree over n thresholds in O(n), nothing is allocated once it held as many arms
+         **/
+        void build(const uint64_t *thresholds, int n);
+
+        /**
+         * Recomputes the path of an arm to the root after its threshold changed
+         **/
+        void update(const uint64_t *thresholds, int arm);
+
+        /**
+         * Returns the index of the first arm with the highest threshold, or -1 when every probability is 0
+         **/
+        int argmax(const uint64_t *thresholds);
+};
+
+#endif
@@ -0,0 +1,292 @@
+#include "Trace.hpp"
+#include <cstring>
+#include <climits>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define NUM_SPACE std::setw(5) // Formatting support for printing an array
+
+// Field of TraceRecord stored in every uint32 column of a block, in order
+static uint32_t TraceRecord::*const trace_fields[TRACE_NUM_OF_FIELDS] = {
+    &TraceRecord::kind, &TraceRecord::config, &TraceRecord::env, &TraceRecord::label,
+    &TraceRecord::iter, &TraceRecord::optm_chosen, &TraceRecord::points
+};
+
+/**
+ * Returns the bytes of the uint32 columns of a block of count records, padded to 8 bytes so the per-arm
+ * values after them stay aligned
+ **/
+static size_t trace_columns_bytes(size_t count){
+    return (count * TRACE_NUM_OF_FIELDS * sizeof(uint32_t) + 7) / 8 * 8;
+}
+
+/**
+ * Prints a snapshot in the text format of the agents' print_agent_stats, heading is printed before the
+ * per-arm values and env_probs holds the arm probabilities of its environment (nullptr if unknown)
+ **/
+void print_trace_snapshot(std::ostream &file, const std::string &label, const std::string &heading,
+                          const TraceRecord &record, int num_of_arms, const double *probs, const double *env_probs){
+    file << "-------------------------------------" << label << "---------------------------------------\n";
+    file << "Optimal Action Chosen:\t" << std::setw(5) << record.optm_chosen
+            << "/" << record.iter << std::endl;
+
+    file << "Percentage:\t" << std::setw(20)
+            << ((double)record.optm_chosen / (double)record.iter) * 100
+            << "%" << std::endl;
+
+    file << "Success Rate:\t" << std::setw(13) << record.points
+            << "/" << record.iter << std::endl;
+
+    file << "Percentage:\t" << std::setw(20)
+            << ((double)record.points / (double)record.iter) * 100
+            << "%" << std::endl << std::endl;
+
+    file << heading;
+    for (int arm = 0; arm < num_of_arms; arm++)
+        file << probs[arm] << " " << NUM_SPACE;
+    file << std::endl;
+
+    file << "Arm Success Probs: \t\t";
+    for (int arm = 0; env_probs != nullptr && arm < num_of_arms; arm++)
+        file << env_probs[arm] << " " << NUM_SPACE;
+    file << std::endl;
+    file << "----------------------------------------------------------------------------------\n\n" << std::endl;
+}
+
+/**
+ * Constructor that takes the number of arms of every record
+ **/
+TraceWriter::TraceWriter(int n)
+:num_of_arms(n)
+,block_records(std::max<size_t>(1, TRACE_BLOCK_BYTES / (std::max(n, 1) * sizeof(double)))) {}
+
+/**
+ * Writes the header with the labels of the agents (label i of a record refers to labels[i])
+ * and the headings their per-arm values are printed under in the text dump
+ **/
+void TraceWriter::write_header(std::ostream &file, const std::vector<std::string> &labels,
+                               const std::vector<std::string> &headings){
+    TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.num_of_arms = num_of_arms;
+    header.num_of_labels = labels.size();
+    file.write((const char *)&header, sizeof(header));
+
+    for (size_t i = 0; i < labels.size(); i++) {
+        char entry[2 * TRACE_LABEL_SIZE];
+        memset(entry, 0, sizeof(entry));
+        strncpy(entry, labels[i].c_str(), TRACE_LABEL_SIZE - 1);
+        if (i < headings.size())
+            strncpy(entry + TRACE_LABEL_SIZE, headings[i].c_str(), TRACE_LABEL_SIZE - 1);
+        file.write(entry, sizeof(entry));
+    }
+}
+
+/**
+ * Adds a record with its per-arm values to the block, which is written to file once it is full
+ **/
+void TraceWriter::write_record(std::ostream &file, const TraceRecord &record, const double *probs){
+    block.push_back(record);
+    block_values.insert(block_values.end(), probs, probs + num_of_arms);
+    if (block.size() == block_records)
+        flush(file);
+}
+
+/**
+ * Writes the records of the block gathered so far, called once the last record is written
+ **/
+void TraceWriter::flush(std::ostream &file){
+    if (block.empty())
+        return;
+
+    TraceBlock header;
+    memset(&header, 0, sizeof(header));
+    header.num_of_records = block.size();
+    file.write((const char *)&header, sizeof(header));
+
+    // One column per field, then the padding and the per-arm values of every record
+    column.resize(block.size());
+    for (int field = 0; field < TRACE_NUM_OF_FIELDS; field++) {
+        for (size_t i = 0; i < block.size(); i++)
+            column[i] = block[i].*trace_fields[field];
+        file.write((const char *)column.data(), column.size() * sizeof(uint32_t));
+    }
+    static const char padding[8] = {0};
+    file.write(padding, trace_columns_bytes(block.size()) - block.size() * TRACE_NUM_OF_FIELDS * sizeof(uint32_t));
+    file.write((const char *)block_values.data(), block_values.size() * sizeof(double));
+
+    block.clear();
+    block_values.clear();
+}
+
+/**
+ * Default constructor, no file is mapped
+ **/
+TraceReader::TraceReader()
+:data(nullptr)
+,size(0)
+,num_of_records(0) {}
+
+/**
+ * Unmaps the file
+ **/
+TraceReader::~TraceReader(){ close(); }
+
+/**
+ * Maps a trace file, returns false if it cannot be read or is not a trace
+ **/
+bool TraceReader::open(const std::string &file_name){
+    close();
+
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(TraceHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+    data = (const char *)mapped;
+    size = info.st_size;
+
+    const TraceHeader *header = (const TraceHeader *)data;
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 || header->version != TRACE_VERSION) {
+        close();
+        return false;
+    }
+
+    // The label table has to fit in the file and the arms in an int
+    if (header->num_of_labels > (size - sizeof(TraceHeader)) / (2 * TRACE_LABEL_SIZE) || header->num_of_arms > INT_MAX) {
+        close();
+        return false;
+    }
+    size_t first_record = sizeof(TraceHeader) + (size_t)header->num_of_labels * 2 * TRACE_LABEL_SIZE;
+    for (uint32_t i = 0; i < header->num_of_labels; i++) {
+        const char *entry = data + sizeof(TraceHeader) + (size_t)i * 2 * TRACE_LABEL_SIZE;
+        labels.push_back(std::string(entry, strnlen(entry, TRACE_LABEL_SIZE)));
+        headings.push_back(std::string(entry + TRACE_LABEL_SIZE, strnlen(entry + TRACE_LABEL_SIZE, TRACE_LABEL_SIZE)));
+    }
+
+    // Index the blocks, a block cut short at the end of the file (e.g. an interrupted run) is ignored
+    size_t values_bytes = (size_t)header->num_of_arms * sizeof(double);
+    size_t offset = first_record;
+    while (size - offset >= sizeof(TraceBlock)) {
+        size_t count = ((const TraceBlock *)(data + offset))->num_of_records;
+        size_t left = size - offset - sizeof(TraceBlock);
+        if (count == 0 || count > left / (TRACE_NUM_OF_FIELDS * sizeof(uint32_t) + values_bytes) ||
+            trace_columns_bytes(count) + count * values_bytes > left)
+            break;
+        block_offsets.push_back(offset);
+        block_firsts.push_back(num_of_records);
+        num_of_records += count;
+        offset += sizeof(TraceBlock) + trace_columns_bytes(count) + count * values_bytes;
+    }
+    block_firsts.push_back(num_of_records);
+
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    return true;
+}
+
+/**
+ * Unmaps the file
+ **/
+void TraceReader::close(){
+    if (data != nullptr)
+        munmap((void *)data, size);
+    data = nullptr;
+    size = 0;
+    num_of_records = 0;
+    labels.clear();
+    headings.clear();
+    block_offsets.clear();
+    block_firsts.clear();
+}
+
+/**
+ * Returns the number of arms of every record
+ **/
+int TraceReader::get_num_of_arms(){ return (data == nullptr) ? 0 : ((const TraceHeader *)data)->num_of_arms; }
+
+/**
+ * Returns the number of records
+ **/
+size_t TraceReader::get_num_of_records(){ return num_of_records; }
+
+/**
+ * Returns the label of an agent, an empty string for a label the header does not have
+ **/
+const std::string &TraceReader::get_label(int label){
+    static const std::string unknown;
+    return (label >= 0 && (size_t)label < labels.size()) ? labels[label] : unknown;
+}
+
+/**
+ * Returns the block holding a record
+ **/
+size_t TraceReader::find_block(size_t index){
+    return std::upper_bound(block_firsts.begin(), block_firsts.end(), index) - block_firsts.begin() - 1;
+}
+
+/**
+ * Returns the fixed part of a record, gathered from the columns of its block
+ **/
+TraceRecord TraceReader::get_record(size_t index){
+    size_t block = find_block(index);
+    size_t count = block_firsts[block + 1] - block_firsts[block], row = index - block_firsts[block];
+    const uint32_t *columns = (const uint32_t *)(data + block_offsets[block] + sizeof(TraceBlock));
+
+    TraceRecord record;
+    for (int field = 0; field < TRACE_NUM_OF_FIELDS; field++)
+        record.*trace_fields[field] = columns[field * count + row];
+    return record;
+}
+
+/**
+ * Returns the per-arm values of a record
+ **/
+const double *TraceReader::get_probs(size_t index){
+    size_t block = find_block(index);
+    size_t count = block_firsts[block + 1] - block_firsts[block], row = index - block_firsts[block];
+    return (const double *)(data + block_offsets[block] + sizeof(TraceBlock) + trace_columns_bytes(count)) +
+           row * get_num_of_arms();
+}
+
+/**
+ * Writes the records as the text dump of the agents' print_agent_stats, returns false (after the records
+ * before it) at a record of an unknown kind or with a label the header does not have
+ **/
+bool TraceReader::print_text(std::ostream &file){
+    int num_of_arms = get_num_of_arms();
+    const double *env_probs = nullptr;
+
+    for (size_t i = 0; i < num_of_records; i++) {
+        TraceRecord record = get_record(i);
+        const double *probs = get_probs(i);
+
+        if (record.kind == TRACE_ENVIRONMENT) {
+            env_probs = probs;
+            continue;
+        }
+        if (record.kind != TRACE_SNAPSHOT || record.label >= labels.size()) {
+            std::cerr << "Record " << i << " has kind " << record.kind << " and label " << record.label
+                      << ", the trace has " << labels.size() << " labels" << std::endl;
+            return false;
+        }
+
+        print_trace_snapshot(file, labels[record.label], headings[record.label], record, num_of_arms, probs, env_probs);
+    }
+    return true;
+}
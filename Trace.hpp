@@ -0,0 +1,186 @@
+#ifndef TRACE_CLASS
+#define TRACE_CLASS
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <iostream>
+
+/**
+ * Binary trace of the per-iteration dump. A trace holds fixed width records, one per environment (its arm
+ * probabilities) and one per agent snapshot (its counters and per-arm values), stored column by column: after
+ * the header come blocks of up to TRACE_BLOCK_BYTES of records, each a TraceBlock followed by one column of
+ * uint32 per field of TraceRecord (kind, config, env, label, iter, optm_chosen, points, padded to 8 bytes) and
+ * the column of per-arm values (num_of_arms doubles per record, one record after the other).
+ * Values are stored in the byte order of the machine that wrote the trace
+ **/
+
+// First bytes of every trace file
+#define TRACE_MAGIC "BNDTRACE"
+// Version of the layout below
+#define TRACE_VERSION 2
+// Bytes reserved for every agent label and for the heading of its per-arm values in the header
+#define TRACE_LABEL_SIZE 32
+// Bytes of per-arm values a block holds at most (a block holds at least one record)
+#define TRACE_BLOCK_BYTES (1 << 20)
+// Number of uint32 columns of a block, one per field of TraceRecord
+#define TRACE_NUM_OF_FIELDS 7
+
+// Kinds of records
+#define TRACE_ENVIRONMENT 0
+#define TRACE_SNAPSHOT 1
+
+/**
+ * Header at the start of the file, followed by num_of_labels pairs of (label, heading of the
+ * per-arm values) of TRACE_LABEL_SIZE bytes each
+ **/
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_of_arms;
+    uint32_t num_of_labels;
+    uint32_t reserved;
+};
+
+/**
+ * Fixed part of a record, every field is a column of its block. The record comes with num_of_arms doubles
+ * (arm probabilities for an environment record, the agent's per-arm values for a snapshot)
+ **/
+struct TraceRecord {
+    uint32_t kind;
+    uint32_t config;
+    uint32_t env;
+    uint32_t label;
+    uint32_t iter;
+    uint32_t optm_chosen;
+    uint32_t points;
+};
+
+/**
+ * Start of every block, followed by its columns
+ **/
+struct TraceBlock {
+    uint32_t num_of_records;
+    uint32_t reserved;
+};
+
+/**
+ * Prints a snapshot in the text format of the agents' print_agent_stats, heading is printed before the
+ * per-arm values and env_probs holds the arm probabilities of its environment (nullptr if unknown)
+ **/
+void print_trace_snapshot(std::ostream &file, const std::string &label, const std::string &heading,
+                          const TraceRecord &record, int num_of_arms, const double *probs, const double *env_probs);
+
+/**
+ * Writes trace records to a stream, gathered into blocks that go out column by column once they are full
+ * (or on flush)
+ **/
+class TraceWriter {
+    private:
+        // Number of arms of every record and of records of a full block
+        int num_of_arms;
+        size_t block_records;
+        // Records of the block being gathered, their per-arm values and a column of it as it is written
+        std::vector<TraceRecord> block;
+        std::vector<double> block_values;
+        std::vector<uint32_t> column;
+
+    public:
+        /**
+         * Constructor that takes the number of arms of every record
+         **/
+        TraceWriter(int n = 10);
+
+        /**
+         * Writes the header with the labels of the agents (label i of a record refers to labels[i])
+         * and the headings their per-arm values are printed under in the text dump
+         **/
+        void write_header(std::ostream &file, const std::vector<std::string> &labels,
+                          const std::vector<std::string> &headings);
+
+        /**
+         * Adds a record with its per-arm values to the block, which is written to file once it is full
+         **/
+        void write_record(std::ostream &file, const TraceRecord &record, const double *probs);
+
+        /**
+         * Writes the records of the block gathered so far, called once the last record is written
+         **/
+        void flush(std::ostream &file);
+};
+
+/**
+ * Memory maps a trace file and gives access to its records without copying them
+ **/
+class TraceReader {
+    private:
+        // Mapped file and its size
+        const char *data;
+        size_t size;
+        // Number of records
+        size_t num_of_records;
+        // Labels and headings from the header
+        std::vector<std::string> labels, headings;
+        // Offset of every block and index of its first record, followed by the number of records
+        std::vector<size_t> block_offsets, block_firsts;
+
+        /**
+         * Returns the block holding a record
+         **/
+        size_t find_block(size_t index);
+
+    public:
+        /**
+         * Default constructor, no file is mapped
+         **/
+        TraceReader();
+
+        /**
+         * Unmaps the file
+         **/
+        ~TraceReader();
+
+        /**
+         * Maps a trace file, returns false if it cannot be read or is not a trace
+         **/
+        bool open(const std::string &file_name);
+
+        /**
+         * Unmaps the file
+         **/
+        void close();
+
+        /**
+         * Returns the number of arms of every record
+         **/
+        int get_num_of_arms();
+
+        /**
+         * Returns the number of records
+         **/
+        size_t get_num_of_records();
+
+        /**
+         * Returns the label of an agent, an empty string for a label the header does not have
+         **/
+        const std::string &get_label(int label);
+
+        /**
+         * Returns the fixed part of a record, gathered from the columns of its block
+         **/
+        TraceRecord get_record(size_t index);
+
+        /**
+         * Returns the per-arm values of a record
+         **/
+        const double *get_probs(size_t index);
+
+        /**
+         * Writes the records as the text dump of the agents' print_agent_stats, returns false (after the records
+         * before it) at a record of an unknown kind or with a label the header does not have
+         **/
+        bool print_text(std::ostream &file);
+};
+
+#endif
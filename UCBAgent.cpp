@@ -1,32 +1,20 @@
 #include "UCBAgent.hpp"
+#include <algorithm>
 
 /**
- * Default constructor
+ * Sets every estimate to 0.5 with no pulls
  **/
-
-UCBAgent::UCBAgent(Environment env, std::string l, double conf)
-:c(conf)
-,optm_chosen(0)
-,iter_number(1)
-,points(0)
-,curr_env(env)
-,label(l) {
-    int n = env.get_arms_size();
-    for (int i = 0; i < n; i++){
-        est_arm_reward_prob.push_back(0.5);
-        times_arm_pulled.push_back(0);
-    }
+template <class Real>
+void SampleMeanUpdateOf<Real>::reset(int n){
+    times_arm_pulled.assign(n, 0);
+    est_arm_reward_prob.assign(n, 0.5);
 }
 
 /**
- * returns the cumulative rewards collected
+ * Prints the agent's estimated probabilities of each arm producing reward
  **/
-int UCBAgent::get_points(){ return points; }
-
-/**
- * Prints the agent's probabilities to choose each arm
- **/
-void UCBAgent::print_est_arm_reward_probs(std::ostream &file){ 
+template <class Real>
+void SampleMeanUpdateOf<Real>::print_values(std::ostream &file){
     file << "Estimated Arm Probs: \t";
     for (auto prob : est_arm_reward_prob)
         file << prob << " " << NUM_SPACE;
@@ -34,122 +22,84 @@ void UCBAgent::print_est_arm_reward_probs(std::ostream &file){
 }
 
 /**
- * Returns the index of the element with the highest value in a vector containing doubles
+ * Constructor that takes the confidence value c
  **/
-int UCBAgent::argmax(std::vector<double> vec){
-    int lrg_index = -1;
-    double lrg_val = 0;
-    for (int i = 0; i < vec.size(); i++) {
-        if (vec[i] > lrg_val) {
-            lrg_index = i;
-            lrg_val = vec[i];
-        }
-    }
-    return lrg_index;
-}
+UCBSelection::UCBSelection(double conf)
+:c(conf)
+,use_index(false) {}
 
 /**
- * Chooses an arm to pull based on the arm probabilities
+ * Sets the confidence value c, takes effect on the next reset
  **/
-int UCBAgent::choose_arm(){ 
-    std::vector<double> prob_ucb;
-    for(int i = 0; i < est_arm_reward_prob.size(); i++) {
-        prob_ucb.push_back(
-            est_arm_reward_prob[i] + 
-            c * sqrt(log(iter_number)/(times_arm_pulled[i] + 1))
-        );
-    }
-    return argmax(prob_ucb);
-}
+void UCBSelection::set_confidence(double conf){ c = conf; }
 
 /**
- * Executes a single round of game and updates arm probabilities
+ * Back to the first round, with the index when there are enough arms
  **/
-void UCBAgent::exec_round(){
-    int choice, reward;
-    double est_choice_prob;
-
-    // Choose an arm
-    choice = choose_arm();
-
-    if(choice == -1){
-        return;
-    }
-    
-    //Add 1 to optimal chosen variable if the optimal arm is chosen else add 0 (do nothing)
-    optm_chosen += curr_env.is_optimal(choice);
-
-    // Increment the number of times this arm has been pulled
-    times_arm_pulled[choice]++;
-
-    // Pulls the arm and returns the reward (0 or 1)
-    reward = curr_env.pull_chosen_arm(choice);
-
-    // Adds the reward to the total points accumulated
-    points += reward;
-
-    // Changes the probabilities based on the UCB Algorithm
-    est_arm_reward_prob[choice] = 
-        est_arm_reward_prob[choice] + 
-        ((reward - est_choice_prob)/iter_number);
-    
-    // Update the number of iterations
-    iter_number++;
+void UCBSelection::reset(int n){
+    use_index = n >= UCB_INDEX_MIN_ARMS;
+    if (use_index)
+        index.reset(n, c, 0.5);
 }
 
 /**
- * Return the percentage of iterations where reward was received
+ * Heap order of the top arms: the worse arm (lower bound, or higher index on a tie) comes first
  **/
-double UCBAgent::get_reward_percent(){
-    return (double)points / (double)(iter_number-1);
+static bool better_bound(const std::pair<double, int> &x, const std::pair<double, int> &y){
+    return x.first > y.first || (x.first == y.first && x.second < y.second);
 }
 
 /**
- * Return the percentage of iterations where optimal arm was chosen
+ * Adds an arm to the top k, in place of the worst one when there are k already
  **/
-double UCBAgent::get_optm_percent(){
-    return (double)optm_chosen / (double)(iter_number-1);
+void UCBSelection::push_top(int k, double bound, int arm){
+    if ((int)top.size() == k) {
+        std::pop_heap(top.begin(), top.end(), better_bound);
+        top.pop_back();
+    }
+    top.push_back(std::make_pair(bound, arm));
+    std::push_heap(top.begin(), top.end(), better_bound);
 }
 
 /**
- * Prints the agent's statistics
+ * Writes the top arms to choices, highest bound first and ties to the lowest index, and returns how
+ * many were written
  **/
-void UCBAgent::print_agent_stats(std::ostream &file){
-        file << "-------------------------------------" << label << "---------------------------------------\n";
-        file << "Optimal Action Chosen:\t" << std::setw(5) << optm_chosen 
-                << "/" << (iter_number-1) << std::endl;
-
-        file << "Percentage:\t" << std::setw(20) 
-                << ((double)optm_chosen / (double)(iter_number-1)) * 100 
-                << "%" << std::endl;
-
-        file << "Success Rate:\t" << std::setw(13) << points
-                << "/" << (iter_number-1) << std::endl;
-
-        file << "Percentage:\t" << std::setw(20) 
-                << ((double)points / (double)(iter_number-1)) * 100 
-                << "%" << std::endl << std::endl;
-
-        print_est_arm_reward_probs(file);
-        curr_env.print_arm_probs(file);
-        file << "----------------------------------------------------------------------------------\n\n" << std::endl;
+int UCBSelection::sort_top(int *choices){
+    std::sort_heap(top.begin(), top.end(), better_bound);
+    for (size_t i = 0; i < top.size(); i++)
+        choices[i] = top[i].second;
+    return (int)top.size();
 }
+
 /**
- * Resets the agent variables and produces a new set of arm probabilities
+ * Default constructor
  **/
-void UCBAgent::change_parameters(Environment &env, double conf){
-    curr_env = env;
-    points = 0;
-    iter_number = 1;
-    optm_chosen = 0;
-    times_arm_pulled.clear();
-    est_arm_reward_prob.clear();
+template <class Real, class Env>
+UCBAgentOf<Real, Env>::UCBAgentOf(Env &env, const std::string &l, double conf)
+:Agent<UCBSelection, SampleMeanUpdateOf<Real>, Env>(env, l, UCBSelection(conf)) {}
 
-    int n = curr_env.get_arms_size();
-    for (int i = 0; i < n; i++){
-        times_arm_pulled.push_back(0);
-        est_arm_reward_prob.push_back(0.5);
-    }
+/**
+ * Resets the agent variables and takes a new environment whose rewards come from r
+ **/
+template <class Real, class Env>
+void UCBAgentOf<Real, Env>::change_parameters(Env &env, double conf, Rng r){
+    this->selection.set_confidence(conf);
+    Agent<UCBSelection, SampleMeanUpdateOf<Real>, Env>::change_parameters(env, r);
+}
 
-    c = conf;
+/**
+ * Chooses the k arms with the highest upper confidence bounds for one request, highest first, and
+ * returns how many were written to choices. Their rewards are learnt later with apply_feedback
+ **/
+template <class Real, class Env>
+int UCBAgentOf<Real, Env>::choose_top_k(int k, int *choices){
+    return this->selection.choose_top_k(this->update, this->rounds + 1, k, choices);
 }
+
+// The precisions the agent is built with
+template class SampleMeanUpdateOf<double>;
+template class SampleMeanUpdateOf<float>;
+template class UCBAgentOf<double>;
+template class UCBAgentOf<float>;
+template class UCBAgentOf<double, BatchLane>;
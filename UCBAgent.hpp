@@ -1,80 +1,214 @@
-#ifndef LRAGENT_CLASS
-#define LRAGENT_CLASS
+#ifndef UCBAGENT_CLASS
+#define UCBAGENT_CLASS
 
 #include <vector>
+#include <utility>
 #include <iomanip>
-#include "Environment.hpp"
+#include "Agent.hpp"
+#include "BatchEnvironment.hpp"
+#include "AlignedAllocator.hpp"
+#include "UCBKernel.hpp"
+#include "UCBIndex.hpp"
+#include "Precision.hpp"
 #include <cmath>
 #define NUM_SPACE std::setw(5) // Formatting support for printing an array
+#define UCB_INDEX_MIN_ARMS 128 // Arm count from which the incremental index beats a full scan
 
 
 /**
- * Agent class representing an agent who is playing the slot machine
+ * Update policy keeping an estimate of the reward probability of every arm and its number of pulls.
+ * The estimate of the chosen arm moves towards the reward by 1/round.
+ *
+ * The estimates are stored as Real: double, or float to halve the bytes the arm selection reads per arm
+ * (the update is computed in double and rounded once, so the estimates stay within float rounding of
+ * the double ones on the same rewards)
  **/
-class UCBAgent {
+template <class Real>
+class SampleMeanUpdateOf {
     private:
         // Estimated probability of each arm producing a reward
-        std::vector<double> est_arm_reward_prob;
+        std::vector<Real, AlignedAllocator<Real>> est_arm_reward_prob;
         // Number of times arm was pulled
-        std::vector<int> times_arm_pulled;
-        // Cumulative points
-        int points, optm_chosen, iter_number;
+        std::vector<int, AlignedAllocator<int>> times_arm_pulled;
+        // Estimates converted to double for the dump, unused when they are stored as doubles
+        std::vector<double> dump_values;
+
+    public:
+        /**
+         * Sets every estimate to 0.5 with no pulls
+         **/
+        void reset(int n);
+
+        /**
+         * Counts the pull and moves the estimate of the chosen arm towards the reward
+         **/
+        void update(int choice, int reward, int round){
+            // Increment the number of times this arm has been pulled
+            times_arm_pulled[choice]++;
+
+            // Changes the probabilities based on the UCB Algorithm
+            double est_choice_prob = est_arm_reward_prob[choice];
+            store_value(est_choice_prob + ((reward - est_choice_prob)/round), est_arm_reward_prob[choice]);
+        }
+
+        /**
+         * Learns from n rewards in order, the first of them in round. Each one only touches its own arm, so
+         * the batch is one pass over the feedback
+         **/
+        void update_batch(const Feedback *batch, int n, int round){
+            for (int i = 0; i < n; i++)
+                update(batch[i].arm, batch[i].reward, round + i);
+        }
+
+        /**
+         * Returns the number of arms
+         **/
+        int size(){ return est_arm_reward_prob.size(); }
+
+        /**
+         * Returns the estimate of every arm as stored
+         **/
+        const Real *estimates(){ return est_arm_reward_prob.data(); }
+
+        /**
+         * Returns the estimate of every arm, the values written to the dump
+         **/
+        const double *values(){ return stored_values(est_arm_reward_prob.data(), size(), dump_values); }
+
+        /**
+         * Returns the number of pulls of every arm
+         **/
+        const int *pulls(){ return times_arm_pulled.data(); }
+
+        /**
+         * Prints the agent's estimated probabilities of each arm producing reward
+         **/
+        void print_values(std::ostream &file);
+};
+
+typedef SampleMeanUpdateOf<double> SampleMeanUpdate;
+
+/**
+ * Selection policy pulling the arm with the highest upper confidence bound
+ * est[i] + c * sqrt(log(round) / (pulled[i] + 1)) of a SampleMeanUpdateOf (with double or float estimates)
+ **/
+class UCBSelection {
+    private:
         // Upper Confidence Value c
         double c;
-        // Current Environment
-        Environment curr_env;
-        // Label for the type of algorithm
-        std::string label;
+        // Incremental index of the upper confidence bounds, used for large numbers of arms
+        UCBIndex index;
+        bool use_index;
+        // Bound of every arm, and bounds and arms of the best arms found so far by choose_top_k (a heap with
+        // the worst of them in front)
+        std::vector<double> bounds;
+        std::vector<std::pair<double, int>> top;
+
+        /**
+         * Adds an arm to the top k, in place of the worst one when there are k already
+         **/
+        void push_top(int k, double bound, int arm);
 
         /**
-         * Returns the index of the element with the highest value in a vector containing doubles
+         * Writes the top arms to choices, highest bound first and ties to the lowest index, and returns how
+         * many were written
          **/
-        int argmax(std::vector<double> vec);
+        int sort_top(int *choices);
 
     public:
+        // The choice only depends on the estimates
+        static const bool uses_rng = false;
+
         /**
-         * Default constructor
+         * Constructor that takes the confidence value c
+         **/
+        UCBSelection(double conf = 2);
+
+        /**
+         * Sets the confidence value c, takes effect on the next reset
          **/
-        UCBAgent(Environment env, std::string l, double conf = 2);
+        void set_confidence(double conf);
 
         /**
-         * returns the cumulative rewards collected
+         * Back to the first round, with the index when there are enough arms
          **/
-        int get_points();
+        void reset(int n);
 
         /**
-         * Prints the agent's probabilities to choose each arm
+         * Back to the first round, with the index when there are enough arms
          **/
-        void print_est_arm_reward_probs(std::ostream &file = std::cout);
-        
+        template <class Update>
+        void reset(int n, Update &){ reset(n); }
+
         /**
-         * Chooses an arm to pull based on the arm probabilities
+         * Returns the first arm with the highest bound, -1 when no bound is above 0
          **/
-        int choose_arm();
+        template <class Update>
+        int choose(Update &update, int round, Rng &){
+            if (use_index)
+                return index.argmax(log(round));
+            return ucb_argmax(update.estimates(), update.pulls(), update.size(), c, log(round));
+        }
 
         /**
-         * Executes a single round of game and updates arm probabilities
+         * Writes the k arms with the highest bounds to choices, highest first and ties to the lowest index,
+         * and returns how many were written (fewer when fewer arms have a bound above 0). The bounds are the
+         * ones choose compares (computed by the same vector kernel), so the first arm is the one choose picks.
+         * Every arm is scanned once and only the top k are kept in a heap
          **/
-        void exec_round();
+        template <class Update>
+        int choose_top_k(Update &update, int round, int k, int *choices){
+            int n = update.size();
+            top.clear();
+            if (k <= 0)
+                return 0;
+            bounds.resize(n);
+            ucb_bounds(update.estimates(), update.pulls(), n, c, log(round), bounds.data());
+            for (int i = 0; i < n; i++) {
+                // Arms come in index order, so an arm only displaces the worst of the top k with a higher bound
+                if (bounds[i] > 0 && ((int)top.size() < k || bounds[i] > top.front().first))
+                    push_top(k, bounds[i], i);
+            }
+            return sort_top(choices);
+        }
 
         /**
-         * Return the percentage of iterations where reward was received
+         * Only the chosen arm changed, so only its path in the index is recomputed
          **/
-        double get_reward_percent();
+        template <class Update>
+        void observe(int choice, Update &update){
+            if (use_index)
+                index.update(choice, update.estimates()[choice], update.pulls()[choice]);
+        }
+};
 
+/**
+ * Agent class representing an agent who is playing the slot machine with the UCB algorithm, with its
+ * estimates stored as Real (UCBAgent for double, FloatUCBAgent for float) and playing an Env
+ * (BatchUCBAgent plays one environment of a BatchEnvironment)
+ **/
+template <class Real, class Env = Environment>
+class UCBAgentOf : public Agent<UCBSelection, SampleMeanUpdateOf<Real>, Env> {
+    public:
         /**
-         * Return the percentage of iterations where optimal arm was chosen
+         * Default constructor
          **/
-        double get_optm_percent();
+        UCBAgentOf(Env &env, const std::string &l, double conf = 2);
 
         /**
-         * Prints the agent's statistics
+         * Resets the agent variables and takes a new environment whose rewards come from r
          **/
-        void print_agent_stats(std::ostream &file = std::cout);
+        void change_parameters(Env &env, double conf, Rng r = Rng());
+
         /**
-         * Resets the agent variables and produces a new set of arm probabilities
+         * Chooses the k arms with the highest upper confidence bounds for one request, highest first, and
+         * returns how many were written to choices. Their rewards are learnt later with apply_feedback
          **/
-        void change_parameters(Environment &env, double conf);
+        int choose_top_k(int k, int *choices);
 };
 
-#endif
\ No newline at end of file
+typedef UCBAgentOf<double> UCBAgent;
+typedef UCBAgentOf<float> FloatUCBAgent;
+typedef UCBAgentOf<double, BatchLane> BatchUCBAgent;
+
+#endif
@@ -0,0 +1,149 @@
+#include "UCBIndex.hpp"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// Relative gap under which two bounds are treated as tied and rechecked every round, far above the
+// rounding error of the bound expression
+#define TIE_TOLERANCE 1e-12
+// Ratio between a bound and the smallest difference it can still represent safely (2^48)
+#define ROUNDING_HEADROOM 281474976710656.0
+
+/**
+ * Constructor that takes the number of arms, c and the initial estimate of every arm
+ **/
+UCBIndex::UCBIndex(int n, double conf, double init_est) { reset(n, conf, init_est); }
+
+/**
+ * Resets every arm to the initial estimate with no pulls
+ **/
+void UCBIndex::reset(int n, double conf, double init_est){
+    num_of_arms = n;
+    c = conf;
+    log_iter = 0;
+    curr_l = 0;
+
+    size = 1;
+    while (size < num_of_arms)
+        size *= 2;
+
+    est.assign(num_of_arms, init_est);
+    pulled.assign(num_of_arms, 0);
+    winner.assign(2 * size, -1);
+    fail.assign(2 * size, std::numeric_limits<double>::infinity());
+
+    for (int i = 0; i < num_of_arms; i++)
+        winner[size + i] = i;
+    for (int node = size - 1; node >= 1; node--)
+        recompute(node);
+}
+
+/**
+ * Sets the estimate and number of pulls of every arm at once for the given log(t) and rebuilds the
+ * tree in O(n), later calls of argmax must not pass a smaller log(t)
+ **/
+void UCBIndex::assign(const double *arm_est, const int *arm_pulled, double log_t){
+    est.assign(arm_est, arm_est + num_of_arms);
+    pulled.assign(arm_pulled, arm_pulled + num_of_arms);
+    log_iter = log_t;
+    curr_l = sqrt(log_iter);
+    for (int node = size - 1; node >= 1; node--)
+        recompute(node);
+}
+
+/**
+ * Returns the upper confidence bound of an arm in the current round
+ **/
+double UCBIndex::bound(int arm){
+    return est[arm] + c * sqrt(log_iter / (pulled[arm] + 1));
+}
+
+/**
+ * Recomputes the winner and certificate of an internal node from its children
+ **/
+void UCBIndex::recompute(int node){
+    int left = winner[2 * node], right = winner[2 * node + 1];
+    double child_fail = std::min(fail[2 * node], fail[2 * node + 1]);
+
+    if (left == -1 || right == -1) {
+        winner[node] = (left == -1) ? right : left;
+        fail[node] = child_fail;
+        return;
+    }
+
+    double left_val = bound(left), right_val = bound(right);
+
+    // Highest bound wins, ties go to the lowest index (always the left one)
+    int win = left, lose = right;
+    double win_val = left_val, lose_val = right_val;
+    if (right_val > left_val) {
+        win = right, lose = left;
+        win_val = right_val, lose_val = left_val;
+    }
+    winner[node] = win;
+
+    // Certificate: the value of L at which the winner could lose to the other side
+    double gap = win_val - lose_val;
+    double tolerance = TIE_TOLERANCE * (1.0 + fabs(win_val) + fabs(lose_val));
+    double win_slope = c / sqrt(pulled[win] + 1.0), lose_slope = c / sqrt(pulled[lose] + 1.0);
+    double cert;
+    if (pulled[win] == pulled[lose]) {
+        // Both arms get the exact same bonus, so a higher estimate keeps winning until the bounds grow
+        // so large that rounding could tie them (and a tie goes to the lower index)
+        double est_gap = est[win] - est[lose];
+        if (win < lose || win_slope <= 0)
+            cert = std::numeric_limits<double>::infinity();
+        else if (est_gap <= 0)
+            cert = curr_l;
+        else
+            cert = std::max(curr_l, (est_gap * ROUNDING_HEADROOM - fabs(est[win])) / win_slope);
+    } else if (gap <= tolerance) {
+        // Too close to call, check again next round
+        cert = curr_l;
+    } else {
+        // The lines close in on each other until the gap is down to the tolerance
+        double slope_gain = lose_slope - win_slope;
+        cert = (slope_gain > 0) ? curr_l + (gap - tolerance) / slope_gain
+                                : std::numeric_limits<double>::infinity();
+    }
+    fail[node] = std::min(cert, child_fail);
+}
+
+/**
+ * Recomputes every node in the subtree whose certificate failed at the current L
+ **/
+void UCBIndex::advance(int node){
+    if (node >= size || fail[node] > curr_l)
+        return;
+    advance(2 * node);
+    advance(2 * node + 1);
+    recompute(node);
+}
+
+/**
+ * Returns the index of the first arm with the highest bound for the given log(t), or -1 when no
+ * bound is above 0. log(t) must not decrease between calls
+ **/
+int UCBIndex::argmax(double log_t){
+    if (num_of_arms == 0)
+        return -1;
+
+    if (log_t != log_iter) {
+        log_iter = log_t;
+        curr_l = sqrt(log_iter);
+        advance(1);
+    }
+
+    int best = winner[1];
+    return (bound(best) > 0) ? best : -1;
+}
+
+/**
+ * Sets the estimate and number of pulls of an arm
+ **/
+void UCBIndex::update(int arm, double arm_est, int arm_pulled){
+    est[arm] = arm_est;
+    pulled[arm] = arm_pulled;
+    for (int node = (size + arm) / 2; node >= 1; node /= 2)
+        recompute(node);
+}
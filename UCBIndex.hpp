@@ -0,0 +1,78 @@
+#ifndef UCBINDEX_CLASS
+#define UCBINDEX_CLASS
+
+#include <vector>
+
+/**
+ * Incremental index over the upper confidence bounds est[i] + c * sqrt(log(t) / (pulled[i] + 1)).
+ *
+ * With L = sqrt(log(t)) the bound of every arm is the line est[i] + L * c / sqrt(pulled[i] + 1), and L only
+ * grows. The index is a kinetic tournament tree over those lines: every node stores the winner of its
+ * subtree and the value of L at which the winner could lose to the other side. Moving to a new round
+ * only revisits nodes whose certificate failed, and updating the pulled arm recomputes its path to the
+ * root, so a round costs O(log n) amortized instead of a scan of every arm.
+ *
+ * Nodes are compared with the exact same expression as the scan, and ties go to the lowest index, so
+ * the index always picks the same arm as ucb_argmax
+ **/
+class UCBIndex {
+    private:
+        // Number of arms and number of leaves (power of two)
+        int num_of_arms, size;
+        // Upper Confidence Value c
+        double c;
+        // log(t) and sqrt(log(t)) of the current round
+        double log_iter, curr_l;
+        // Estimated probability and number of pulls of each arm
+        std::vector<double> est;
+        std::vector<int> pulled;
+        // Winning arm of every node (-1 for empty leaves), node 1 is the root and leaves start at size
+        std::vector<int> winner;
+        // Smallest L at which a certificate in the subtree of every node may fail
+        std::vector<double> fail;
+
+        /**
+         * Returns the upper confidence bound of an arm in the current round
+         **/
+        double bound(int arm);
+
+        /**
+         * Recomputes the winner and certificate of an internal node from its children
+         **/
+        void recompute(int node);
+
+        /**
+         * Recomputes every node in the subtree whose certificate failed at the current L
+         **/
+        void advance(int node);
+
+    public:
+        /**
+         * Constructor that takes the number of arms, c and the initial estimate of every arm
+         **/
+        UCBIndex(int n = 0, double conf = 2, double init_est = 0.5);
+
+        /**
+         * Resets every arm to the initial estimate with no pulls
+         **/
+        void reset(int n, double conf, double init_est);
+
+        /**
+         * Sets the estimate and number of pulls of every arm at once for the given log(t) and rebuilds the
+         * tree in O(n), later calls of argmax must not pass a smaller log(t)
+         **/
+        void assign(const double *arm_est, const int *arm_pulled, double log_t);
+
+        /**
+         * Returns the index of the first arm with the highest bound for the given log(t), or -1 when no
+         * bound is above 0. log(t) must not decrease between calls
+         **/
+        int argmax(double log_t);
+
+        /**
+         * Sets the estimate and number of pulls of an arm
+         **/
+        void update(int arm, double arm_est, int arm_pulled);
+};
+
+#endif
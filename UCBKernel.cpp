@@ -0,0 +1,365 @@
+#include "UCBKernel.hpp"
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UCB_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Signature shared by every kernel for estimates stored as Real (double or float)
+ **/
+template <class Real>
+struct UCBKernel {
+    typedef int (*Argmax)(const Real *est, const int *pulled, int n, double c, double log_iter);
+    typedef void (*Bounds)(const Real *est, const int *pulled, int n, double c, double log_iter, double *bounds);
+};
+
+/**
+ * Scalar kernel for estimates stored as Real, the bounds are computed in double
+ **/
+template <class Real>
+static int ucb_argmax_scalar_of(const Real *est, const int *pulled, int n, double c, double log_iter){
+    int lrg_index = -1;
+    double lrg_val = 0;
+    for (int i = 0; i < n; i++) {
+        double prob_ucb = est[i] + c * sqrt(log_iter / (pulled[i] + 1));
+        if (prob_ucb > lrg_val) {
+            lrg_index = i;
+            lrg_val = prob_ucb;
+        }
+    }
+    return lrg_index;
+}
+
+/**
+ * Scalar bounds of every arm for estimates stored as Real
+ **/
+template <class Real>
+static void ucb_bounds_scalar_of(const Real *est, const int *pulled, int n, double c, double log_iter, double *bounds){
+    for (int i = 0; i < n; i++)
+        bounds[i] = est[i] + c * sqrt(log_iter / (pulled[i] + 1));
+}
+
+/**
+ * Scalar kernel used when the CPU has no supported vector extension
+ **/
+int ucb_argmax_scalar(const double *est, const int *pulled, int n, double c, double log_iter){
+    return ucb_argmax_scalar_of(est, pulled, n, c, log_iter);
+}
+
+/**
+ * Scalar kernel for float estimates used when the CPU has no supported vector extension
+ **/
+int ucb_argmax_scalar(const float *est, const int *pulled, int n, double c, double log_iter){
+    return ucb_argmax_scalar_of(est, pulled, n, c, log_iter);
+}
+
+#ifdef UCB_KERNEL_X86
+/**
+ * Loads four estimates as doubles
+ **/
+__attribute__((target("avx2")))
+static inline __m256d load_est4(const double *est){ return _mm256_loadu_pd(est); }
+
+/**
+ * Loads four float estimates widened to doubles
+ **/
+__attribute__((target("avx2")))
+static inline __m256d load_est4(const float *est){ return _mm256_cvtps_pd(_mm_loadu_ps(est)); }
+
+/**
+ * Loads the estimates of the valid lanes as doubles (0 in the others)
+ **/
+__attribute__((target("avx2")))
+static inline __m256d mask_load_est4(const double *est, __m256d valid, __m128i){
+    return _mm256_maskload_pd(est, _mm256_castpd_si256(valid));
+}
+
+/**
+ * Loads the float estimates of the valid lanes widened to doubles (0 in the others)
+ **/
+__attribute__((target("avx2")))
+static inline __m256d mask_load_est4(const float *est, __m256d, __m128i valid_count){
+    return _mm256_cvtps_pd(_mm_maskload_ps(est, valid_count));
+}
+
+/**
+ * Loads eight estimates as doubles
+ **/
+__attribute__((target("avx512f")))
+static inline __m512d load_est8(const double *est){ return _mm512_loadu_pd(est); }
+
+/**
+ * Loads eight float estimates widened to doubles
+ **/
+__attribute__((target("avx512f")))
+static inline __m512d load_est8(const float *est){ return _mm512_cvtps_pd(_mm256_loadu_ps(est)); }
+
+/**
+ * Loads the estimates of the valid lanes as doubles (0 in the others)
+ **/
+__attribute__((target("avx512f")))
+static inline __m512d mask_load_est8(const double *est, __mmask8 valid){ return _mm512_maskz_loadu_pd(valid, est); }
+
+/**
+ * Loads the float estimates of the valid lanes widened to doubles (0 in the others)
+ **/
+__attribute__((target("avx512f")))
+static inline __m512d mask_load_est8(const float *est, __mmask8 valid){
+    return _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_maskz_loadu_ps((__mmask16)valid, est)));
+}
+
+/**
+ * Reduces the per lane maxima of a vector kernel. Every lane holds the first index of its maximum,
+ * so the lowest index among the lanes with the overall maximum is the first index of the overall maximum
+ **/
+static int reduce_lanes(const double *lane_val, const double *lane_index, int lanes){
+    int lrg_index = -1;
+    double lrg_val = 0;
+    for (int lane = 0; lane < lanes; lane++) {
+        if (lane_index[lane] < 0)
+            continue;
+        if (lane_val[lane] > lrg_val || (lane_val[lane] == lrg_val && lane_index[lane] < lrg_index)) {
+            lrg_index = (int)lane_index[lane];
+            lrg_val = lane_val[lane];
+        }
+    }
+    return lrg_index;
+}
+
+/**
+ * AVX2 kernel, four arms per step
+ **/
+template <class Real>
+__attribute__((target("avx2")))
+static int ucb_argmax_avx2(const Real *est, const int *pulled, int n, double c, double log_iter){
+    const __m256d c_vec = _mm256_set1_pd(c);
+    const __m256d log_vec = _mm256_set1_pd(log_iter);
+    const __m256d step = _mm256_set1_pd(4.0);
+    const __m128i one = _mm_set1_epi32(1);
+
+    __m256d best_val = _mm256_setzero_pd();
+    __m256d best_index = _mm256_set1_pd(-1.0);
+    __m256d index = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i count = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(pulled + i)), one);
+        __m256d bonus = _mm256_sqrt_pd(_mm256_div_pd(log_vec, _mm256_cvtepi32_pd(count)));
+        __m256d prob_ucb = _mm256_add_pd(load_est4(est + i), _mm256_mul_pd(c_vec, bonus));
+
+        __m256d greater = _mm256_cmp_pd(prob_ucb, best_val, _CMP_GT_OQ);
+        best_val = _mm256_blendv_pd(best_val, prob_ucb, greater);
+        best_index = _mm256_blendv_pd(best_index, index, greater);
+        index = _mm256_add_pd(index, step);
+    }
+
+    // Leftover arms are loaded with a mask and kept out of the comparison
+    if (i < n) {
+        const __m256d valid = _mm256_cmp_pd(index, _mm256_set1_pd((double)n), _CMP_LT_OQ);
+        const __m128i valid_count = _mm_cmplt_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(n - i));
+
+        __m128i count = _mm_add_epi32(_mm_maskload_epi32(pulled + i, valid_count), one);
+        __m256d bonus = _mm256_sqrt_pd(_mm256_div_pd(log_vec, _mm256_cvtepi32_pd(count)));
+        __m256d est_vec = mask_load_est4(est + i, valid, valid_count);
+        __m256d prob_ucb = _mm256_add_pd(est_vec, _mm256_mul_pd(c_vec, bonus));
+
+        __m256d greater = _mm256_and_pd(_mm256_cmp_pd(prob_ucb, best_val, _CMP_GT_OQ), valid);
+        best_val = _mm256_blendv_pd(best_val, prob_ucb, greater);
+        best_index = _mm256_blendv_pd(best_index, index, greater);
+    }
+
+    double lane_val[4], lane_index[4];
+    _mm256_storeu_pd(lane_val, best_val);
+    _mm256_storeu_pd(lane_index, best_index);
+    return reduce_lanes(lane_val, lane_index, 4);
+}
+
+/**
+ * AVX2 bounds of every arm, four arms per step and the leftover ones with the scalar kernel
+ **/
+template <class Real>
+__attribute__((target("avx2")))
+static void ucb_bounds_avx2(const Real *est, const int *pulled, int n, double c, double log_iter, double *bounds){
+    const __m256d c_vec = _mm256_set1_pd(c);
+    const __m256d log_vec = _mm256_set1_pd(log_iter);
+    const __m128i one = _mm_set1_epi32(1);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i count = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(pulled + i)), one);
+        __m256d bonus = _mm256_sqrt_pd(_mm256_div_pd(log_vec, _mm256_cvtepi32_pd(count)));
+        _mm256_storeu_pd(bounds + i, _mm256_add_pd(load_est4(est + i), _mm256_mul_pd(c_vec, bonus)));
+    }
+    ucb_bounds_scalar_of(est + i, pulled + i, n - i, c, log_iter, bounds + i);
+}
+
+/**
+ * AVX-512 kernel, eight arms per step
+ **/
+template <class Real>
+__attribute__((target("avx512f")))
+static int ucb_argmax_avx512(const Real *est, const int *pulled, int n, double c, double log_iter){
+    // With less than two full vectors the shorter AVX2 steps waste fewer lanes
+    if (n < 16)
+        return ucb_argmax_avx2(est, pulled, n, c, log_iter);
+
+    const __m512d c_vec = _mm512_set1_pd(c);
+    const __m512d log_vec = _mm512_set1_pd(log_iter);
+    const __m512d step = _mm512_set1_pd(8.0);
+    const __m256i one = _mm256_set1_epi32(1);
+
+    __m512d best_val = _mm512_setzero_pd();
+    __m512d best_index = _mm512_set1_pd(-1.0);
+    __m512d index = _mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i count = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(pulled + i)), one);
+        __m512d bonus = _mm512_sqrt_pd(_mm512_div_pd(log_vec, _mm512_cvtepi32_pd(count)));
+        __m512d prob_ucb = _mm512_add_pd(load_est8(est + i), _mm512_mul_pd(c_vec, bonus));
+
+        __mmask8 greater = _mm512_cmp_pd_mask(prob_ucb, best_val, _CMP_GT_OQ);
+        best_val = _mm512_mask_blend_pd(greater, best_val, prob_ucb);
+        best_index = _mm512_mask_blend_pd(greater, best_index, index);
+        index = _mm512_add_pd(index, step);
+    }
+
+    // Leftover arms are loaded with a mask and kept out of the comparison
+    if (i < n) {
+        const __mmask8 valid = (__mmask8)((1u << (n - i)) - 1);
+
+        __m256i count = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32((__mmask16)valid, pulled + i));
+        count = _mm256_add_epi32(count, one);
+        __m512d bonus = _mm512_sqrt_pd(_mm512_div_pd(log_vec, _mm512_cvtepi32_pd(count)));
+        __m512d prob_ucb = _mm512_add_pd(mask_load_est8(est + i, valid), _mm512_mul_pd(c_vec, bonus));
+
+        __mmask8 greater = _mm512_mask_cmp_pd_mask(valid, prob_ucb, best_val, _CMP_GT_OQ);
+        best_val = _mm512_mask_blend_pd(greater, best_val, prob_ucb);
+        best_index = _mm512_mask_blend_pd(greater, best_index, index);
+    }
+
+    double lane_val[8], lane_index[8];
+    _mm512_storeu_pd(lane_val, best_val);
+    _mm512_storeu_pd(lane_index, best_index);
+    return reduce_lanes(lane_val, lane_index, 8);
+}
+
+/**
+ * AVX-512 bounds of every arm, eight arms per step and the leftover ones with the scalar kernel
+ **/
+template <class Real>
+__attribute__((target("avx512f")))
+static void ucb_bounds_avx512(const Real *est, const int *pulled, int n, double c, double log_iter, double *bounds){
+    const __m512d c_vec = _mm512_set1_pd(c);
+    const __m512d log_vec = _mm512_set1_pd(log_iter);
+    const __m256i one = _mm256_set1_epi32(1);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i count = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(pulled + i)), one);
+        __m512d bonus = _mm512_sqrt_pd(_mm512_div_pd(log_vec, _mm512_cvtepi32_pd(count)));
+        _mm512_storeu_pd(bounds + i, _mm512_add_pd(load_est8(est + i), _mm512_mul_pd(c_vec, bonus)));
+    }
+    ucb_bounds_scalar_of(est + i, pulled + i, n - i, c, log_iter, bounds + i);
+}
+#endif
+
+/**
+ * Picks the best kernel the CPU supports for estimates stored as Real and stores its name
+ **/
+template <class Real>
+static typename UCBKernel<Real>::Argmax select_kernel(const char **name){
+#ifdef UCB_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        *name = "avx512";
+        return ucb_argmax_avx512<Real>;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return ucb_argmax_avx2<Real>;
+    }
+#endif
+    *name = "scalar";
+    return ucb_argmax_scalar_of<Real>;
+}
+
+// Name of the kernel picked by select_kernel
+static const char *kernel_name = "scalar";
+
+/**
+ * Returns the kernel picked for this CPU for estimates stored as Real, selected once on first use
+ **/
+template <class Real>
+static typename UCBKernel<Real>::Argmax get_kernel(){
+    static const typename UCBKernel<Real>::Argmax kernel = select_kernel<Real>(&kernel_name);
+    return kernel;
+}
+
+/**
+ * Picks the bounds kernel of the instruction set select_kernel picks
+ **/
+template <class Real>
+static typename UCBKernel<Real>::Bounds select_bounds_kernel(){
+#ifdef UCB_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return ucb_bounds_avx512<Real>;
+    if (__builtin_cpu_supports("avx2"))
+        return ucb_bounds_avx2<Real>;
+#endif
+    return ucb_bounds_scalar_of<Real>;
+}
+
+/**
+ * Returns the bounds kernel picked for this CPU for estimates stored as Real, selected once on first use
+ **/
+template <class Real>
+static typename UCBKernel<Real>::Bounds get_bounds_kernel(){
+    static const typename UCBKernel<Real>::Bounds kernel = select_bounds_kernel<Real>();
+    return kernel;
+}
+
+/**
+ * Computes the upper confidence bound est[i] + c * sqrt(log_iter / (pulled[i] + 1)) of every arm and
+ * returns the index of the first arm with the highest bound, or -1 when no bound is above 0.
+ * The best kernel the CPU supports (AVX-512, AVX2 or scalar) is picked the first time it is called,
+ * and every kernel returns exactly the same index as the scalar one
+ **/
+int ucb_argmax(const double *est, const int *pulled, int n, double c, double log_iter){
+    return get_kernel<double>()(est, pulled, n, c, log_iter);
+}
+
+/**
+ * Same as ucb_argmax for estimates stored as floats: they are widened to double as they are loaded, so
+ * only half the bytes of the estimates are read and the bounds are the same as for the double estimates
+ * holding the same values
+ **/
+int ucb_argmax(const float *est, const int *pulled, int n, double c, double log_iter){
+    return get_kernel<float>()(est, pulled, n, c, log_iter);
+}
+
+/**
+ * Writes the upper confidence bound est[i] + c * sqrt(log_iter / (pulled[i] + 1)) of every arm to bounds,
+ * with the kernel ucb_argmax uses, so the highest bound is on the arm ucb_argmax returns
+ **/
+void ucb_bounds(const double *est, const int *pulled, int n, double c, double log_iter, double *bounds){
+    get_bounds_kernel<double>()(est, pulled, n, c, log_iter, bounds);
+}
+
+/**
+ * Same as ucb_bounds for estimates stored as floats
+ **/
+void ucb_bounds(const float *est, const int *pulled, int n, double c, double log_iter, double *bounds){
+    get_bounds_kernel<float>()(est, pulled, n, c, log_iter, bounds);
+}
+
+/**
+ * Returns the name of the kernel picked by ucb_argmax ("avx512", "avx2" or "scalar")
+ **/
+const char *ucb_kernel_name(){
+    get_kernel<double>();
+    return kernel_name;
+}
@@ -0,0 +1,45 @@
+#ifndef UCBKERNEL_FUNCS
+#define UCBKERNEL_FUNCS
+
+/**
+ * Computes the upper confidence bound est[i] + c * sqrt(log_iter / (pulled[i] + 1)) of every arm and
+ * returns the index of the first arm with the highest bound, or -1 when no bound is above 0.
+ * The best kernel the CPU supports (AVX-512, AVX2 or scalar) is picked the first time it is called,
+ * and every kernel returns exactly the same index as the scalar one
+ **/
+int ucb_argmax(const double *est, const int *pulled, int n, double c, double log_iter);
+
+/**
+ * Same as ucb_argmax for estimates stored as floats: they are widened to double as they are loaded, so
+ * only half the bytes of the estimates are read and the bounds are the same as for the double estimates
+ * holding the same values
+ **/
+int ucb_argmax(const float *est, const int *pulled, int n, double c, double log_iter);
+
+/**
+ * Scalar kernel used when the CPU has no supported vector extension
+ **/
+int ucb_argmax_scalar(const double *est, const int *pulled, int n, double c, double log_iter);
+
+/**
+ * Scalar kernel for float estimates used when the CPU has no supported vector extension
+ **/
+int ucb_argmax_scalar(const float *est, const int *pulled, int n, double c, double log_iter);
+
+/**
+ * Writes the upper confidence bound est[i] + c * sqrt(log_iter / (pulled[i] + 1)) of every arm to bounds,
+ * with the kernel ucb_argmax uses, so the highest bound is on the arm ucb_argmax returns
+ **/
+void ucb_bounds(const double *est, const int *pulled, int n, double c, double log_iter, double *bounds);
+
+/**
+ * Same as ucb_bounds for estimates stored as floats
+ **/
+void ucb_bounds(const float *est, const int *pulled, int n, double c, double log_iter, double *bounds);
+
+/**
+ * Returns the name of the kernel picked by ucb_argmax ("avx512", "avx2" or "scalar")
+ **/
+const char *ucb_kernel_name();
+
+#endif
@@ -0,0 +1,945 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+
+#include "Arm.hpp"
+#include "Environment.hpp"
+#include "UCBAgent.hpp"
+#include "LRAgent.hpp"
+#include "FixedUCBAgent.hpp"
+#include "FixedLRAgent.hpp"
+#include "ConcurrentUCBAgent.hpp"
+#include "SweepRunner.hpp"
+#include "PolicySweep.hpp"
+
+#define BENCH_MIN_TIME 0.1 // Seconds every measurement runs for at least
+#define BENCH_REPEATS 5 // Measurements per benchmark, the best one is kept
+#define BENCH_TOLERANCE 0.4 // A result more than this fraction below its baseline fails the run
+#define BENCH_PULLS 1024 // Pulls drawn by one call of the batched pull benchmark
+#define BENCH_SWEEP_BATCH 10 // Environments played in lockstep by the batched sweeps
+#define BENCH_RESIDENT_BYTES (16 << 20) // Double precision state of the resident agents, far more than the caches
+#define PRECISION_TOLERANCE 1e-5 // Largest difference of a reduced-precision value from the double one
+#define PRECISION_RATE_TOLERANCE 0.005 // Largest difference of the mean % reward of a reduced-precision sweep
+#define BENCH_TOP_K 8 // Arms chosen per request by the serving benchmarks
+#define BENCH_FEEDBACK_BATCH 64 // Rewards fed back at once by the serving benchmarks
+#define BENCH_SERVE_TIME 0.2 // Seconds every run of the load generator lasts
+#define BENCH_SERVE_SAMPLES (1 << 18) // Decision latencies recorded per thread of the load generator
+
+/**
+ * Result of a benchmark: operations per second for a number of arms
+ **/
+struct BenchResult {
+    std::string name;
+    int arms;
+    double ops_per_sec;
+};
+
+// Sink for the results of the measured calls so the compiler cannot drop them
+volatile long bench_sink;
+
+// Number of heap allocations made by the benchmark, to check that a sweep allocates nothing per environment
+std::atomic<long> bench_allocations(0);
+
+/**
+ * Counts a heap allocation and takes the memory from malloc, every replaced operator new ends up here.
+ * Kept out of line, like bench_free, so the compiler never pairs a malloc it sees with a delete
+ **/
+__attribute__((noinline)) static void *bench_alloc(size_t size){
+    bench_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+/**
+ * Gives memory from bench_alloc back to free, every replaced operator delete ends up here
+ **/
+__attribute__((noinline)) static void bench_free(void *ptr){ free(ptr); }
+
+/**
+ * Counts every heap allocation, the array and nothrow forms below go through bench_alloc as well
+ **/
+void *operator new(size_t size){
+    void *ptr = bench_alloc(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+/**
+ * Array form of the counting operator new
+ **/
+void *operator new[](size_t size){
+    void *ptr = bench_alloc(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+/**
+ * Nothrow forms of the counting operator new
+ **/
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return bench_alloc(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return bench_alloc(size); }
+
+/**
+ * Frees memory from the counting operator new, in every form that pairs with one of them
+ **/
+void operator delete(void *ptr) noexcept { bench_free(ptr); }
+void operator delete[](void *ptr) noexcept { bench_free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { bench_free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { bench_free(ptr); }
+#ifdef __cpp_sized_deallocation
+void operator delete(void *ptr, size_t) noexcept { bench_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { bench_free(ptr); }
+#endif
+
+#ifdef __cpp_aligned_new
+/**
+ * Aligned forms of the counting operator new (C++17 on), over aligned_alloc with the size rounded up to the
+ * alignment. free releases them, so the aligned deletes pair with them
+ **/
+void *operator new(size_t size, std::align_val_t align){
+    size_t alignment = (size_t)align;
+    bench_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void *operator new[](size_t size, std::align_val_t align){ return operator new(size, align); }
+void operator delete(void *ptr, std::align_val_t) noexcept { bench_free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { bench_free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { bench_free(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { bench_free(ptr); }
+#endif
+
+/**
+ * Runs op(count) with a growing count until one call takes BENCH_MIN_TIME seconds and returns the
+ * best rate (operations per second) of BENCH_REPEATS such calls
+ **/
+template <typename Op>
+double measure(Op op){
+    typedef std::chrono::steady_clock clock;
+    double best = 0;
+    long count = 1;
+
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        for (;;) {
+            clock::time_point start = clock::now();
+            op(count);
+            double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+            if (elapsed >= BENCH_MIN_TIME) {
+                best = std::max(best, count / elapsed);
+                break;
+            }
+            count *= (elapsed < BENCH_MIN_TIME / 10) ? 10 : 2;
+        }
+    }
+    return best;
+}
+
+/**
+ * Rounds per second of the q1 sweep with its default configuration (100 environments of 10 arms,
+ * 5000 iterations, every core) without the dump
+ **/
+double sweep_q1(){
+    int num_of_arms = 10, num_of_envs = 100, num_of_iters = 5000;
+    SweepRunner runner;
+    Environment env;
+    std::vector<UCBAgent> agents(1, UCBAgent(env, "UCB"));
+    std::vector<double> optm, point;
+
+    return measure([&](long count) {
+        for (long sweep = 0; sweep < count; sweep++) {
+            run_policy_sweep(runner, agents, 1, num_of_envs, num_of_arms, num_of_iters, num_of_iters, sweep + 1,
+                             nullptr, [](UCBAgent &ucb, int, int, Environment &e, Rng r) {
+                                 ucb.change_parameters(e, 2.0, r);
+                             }, optm, point);
+            bench_sink += optm[0] * 100;
+        }
+    }) * num_of_envs * num_of_iters;
+}
+
+/**
+ * Rounds per second of the q2 sweep with its default configuration, a round is one L(r-p) and one
+ * L(r-i) round in the same environment
+ **/
+double sweep_q2(){
+    int num_of_arms = 10, num_of_envs = 100, num_of_iters = 5000;
+    SweepRunner runner;
+    Environment env;
+    std::vector<LRAgent> agents = { LRAgent(env, "L(r-p)", 10), LRAgent(env, "L(r-i)", 10, 0) };
+    std::vector<double> optm, point;
+
+    return measure([&](long count) {
+        for (long sweep = 0; sweep < count; sweep++) {
+            run_policy_sweep(runner, agents, 1, num_of_envs, num_of_arms, num_of_iters, num_of_iters, sweep + 1,
+                             nullptr, [](LRAgent &agent, int i, int, Environment &e, Rng r) {
+                                 agent.change_parameters(e, 0.1, i == 0 ? 0.1 : 0, r);
+                             }, optm, point);
+            bench_sink += optm[0] * 100;
+        }
+    }) * num_of_envs * num_of_iters;
+}
+
+/**
+ * Rounds per second of the q1 sweep with the environments played in batches of BENCH_SWEEP_BATCH
+ **/
+double sweep_q1_batched(){
+    int num_of_arms = 10, num_of_envs = 100, num_of_iters = 5000;
+    SweepRunner runner;
+    BatchEnvironment env(1, num_of_arms);
+    std::vector<BatchUCBAgent> agents(1, BatchUCBAgent(env.lane(0), "UCB"));
+    std::vector<double> optm, point;
+
+    return measure([&](long count) {
+        for (long sweep = 0; sweep < count; sweep++) {
+            run_batch_sweep(runner, agents, BENCH_SWEEP_BATCH, 1, num_of_envs, num_of_arms, num_of_iters,
+                            num_of_iters, sweep + 1, nullptr, [](BatchUCBAgent &ucb, int, int, BatchLane &e, Rng r) {
+                                ucb.change_parameters(e, 2.0, r);
+                            }, optm, point);
+            bench_sink += optm[0] * 100;
+        }
+    }) * num_of_envs * num_of_iters;
+}
+
+/**
+ * Rounds per second of the q2 sweep with the environments played in batches of BENCH_SWEEP_BATCH
+ **/
+double sweep_q2_batched(){
+    int num_of_arms = 10, num_of_envs = 100, num_of_iters = 5000;
+    SweepRunner runner;
+    BatchEnvironment env(1, num_of_arms);
+    std::vector<BatchLRAgent> agents = { BatchLRAgent(env.lane(0), "L(r-p)", 10),
+                                         BatchLRAgent(env.lane(0), "L(r-i)", 10, 0) };
+    std::vector<double> optm, point;
+
+    return measure([&](long count) {
+        for (long sweep = 0; sweep < count; sweep++) {
+            run_batch_sweep(runner, agents, BENCH_SWEEP_BATCH, 1, num_of_envs, num_of_arms, num_of_iters,
+                            num_of_iters, sweep + 1, nullptr, [](BatchLRAgent &agent, int i, int, BatchLane &e, Rng r) {
+                                agent.change_parameters(e, 0.1, i == 0 ? 0.1 : 0, r);
+                            }, optm, point);
+            bench_sink += optm[0] * 100;
+        }
+    }) * num_of_envs * num_of_iters;
+}
+
+/**
+ * Rounds per second of the q1 sweep with the UCB agent and environment specialized for its 10 arms
+ **/
+double sweep_q1_fixed(){
+    int num_of_envs = 100, num_of_iters = 5000;
+    SweepRunner runner;
+    FixedEnvironment<10> env;
+    std::vector<FixedUCBAgent<10>> agents(1, FixedUCBAgent<10>(env, "UCB"));
+    std::vector<double> optm, point;
+
+    return measure([&](long count) {
+        for (long sweep = 0; sweep < count; sweep++) {
+            run_policy_sweep(runner, agents, 1, num_of_envs, 10, num_of_iters, num_of_iters, sweep + 1, nullptr,
+                             [](FixedUCBAgent<10> &ucb, int, int, FixedEnvironment<10> &e, Rng r) {
+                                 ucb.change_parameters(e, 2.0, r);
+                             }, optm, point);
+            bench_sink += optm[0] * 100;
+        }
+    }) * num_of_envs * num_of_iters;
+}
+
+/**
+ * Rounds per second of the q2 sweep with the L(r-p) and L(r-i) agents and environment specialized for its
+ * 10 arms
+ **/
+double sweep_q2_fixed(){
+    int num_of_envs = 100, num_of_iters = 5000;
+    SweepRunner runner;
+    FixedEnvironment<10> env;
+    std::vector<FixedLRAgent<10>> agents = { FixedLRAgent<10>(env, "L(r-p)", 10), FixedLRAgent<10>(env, "L(r-i)", 10, 0) };
+    std::vector<double> optm, point;
+
+    return measure([&](long count) {
+        for (long sweep = 0; sweep < count; sweep++) {
+            run_policy_sweep(runner, agents, 1, num_of_envs, 10, num_of_iters, num_of_iters, sweep + 1, nullptr,
+                             [](FixedLRAgent<10> &agent, int i, int, FixedEnvironment<10> &e, Rng r) {
+                                 agent.change_parameters(e, 0.1, i == 0 ? 0.1 : 0, r);
+                             }, optm, point);
+            bench_sink += optm[0] * 100;
+        }
+    }) * num_of_envs * num_of_iters;
+}
+
+/**
+ * Heap allocations of a scalar sweep (the UCB agent, then the L(r-p) and L(r-i) agents) of num_of_envs
+ * environments of 10 arms without the dump
+ **/
+long policy_sweep_allocations(int num_of_envs){
+    SweepRunner runner;
+    Environment env;
+    std::vector<double> optm, point;
+    long start = bench_allocations.load();
+
+    run_policy_sweep(runner, std::vector<UCBAgent>(1, UCBAgent(env, "UCB")), 1, num_of_envs, 10, 1000, 100, 1,
+                     nullptr, [](UCBAgent &ucb, int, int, Environment &e, Rng r) {
+                         ucb.change_parameters(e, 2.0, r);
+                     }, optm, point);
+    run_policy_sweep(runner, std::vector<LRAgent>{ LRAgent(env, "L(r-p)", 10), LRAgent(env, "L(r-i)", 10, 0) }, 1, num_of_envs, 10, 1000, 100, 1,
+                     nullptr, [](LRAgent &agent, int i, int, Environment &e, Rng r) {
+                         agent.change_parameters(e, 0.1, i == 0 ? 0.1 : 0, r);
+                     }, optm, point);
+    return bench_allocations.load() - start;
+}
+
+/**
+ * Checks that regenerating an environment and resetting the agents allocates nothing: a sweep of 200
+ * environments must allocate as much as one of 100 (only the workers, their agents and pools allocate).
+ * Returns the number of failed checks
+ **/
+int check_allocations(){
+    long sweep_extra = policy_sweep_allocations(200) - policy_sweep_allocations(100);
+
+    std::cout << "Allocations for 100 more environments of a policy sweep: " << sweep_extra << std::endl;
+
+    int failures = 0;
+    if (sweep_extra != 0) {
+        std::cerr << "Allocation check: the policy sweep allocates per environment" << std::endl;
+        failures++;
+    }
+    return failures;
+}
+
+/**
+ * Replays the same choices and rewards (drawn from the double agent) on a LinearRewardUpdateOf<Prob> and
+ * the double one for dense arm counts, and raises max_error to the largest difference of a probability and
+ * max_sum_error to the largest difference of their sum from 1
+ **/
+template <class Prob>
+void lr_precision_error(double beta, double &max_error, double &max_sum_error){
+    for (int trial = 0; trial < 20; trial++) {
+        int n = 2 + trial * (LR_TREE_MIN_ARMS - 3) / 19;
+        LinearRewardUpdate exact(0.1, beta);
+        LinearRewardUpdateOf<Prob> reduced(0.1, beta);
+        exact.reset(n);
+        reduced.reset(n);
+        Rng rng(1, trial);
+
+        for (int round = 1; round <= 10000; round++) {
+            int choice = exact.sample(rng.next_double());
+            int reward = (rng.next_double() < 0.5) ? 1 : 0;
+            exact.update(choice < 0 ? n - 1 : choice, reward, round);
+            reduced.update(choice < 0 ? n - 1 : choice, reward, round);
+            if (round % 100 != 0)
+                continue;
+
+            double sum = 0;
+            for (int i = 0; i < n; i++) {
+                max_error = std::max(max_error, std::abs(reduced.get_prob(i) - exact.get_prob(i)));
+                sum += reduced.get_prob(i);
+            }
+            max_sum_error = std::max(max_sum_error, std::abs(sum - 1));
+        }
+    }
+}
+
+/**
+ * Largest difference between the float and double estimates of a SampleMeanUpdate over the same pulls
+ **/
+double ucb_precision_error(){
+    double max_error = 0;
+    for (int trial = 0; trial < 20; trial++) {
+        int n = 2 + trial * (UCB_INDEX_MIN_ARMS - 3) / 19;
+        SampleMeanUpdate exact;
+        SampleMeanUpdateOf<float> reduced;
+        exact.reset(n);
+        reduced.reset(n);
+        Rng rng(2, trial);
+
+        for (int round = 1; round <= 10000; round++) {
+            int choice = (int)(rng.next_double() * n);
+            int reward = (rng.next_double() < 0.3) ? 1 : 0;
+            exact.update(choice, reward, round);
+            reduced.update(choice, reward, round);
+        }
+        for (int i = 0; i < n; i++)
+            max_error = std::max(max_error, std::abs((double)reduced.estimates()[i] - exact.estimates()[i]));
+    }
+    return max_error;
+}
+
+/**
+ * Mean % reward of every agent in a policy sweep of 200 environments of 10 arms
+ **/
+template <class AgentType, class Setup>
+std::vector<double> sweep_reward_rates(const std::vector<AgentType> &agents, Setup setup){
+    SweepRunner runner;
+    std::vector<double> optm, point, rates(agents.size(), 0);
+    run_policy_sweep(runner, agents, 1, 200, 10, 2000, 100, 1, nullptr, setup, optm, point);
+    for (size_t i = 0; i < point.size(); i++)
+        rates[i / 200] += point[i] / 200;
+    return rates;
+}
+
+/**
+ * Largest difference of the mean % reward of UCB, L(r-p) and L(r-i) sweeps with the reduced-precision agents
+ * of type UCBType and LRType from the double ones
+ **/
+template <class UCBType, class LRType>
+double sweep_precision_error(){
+    Environment env;
+    auto ucb_setup = [](UCBAgent &ucb, int, int, Environment &e, Rng r) { ucb.change_parameters(e, 2.0, r); };
+    auto reduced_ucb_setup = [](UCBType &ucb, int, int, Environment &e, Rng r) { ucb.change_parameters(e, 2.0, r); };
+    auto lr_setup = [](LRAgent &agent, int i, int, Environment &e, Rng r) {
+        agent.change_parameters(e, 0.1, i == 0 ? 0.1 : 0, r);
+    };
+    auto reduced_lr_setup = [](LRType &agent, int i, int, Environment &e, Rng r) {
+        agent.change_parameters(e, 0.1, i == 0 ? 0.1 : 0, r);
+    };
+
+    std::vector<double> exact = sweep_reward_rates(std::vector<UCBAgent>(1, UCBAgent(env, "UCB")), ucb_setup);
+    std::vector<double> reduced = sweep_reward_rates(std::vector<UCBType>(1, UCBType(env, "UCB")), reduced_ucb_setup);
+    std::vector<double> lr_exact = sweep_reward_rates(std::vector<LRAgent>{ LRAgent(env, "L(r-p)", 10),
+                                                                           LRAgent(env, "L(r-i)", 10, 0) }, lr_setup);
+    std::vector<double> lr_reduced = sweep_reward_rates(std::vector<LRType>{ LRType(env, "L(r-p)", 10),
+                                                                            LRType(env, "L(r-i)", 10, 0) },
+                                                        reduced_lr_setup);
+    exact.insert(exact.end(), lr_exact.begin(), lr_exact.end());
+    reduced.insert(reduced.end(), lr_reduced.begin(), lr_reduced.end());
+
+    double max_error = 0;
+    for (size_t i = 0; i < exact.size(); i++)
+        max_error = std::max(max_error, std::abs(reduced[i] - exact[i]));
+    return max_error;
+}
+
+/**
+ * Checks the reduced-precision agents against the double ones: on the same rewards every value must stay
+ * within PRECISION_TOLERANCE of the double one (and the probabilities must sum to 1 as closely), and the mean
+ * % reward of a sweep within PRECISION_RATE_TOLERANCE. Returns the number of failed checks
+ **/
+int check_precision(){
+    double float_error = 0, float_sum_error = 0, fixed_error = 0, fixed_sum_error = 0;
+    for (double beta : { 0.1, 0.0 }) {
+        lr_precision_error<float>(beta, float_error, float_sum_error);
+        lr_precision_error<FixedProb>(beta, fixed_error, fixed_sum_error);
+    }
+    double ucb_error = ucb_precision_error();
+    double float_rate_error = sweep_precision_error<FloatUCBAgent, FloatLRAgent>();
+    double fixed_rate_error = sweep_precision_error<FloatUCBAgent, FixedPointLRAgent>();
+
+    std::cout << std::scientific << std::setprecision(2)
+              << "Precision: float UCB estimates within " << ucb_error << ", float L(r-p)/L(r-i) probabilities within "
+              << float_error << " (sum " << float_sum_error << "), fixed point within " << fixed_error << " (sum "
+              << fixed_sum_error << ")" << std::endl
+              << "Precision: mean % reward of the sweeps within " << float_rate_error << " (float) and "
+              << fixed_rate_error << " (fixed point L(r-p)/L(r-i))" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+
+    int failures = 0;
+    if (std::max(ucb_error, std::max(float_error, fixed_error)) > PRECISION_TOLERANCE ||
+        std::max(float_sum_error, fixed_sum_error) > PRECISION_TOLERANCE) {
+        std::cerr << "Precision check: a reduced-precision agent strays from the double one" << std::endl;
+        failures++;
+    }
+    if (std::max(float_rate_error, fixed_rate_error) > PRECISION_RATE_TOLERANCE) {
+        std::cerr << "Precision check: a reduced-precision sweep gives other results" << std::endl;
+        failures++;
+    }
+    return failures;
+}
+
+/**
+ * Largest difference between the probabilities of a LinearRewardUpdateOf<Prob> that learns batches of
+ * BENCH_FEEDBACK_BATCH rewards at once and one that learns them one at a time, for dense arm counts
+ **/
+template <class Prob>
+double feedback_fold_error(double beta){
+    double max_error = 0;
+    std::vector<Feedback> batch(BENCH_FEEDBACK_BATCH);
+    for (int trial = 0; trial < 20; trial++) {
+        int n = 2 + trial * (LR_TREE_MIN_ARMS - 3) / 19;
+        LinearRewardUpdateOf<Prob> single(0.1, beta), folded(0.1, beta);
+        single.reset(n);
+        folded.reset(n);
+        Rng rng(3, trial);
+
+        for (int round = 1; round <= 10000; round += BENCH_FEEDBACK_BATCH) {
+            for (auto &feedback : batch) {
+                feedback.arm = (int)(rng.next_double() * n);
+                feedback.reward = (rng.next_double() < 0.5) ? 1 : 0;
+            }
+            for (int i = 0; i < BENCH_FEEDBACK_BATCH; i++)
+                single.update(batch[i].arm, batch[i].reward, round + i);
+            folded.update_batch(batch.data(), BENCH_FEEDBACK_BATCH, round);
+        }
+        for (int i = 0; i < n; i++)
+            max_error = std::max(max_error, std::abs(folded.get_prob(i) - single.get_prob(i)));
+    }
+    return max_error;
+}
+
+/**
+ * Checks the serving calls: batches of feedback folded at once must stay within PRECISION_TOLERANCE of
+ * one update at a time, the first of the top k UCB arms must be the arm choose_arm picks, and the arms
+ * drawn without replacement must be different. Returns the number of failed checks
+ **/
+int check_feedback(){
+    double fold_error = 0;
+    for (double beta : { 0.1, 0.0 }) {
+        fold_error = std::max(fold_error, feedback_fold_error<double>(beta));
+        fold_error = std::max(fold_error, feedback_fold_error<float>(beta));
+        fold_error = std::max(fold_error, feedback_fold_error<FixedProb>(beta));
+    }
+
+    int requests = 0, top_mismatches = 0, repeated = 0;
+    std::vector<int> choices(BENCH_TOP_K);
+    std::vector<Feedback> batch;
+    for (int arms : { 10, UCB_INDEX_MIN_ARMS + 100 }) {
+        Environment env(arms, Rng(4));
+        Rng reward_rng(4, 0, 0, 3);
+        UCBAgent ucb(env, "UCB");
+        ucb.change_parameters(env, 2.0, Rng(4, 0, 0, 1));
+        LRAgent lrp(env, "L(r-p)");
+        lrp.change_parameters(env, 0.1, 0.1, Rng(4, 0, 0, 2));
+
+        for (int request = 0; request < 1000; request++) {
+            int count = ucb.choose_top_k(BENCH_TOP_K, choices.data());
+            requests++;
+            top_mismatches += (count == 0 || choices[0] != ucb.choose_arm()) ? 1 : 0;
+            batch.clear();
+            for (int i = 0; i < count; i++)
+                batch.push_back({ choices[i], env.pull_chosen_arm(choices[i], reward_rng) });
+            ucb.apply_feedback(batch.data(), batch.size());
+
+            count = lrp.choose_without_replacement(BENCH_TOP_K, choices.data());
+            std::sort(choices.begin(), choices.begin() + count);
+            repeated += (std::unique(choices.begin(), choices.begin() + count) != choices.begin() + count) ? 1 : 0;
+            batch.clear();
+            for (int i = 0; i < count; i++)
+                batch.push_back({ choices[i], env.pull_chosen_arm(choices[i], reward_rng) });
+            lrp.apply_feedback(batch.data(), batch.size());
+        }
+    }
+
+    std::cout << std::scientific << std::setprecision(2) << "Feedback: batches folded within " << fold_error
+              << " of one update at a time, " << top_mismatches << "/" << requests << " top " << BENCH_TOP_K
+              << " requests not led by choose_arm, " << repeated << " draws with a repeated arm" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+
+    int failures = 0;
+    if (fold_error > PRECISION_TOLERANCE) {
+        std::cerr << "Feedback check: a folded batch strays from one update at a time" << std::endl;
+        failures++;
+    }
+    if (top_mismatches > 0 || repeated > 0) {
+        std::cerr << "Feedback check: a request chose the wrong arms" << std::endl;
+        failures++;
+    }
+    return failures;
+}
+
+/**
+ * Load generator for a ConcurrentUCBAgent: num_of_threads threads make decisions with views of their own for
+ * BENCH_SERVE_TIME seconds and report the rewards of every BENCH_FEEDBACK_BATCH decisions at once to a shard
+ * of their own, so decisions run while other threads count feedback. Returns the decisions per second of all
+ * threads and sets p50 and p99 to percentiles of the latency of a decision in nanoseconds. The agent is
+ * left with the counters of the run
+ **/
+double serve_load(ConcurrentUCBAgent &agent, const Environment &env, int num_of_threads, double &p50, double &p99){
+    typedef std::chrono::steady_clock clock;
+    std::vector<std::vector<float>> latencies(num_of_threads);
+    std::vector<long> decisions(num_of_threads, 0);
+    std::atomic<int> ready(0);
+    std::atomic<bool> start(false), stop(false);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_of_threads; t++) {
+        latencies[t].reserve(BENCH_SERVE_SAMPLES);
+        threads.emplace_back([&, t]() {
+            Environment thread_env(env);
+            Rng reward_rng(5, 0, t, 1);
+            ConcurrentUCBView view;
+            Feedback batch[BENCH_FEEDBACK_BATCH];
+            int pending = 0;
+
+            ready++;
+            while (!start.load(std::memory_order_acquire));
+            while (!stop.load(std::memory_order_relaxed)) {
+                clock::time_point before = clock::now();
+                int arm = agent.choose(view);
+                clock::time_point after = clock::now();
+                if (latencies[t].size() < BENCH_SERVE_SAMPLES)
+                    latencies[t].push_back(std::chrono::duration<float, std::nano>(after - before).count());
+
+                if (arm < 0)
+                    continue;
+                batch[pending].arm = arm;
+                batch[pending].reward = thread_env.pull_chosen_arm(arm, reward_rng);
+                if (++pending == BENCH_FEEDBACK_BATCH) {
+                    agent.apply_feedback(t, batch, pending);
+                    pending = 0;
+                }
+            }
+            decisions[t] = view.get_decisions();
+        });
+    }
+
+    while (ready.load() < num_of_threads);
+    clock::time_point begin = clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(BENCH_SERVE_TIME));
+    stop.store(true);
+    for (auto &thread : threads)
+        thread.join();
+    double elapsed = std::chrono::duration<double>(clock::now() - begin).count();
+
+    std::vector<float> all;
+    long total = 0;
+    for (int t = 0; t < num_of_threads; t++) {
+        all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+        total += decisions[t];
+    }
+    std::nth_element(all.begin(), all.begin() + all.size() / 2, all.end());
+    p50 = all[all.size() / 2];
+    std::nth_element(all.begin(), all.begin() + all.size() * 99 / 100, all.end());
+    p99 = all[all.size() * 99 / 100];
+    return total / elapsed;
+}
+
+/**
+ * Checks that a ConcurrentUCBAgent counts every feedback of four threads that decide and report at once.
+ * Returns the number of failed checks
+ **/
+int check_serving(){
+    const int num_of_threads = 4, reports = 20000;
+    Environment env(UCB_INDEX_MIN_ARMS + 100, Rng(6));
+    ConcurrentUCBAgent agent(env.get_arms_size());
+    std::vector<long> decisions(num_of_threads, 0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_of_threads; t++)
+        threads.emplace_back([&, t]() {
+            ConcurrentUCBView view;
+            for (int i = 0; i < reports; i++) {
+                Feedback feedback = { agent.choose(view), (i % 3 == 0) ? 1 : 0 };
+                // Every thread also writes the shard of the next one, so shards are shared as well
+                agent.apply_feedback(t + (i & 1), &feedback, 1);
+            }
+            decisions[t] = view.get_decisions();
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    long expected_points = (long)num_of_threads * ((reports + 2) / 3);
+    long total_decisions = 0;
+    for (long count : decisions)
+        total_decisions += count;
+    std::cout << "Serving: " << num_of_threads << " threads counted " << agent.get_rounds() << "/"
+              << (long)num_of_threads * reports << " feedbacks and " << agent.get_points() << "/" << expected_points
+              << " rewards" << std::endl;
+
+    if (agent.get_rounds() != (long)num_of_threads * reports || agent.get_points() != expected_points ||
+        total_decisions != (long)num_of_threads * reports) {
+        std::cerr << "Serving check: the concurrent agent lost feedback" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Rounds per second of as many agents of AgentType with arms arms as fill BENCH_RESIDENT_BYTES with double
+ * precision state, playing one round each in turn so their state does not stay in the caches.
+ * setup(agent, env, rng) resets an agent
+ **/
+template <class AgentType, class Setup>
+double resident_rounds(int arms, Setup setup){
+    Environment env(arms, Rng(1));
+    int num_of_agents = BENCH_RESIDENT_BYTES / (arms * sizeof(double));
+    std::vector<AgentType> agents(num_of_agents, AgentType(env, "resident"));
+    for (int i = 0; i < num_of_agents; i++)
+        setup(agents[i], env, Rng(1, 0, 0, i + 1));
+
+    return measure([&](long count) {
+        for (long round = 0; round < count; round++)
+            for (auto &agent : agents)
+                agent.exec_round();
+        bench_sink += agents[0].get_points();
+    }) * num_of_agents;
+}
+
+/**
+ * Runs every benchmark and prints its result as it finishes
+ **/
+std::vector<BenchResult> run_benchmarks(){
+    std::vector<BenchResult> results;
+    std::vector<int> arm_counts = { 10, 100, 10000, 1000000 };
+
+    auto report = [&](const std::string &name, int arms, double ops) {
+        BenchResult result = { name, arms, ops };
+        results.push_back(result);
+        std::cout << std::left << std::setw(20) << name << std::right << std::setw(10) << arms
+                  << std::setw(16) << std::scientific << std::setprecision(3) << ops << " ops/s" << std::endl;
+    };
+
+    Rng rng(1);
+    Arm arm(rng);
+    report("arm_pull_arm", 1, measure([&](long count) {
+        long total = 0;
+        for (long i = 0; i < count; i++)
+            total += arm.pull_arm(rng);
+        bench_sink += total;
+    }));
+
+    // One pull at a time against pulls drawn in blocks, a batch of BENCH_PULLS random choices of 10 arms
+    Environment pull_env(10, Rng(1));
+    std::vector<int> pull_choices(BENCH_PULLS), pull_rewards(BENCH_PULLS);
+    for (int i = 0; i < BENCH_PULLS; i++)
+        pull_choices[i] = rng.next_u64() % 10;
+    report("env_pull_chosen_arm", 10, measure([&](long count) {
+        long total = 0;
+        for (long i = 0; i < count; i++)
+            total += pull_env.pull_chosen_arm(pull_choices[i % BENCH_PULLS], rng);
+        bench_sink += total;
+    }));
+    report("env_pull_many", 10, measure([&](long count) {
+        long total = 0;
+        for (long i = 0; i < count; i += BENCH_PULLS) {
+            pull_env.pull_many(pull_choices.data(), BENCH_PULLS, pull_rewards.data(), rng);
+            total += pull_rewards[0];
+        }
+        bench_sink += total;
+    }));
+
+    for (int arms : arm_counts) {
+        report("env_construct", arms, measure([&](long count) {
+            for (long i = 0; i < count; i++) {
+                Environment env(arms, Rng(1, 0, i));
+                bench_sink += env.get_arms_size();
+            }
+        }));
+
+        // A random walk step of one arm every round, the best arm is kept current by the max-tree
+        Environment drift_env(0);
+        drift_env.set_drift(Drift(DRIFT_RANDOM_WALK));
+        drift_env.regenerate(arms, Rng(1));
+        report("env_drift_round", arms, measure([&](long count) {
+            for (long i = 0; i < count; i++) {
+                drift_env.next_round();
+                bench_sink += drift_env.is_optimal(0);
+            }
+        }));
+
+        Environment env(arms, Rng(1));
+
+        // The agents are warmed up so every arm has been tried before they are measured
+        UCBAgent ucb(env, "UCB");
+        ucb.change_parameters(env, 2.0, Rng(1, 0, 0, 1));
+        for (int i = 0; i < std::min(arms, 100000); i++)
+            ucb.exec_round();
+        // From UCB_INDEX_MIN_ARMS arms on choose_arm only reads the root of the index while no round is
+        // played, the selection is timed by ucb_exec_round alone
+        if (arms < UCB_INDEX_MIN_ARMS) {
+            report("ucb_choose_arm", arms, measure([&](long count) {
+                long total = 0;
+                for (long i = 0; i < count; i++)
+                    total += ucb.choose_arm();
+                bench_sink += total;
+            }));
+        }
+        report("ucb_exec_round", arms, measure([&](long count) {
+            for (long i = 0; i < count; i++)
+                ucb.exec_round();
+            bench_sink += ucb.get_points();
+        }));
+
+        LRAgent lrp(env, "L(r-p)", 10);
+        lrp.change_parameters(env, 0.1, 0.1, Rng(1, 0, 0, 2));
+        report("lr_choose_arm", arms, measure([&](long count) {
+            long total = 0;
+            for (long i = 0; i < count; i++)
+                total += lrp.choose_arm();
+            bench_sink += total;
+        }));
+        report("lr_exec_round", arms, measure([&](long count) {
+            for (long i = 0; i < count; i++)
+                lrp.exec_round();
+            bench_sink += lrp.get_points();
+        }));
+    }
+
+    // Requests of BENCH_TOP_K arms, and their rewards fed back in batches or one at a time (dense and tree/index)
+    for (int arms : { LR_TREE_MIN_ARMS - 16, 10000 }) {
+        Environment env(arms, Rng(1));
+        Rng reward_rng(1, 0, 0, 3);
+        int choices[BENCH_TOP_K];
+        std::vector<Feedback> batch;
+
+        UCBAgent ucb(env, "UCB");
+        ucb.change_parameters(env, 2.0, Rng(1, 0, 0, 1));
+        for (int i = 0; i < std::min(arms, 100000); i++)
+            ucb.exec_round();
+        report("ucb_top_k", arms, measure([&](long count) {
+            long total = 0;
+            for (long i = 0; i < count; i++)
+                total += ucb.choose_top_k(BENCH_TOP_K, choices);
+            bench_sink += total;
+        }));
+        while (batch.size() < BENCH_FEEDBACK_BATCH) {
+            int count = ucb.choose_top_k(BENCH_TOP_K, choices);
+            for (int i = 0; i < count && batch.size() < BENCH_FEEDBACK_BATCH; i++)
+                batch.push_back({ choices[i], env.pull_chosen_arm(choices[i], reward_rng) });
+        }
+        report("ucb_feedback_single", arms, measure([&](long count) {
+            for (long i = 0; i < count; i++)
+                for (auto &feedback : batch)
+                    ucb.apply_feedback(&feedback, 1);
+            bench_sink += ucb.get_points();
+        }) * BENCH_FEEDBACK_BATCH);
+        report("ucb_feedback_batch", arms, measure([&](long count) {
+            for (long i = 0; i < count; i++)
+                ucb.apply_feedback(batch.data(), batch.size());
+            bench_sink += ucb.get_points();
+        }) * BENCH_FEEDBACK_BATCH);
+
+        LRAgent lrp(env, "L(r-p)");
+        lrp.change_parameters(env, 0.1, 0.1, Rng(1, 0, 0, 2));
+        report("lr_sample_k", arms, measure([&](long count) {
+            long total = 0;
+            for (long i = 0; i < count; i++)
+                total += lrp.choose_without_replacement(BENCH_TOP_K, choices);
+            bench_sink += total;
+        }));
+        batch.clear();
+        while (batch.size() < BENCH_FEEDBACK_BATCH) {
+            int count = lrp.choose_without_replacement(BENCH_TOP_K, choices);
+            for (int i = 0; i < count && batch.size() < BENCH_FEEDBACK_BATCH; i++)
+                batch.push_back({ choices[i], env.pull_chosen_arm(choices[i], reward_rng) });
+        }
+        report("lr_feedback_single", arms, measure([&](long count) {
+            for (long i = 0; i < count; i++)
+                for (auto &feedback : batch)
+                    lrp.apply_feedback(&feedback, 1);
+            bench_sink += lrp.get_points();
+        }) * BENCH_FEEDBACK_BATCH);
+        report("lr_feedback_batch", arms, measure([&](long count) {
+            for (long i = 0; i < count; i++)
+                lrp.apply_feedback(batch.data(), batch.size());
+            bench_sink += lrp.get_points();
+        }) * BENCH_FEEDBACK_BATCH);
+    }
+
+    // The concurrent agent as a decision service under a growing number of threads
+    for (int arms : { 100, 10000 }) {
+        Environment env(arms, Rng(5));
+        for (int num_of_threads : { 1, 2, 4, 8 }) {
+            ConcurrentUCBAgent agent(arms);
+            double p50 = 0, p99 = 0;
+            double rate = serve_load(agent, env, num_of_threads, p50, p99);
+            report("serve_threads_" + std::to_string(num_of_threads), arms, rate);
+            std::cout << std::fixed << std::setprecision(0) << "    decision latency p50 " << p50 << " ns, p99 "
+                      << p99 << " ns" << std::endl;
+        }
+    }
+
+    // Many agents on the dense paths with their state in double, float and fixed point
+    auto ucb_setup = [](UCBAgent &ucb, Environment &e, Rng r) { ucb.change_parameters(e, 2.0, r); };
+    auto float_ucb_setup = [](FloatUCBAgent &ucb, Environment &e, Rng r) { ucb.change_parameters(e, 2.0, r); };
+    auto lr_setup = [](LRAgent &lrp, Environment &e, Rng r) { lrp.change_parameters(e, 0.1, 0.1, r); };
+    auto float_lr_setup = [](FloatLRAgent &lrp, Environment &e, Rng r) { lrp.change_parameters(e, 0.1, 0.1, r); };
+    auto fixed_lr_setup = [](FixedPointLRAgent &lrp, Environment &e, Rng r) {
+        lrp.change_parameters(e, 0.1, 0.1, r);
+    };
+    int resident_ucb_arms = UCB_INDEX_MIN_ARMS - 28, resident_lr_arms = LR_TREE_MIN_ARMS - 16;
+    report("resident_ucb_round", resident_ucb_arms, resident_rounds<UCBAgent>(resident_ucb_arms, ucb_setup));
+    report("resident_float_ucb_round", resident_ucb_arms,
+           resident_rounds<FloatUCBAgent>(resident_ucb_arms, float_ucb_setup));
+    report("resident_lr_round", resident_lr_arms, resident_rounds<LRAgent>(resident_lr_arms, lr_setup));
+    report("resident_float_lr_round", resident_lr_arms,
+           resident_rounds<FloatLRAgent>(resident_lr_arms, float_lr_setup));
+    report("resident_fixed_lr_round", resident_lr_arms,
+           resident_rounds<FixedPointLRAgent>(resident_lr_arms, fixed_lr_setup));
+
+    report("sweep_q1_rounds", 10, sweep_q1());
+    report("sweep_q2_rounds", 10, sweep_q2());
+    report("sweep_q1_batched_rounds", 10, sweep_q1_batched());
+    report("sweep_q2_batched_rounds", 10, sweep_q2_batched());
+    report("sweep_q1_fixed_rounds", 10, sweep_q1_fixed());
+    report("sweep_q2_fixed_rounds", 10, sweep_q2_fixed());
+    return results;
+}
+
+/**
+ * Reads a results or baseline file, the key of every entry is "name arms"
+ **/
+std::map<std::string, double> read_results(const std::string &file_name){
+    std::map<std::string, double> results;
+    std::ifstream file(file_name);
+    std::string line;
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string name;
+        int arms;
+        double ops;
+        if (fields >> name >> arms >> ops)
+            results[name + " " + std::to_string(arms)] = ops;
+    }
+    return results;
+}
+
+/**
+ * Runs the benchmarks, writes the results to a tab separated file and compares them with a baseline
+ * Usage: ./bench.o <results file> [baseline file]
+ * Returns 1 when a result is more than BENCH_TOLERANCE below its baseline or the allocation, precision,
+ * feedback or serving check fails
+ **/
+int main(int argc, char **argv){
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <results file> [baseline file]" << std::endl;
+        return 1;
+    }
+
+    // The baseline only means something on the machine that wrote it, so none is shipped and a run without
+    // one only records its results
+    std::map<std::string, double> baseline;
+    if (argc > 2)
+        baseline = read_results(argv[2]);
+    if (argc > 2 && baseline.empty())
+        std::cout << "No results in " << argv[2] << ", nothing to compare with (make baseline stores them)"
+                  << std::endl;
+
+    int failures = check_allocations() + check_precision() + check_feedback() + check_serving();
+    std::vector<BenchResult> results = run_benchmarks();
+
+    std::ofstream file(argv[1], std::ofstream::trunc);
+    file << "# name\tarms\tops_per_sec\tbaseline\tratio\tstatus" << std::endl;
+
+    int regressions = 0;
+    for (auto &result : results) {
+        auto found = baseline.find(result.name + " " + std::to_string(result.arms));
+        double base = (found == baseline.end()) ? 0 : found->second;
+        double ratio = (base > 0) ? result.ops_per_sec / base : 0;
+        const char *status = (base <= 0) ? "new" : (ratio < 1.0 - BENCH_TOLERANCE) ? "REGRESSION" : "ok";
+
+        file << result.name << "\t" << result.arms << "\t" << std::scientific << std::setprecision(4)
+             << result.ops_per_sec << "\t" << base << "\t" << std::fixed << std::setprecision(3)
+             << ratio << "\t" << status << std::endl;
+
+        if (base > 0 && ratio < 1.0 - BENCH_TOLERANCE) {
+            std::cerr << "Regression: " << result.name << " (" << result.arms << " arms) runs at "
+                      << std::fixed << std::setprecision(1) << ratio * 100 << "% of its baseline" << std::endl;
+            regressions++;
+        }
+    }
+    return (regressions > 0 || failures > 0) ? 1 : 0;
+}
@@ -5,10 +5,21 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 
 #include "Environment.hpp"
 #include "Arm.hpp"
 #include "UCBAgent.hpp"
+#include "FixedUCBAgent.hpp"
+#include "SweepRunner.hpp"
+#include "PolicySweep.hpp"
+#include "DumpWriter.hpp"
+#include "Profiler.hpp"
+#include "SequentialStopping.hpp"
+#include "LearningCurves.hpp"
+#include "Shard.hpp"
+#include "Checkpoint.hpp"
 
 #define COL_WIDTH std::setw(10) // Formatting support for printing the statistics
 #define COL_WIDTH_2 std::setw(12) // To align numerical values with their heading
@@ -16,19 +27,33 @@
 
 
 void print_stats(std::vector<double> cons_val,std::vector<std::vector<double>> ucb_results, 
-                int size_of_cons_val, std::string stats_file_name);
+                int size_of_cons_val, std::string stats_file_name, SequentialStopping *stopping);
+
+// Sweep of the UCB agent specialized for a number of arms known at compile time, see run_fixed_ucb_sweep
+typedef void (*FixedUCBSweep)(SweepRunner &runner, const std::vector<double> &cons_val, int num_of_envs,
+                              int num_of_iters, int print_freq, unsigned long seed, DumpWriter *dump_writer,
+                              std::vector<double> &optm, std::vector<double> &point,
+                              const std::vector<RewardTape> *tapes, const std::vector<int> *jobs,
+                              const Drift &drift);
+FixedUCBSweep get_fixed_ucb_sweep(int num_of_arms);
 
 /**
  * Main function that executes the program
  **/
-int main(){
+int main(int argc, char **argv){
 
     //-------------------------------------------------------------------------------------------------------//
     //-------------------------------------------------------------------------------------------------------//
 
-    // Dump and stats file names
+    // Dump, stats and learning curve file names
     std::string dump_file_name = "q1.out";
+    std::string trace_file_name = "q1.trace";
     std::string stats_file_name = "q1_stats";
+    std::string curves_file_name = "q1_curves";
+    std::string checkpoint_file_name = "q1.ckpt";
+
+    // Chrome trace of the profiler, only written by a profiling build (make q1 PROFILE=1)
+    std::string profile_file_name = "q1_profile.json";
 
     // Should we collect stats?
     bool collect_stats = true;
@@ -36,6 +61,14 @@ int main(){
     // Should we collect iteration data?
     bool collect_iter_data = true;
 
+    // Should we collect learning curves? (mean and standard deviation over the environments of the reward
+    // rate, optimal arm rate and regret every print_freq iterations, written to q1_curves without the dump)
+    bool collect_curves = false;
+
+    // Should the iteration data be written as a compact binary trace instead of the text dump?
+    // (./trace2text.o q1.trace q1.out rebuilds the text dump from the trace)
+    bool binary_trace = false;
+
     // How often (once every how many iterations) should we print stats of the iteration?
     int print_freq = 100;
 
@@ -54,37 +87,140 @@ int main(){
 
     // The full number of executions will be cons_val.size() * num_of_envs * num_of_iters
 
+    // Number of threads the environments are spread over (0 uses every available core)
+    int num_of_threads = 0;
+
+    // Number of environments of a conf value played in lockstep by batched agents (BatchAgent.hpp), 1 plays every
+    // environment on its own. Same results either way
+    int batch_size = 1;
+
+    // Should the sweep play the UCB agent and environment specialized for num_of_arms at compile time
+    // (FixedUCBAgent.hpp) when there is one (2-6, 8, 10, 12, 16, 20, 24, 32, 48 or 64 arms)? Same results,
+    // batch_size > 1 takes precedence
+    bool fixed_agents = true;
+
+    // Should every conf value play the same environments with the same pre-generated rewards (common random
+    // numbers)? Differences between conf values then need far fewer environments to show, the tapes take
+    // num_of_envs * num_of_arms * num_of_iters / 8 bytes
+    bool common_random_numbers = false;
+
+    // Should every conf value stop adding environments once the confidence interval of its % reward is
+    // narrower than target_ci_width? It starts with min_envs environments and adds wave_envs at a time
+    // up to num_of_envs, the stats then show the environments used
+    bool sequential_stopping = false;
+    int min_envs = 20;
+    int wave_envs = 10;
+    double target_ci_width = 0.05;
+
+    // Should conf values whose % reward is clearly below the best one stop early? (sequential stopping only)
+    bool drop_losers = true;
+
+    // Size of the shards of a sharded sweep. ./q1.o --shard i runs
+    // shard i alone, --merge prints the stats of every shard and --coordinate [workers] runs the shards on
+    // worker processes and merges them (no dump, curves or sequential stopping)
+    int configs_per_shard = 1;
+    int envs_per_shard = 20;
+
+    // Should the sweep save its progress to q1.ckpt (at most every checkpoint_secs seconds)? A run that finds the
+    // checkpoint of the same sweep resumes from it with the same stats and curves but no dump, with its seed
+    // when seed is 0. The checkpoint is deleted once the sweep is complete
+    bool checkpoint = false;
+    double checkpoint_secs = 5;
+
+    // Should the arms change while the environments are played (Environment.hpp)? DRIFT_RANDOM_WALK moves the
+    // probability of drift_arms random arms by up to drift_step every drift_period rounds, DRIFT_REDRAW gives them
+    // a new one every drift_period rounds and DRIFT_CHANGE_POINT at change points that come with a chance of
+    // drift_rate per round (drift_arms = 0 changes every arm). Common random numbers do not apply to them, and
+    // the regret of the curves is measured against the best arm at the start
+    DriftMode drift_mode = DRIFT_NONE;
+    int drift_arms = 1;
+    int drift_period = 1;
+    double drift_rate = 0.001;
+    double drift_step = 0.01;
+
+    // Seed of the random streams, a run with the same seed gives the same results (0 uses the current time)
+    unsigned long seed = 0;
+
     //------------------------------------DO NOT MODIFY BEYOND THIS POINT------------------------------------//
     //-------------------------------------------------------------------------------------------------------//
 
 
-    srand(time(NULL));
+    // The whole sweep, a shard of it, the shards of a coordinator or the merge of their results
+    ShardRun shards(argc, argv, "q1");
+    if (!shards.is_valid())
+        return 1;
+    if (shards.get_mode() != ShardRun::RUN)
+        collect_iter_data = collect_curves = sequential_stopping = checkpoint = false;
 
-    // Files to write to (dump file and stats file)
-    std::ofstream dump_file;
+    // Rewards replayed from a tape would ignore the changes of non-stationary environments
+    Drift drift(drift_mode, drift_arms, drift_period, drift_rate, drift_step);
+    if (drift.mode != DRIFT_NONE && common_random_numbers) {
+        std::cerr << "Common random numbers do not apply to drifting environments, turned off" << std::endl;
+        common_random_numbers = false;
+    }
 
-    if (collect_iter_data){
-        // Open the dump file
-        dump_file.open(dump_file_name, std::ofstream::trunc);
+    // Progress saved while the sweep runs, for the settings that change which environments run and their results
+    std::ostringstream sweep;
+    sweep << "q1 arms=" << num_of_arms << " iters=" << num_of_iters << " freq=" << print_freq << " crn="
+          << common_random_numbers << " curves=" << collect_curves << " stopping=" << sequential_stopping << ","
+          << min_envs << "," << wave_envs << "," << target_ci_width << "," << drop_losers << " conf=";
+    for (size_t i = 0; i < cons_val.size(); i++)
+        sweep << cons_val[i] << ",";
+    if (drift.mode != DRIFT_NONE)
+        sweep << " drift=" << drift.mode << "," << drift.arms << "," << drift.period << "," << drift.rate << ","
+              << drift.step;
+    Checkpoint progress(checkpoint_file_name, checkpoint ? checkpoint_secs : -1, sweep.str(), cons_val.size(),
+                        num_of_envs, 2);
+
+    seed = shards.get_seed(progress.get_seed(seed));
+    if (seed == 0) {
+        std::cerr << "A shard needs the seed of its sweep (--seed s)" << std::endl;
+        return 1;
+    }
+    if (progress.get_num_of_found() > 0 && collect_iter_data) {
+        std::cout << "Resuming from " << checkpoint_file_name << " without writing the dump" << std::endl;
+        collect_iter_data = false;
+    }
 
-        // Set up the output style preferred
-        dump_file << std::fixed;
+    shards.set_grid(cons_val.size(), num_of_envs, configs_per_shard, envs_per_shard);
+    if (shards.get_mode() == ShardRun::COORDINATE && !shards.coordinate(seed))
+        return 1;
 
-        //sets the printing double precision to 2 decimal points
-        dump_file << std::setprecision(2); 
+    // Writes the dump file (text or binary trace) on its own thread, fed by the simulation threads
+    DumpWriter dump_writer(num_of_arms, num_of_envs);
+
+    if (collect_iter_data){
+        // Open the dump file
+        dump_writer.open(binary_trace ? trace_file_name : dump_file_name, binary_trace,
+                         {"UCB"}, {"Estimated Arm Probs: \t"});
     }
     
     // Temporary values to use for getting averages and other operations
-    double ucb_point_avg, ucb_optm_avg, curr_conf;
+    double ucb_point_avg, ucb_optm_avg;
 
     // Environment Variable to represent the current environment
     Environment curr_env;
+    BatchEnvironment batch_env(1, num_of_arms);
+    FixedUCBSweep fixed_sweep = fixed_agents ? get_fixed_ucb_sweep(num_of_arms) : nullptr;
 
-    // L(r-p) agent
-    UCBAgent ucb(curr_env, "UCB");
+    // Thread pool that runs every (conf, environment) pair as a job
+    SweepRunner runner(num_of_threads);
+    int num_of_workers = runner.get_num_of_threads();
 
     // Size of considered values
     int size_of_cons_val = cons_val.size();
+
+    // Learning curves of every conf value, fed by the dump writer with or without a dump file
+    LearningCurves curves(size_of_cons_val, num_of_envs, 1, num_of_iters, print_freq);
+    std::vector<std::string> config_names;
+    for (int conf_index = 0; conf_index < size_of_cons_val; conf_index++) {
+        std::ostringstream name;
+        name << "conf=" << cons_val[conf_index];
+        config_names.push_back(name.str());
+    }
+    if (collect_curves)
+        dump_writer.set_curves(&curves);
+    bool collect_snapshots = collect_iter_data || collect_curves;
     
     // Array containing the results (% optimal arm chosen, % reward collected) for the l(r-i) algorithm
     std::vector<std::vector<double>> ucb_results;
@@ -93,39 +229,110 @@ int main(){
         ucb_results.push_back(v1);
     }
 
+    // Results (% optimal arm chosen, % reward collected) of every environment, index = conf_index * num_of_envs + env_count
+    std::vector<double> job_optm(size_of_cons_val * num_of_envs), job_point(size_of_cons_val * num_of_envs);
+    std::vector<std::vector<double> *> results = {&job_optm, &job_point};
+
+    // Reward tapes of every environment, shared by every conf value
+    std::vector<RewardTape> tapes;
+    if (common_random_numbers)
+        generate_reward_tapes(runner, num_of_envs, num_of_arms, num_of_iters, seed, tapes);
+
+    // Environments used by every conf value, all of them in one wave unless sequential stopping is on
+    SequentialStopping stopping(size_of_cons_val, 1, num_of_envs, sequential_stopping ? min_envs : num_of_envs,
+                                wave_envs, sequential_stopping ? target_ci_width : -1,
+                                sequential_stopping && drop_losers);
+
+    // Results and curves of the environments a checkpoint already holds
+    uint64_t restored = progress.restore(seed, results, collect_curves ? &curves : nullptr);
+    if (restored > 0)
+        std::cout << "Resumed " << restored << " environments from " << checkpoint_file_name << std::endl;
+
+    // Jobs of the current wave, within the shard being run and not done yet, and the ones run at once
+    std::vector<int> wave_jobs, chunk_jobs;
+    Shard shard;
+    while (shards.next(shard)) {
+        stopping.restart();
+        while (stopping.next_wave()) {
+            wave_jobs.clear();
+            for (int conf_index = shard.first_config; conf_index < shard.first_config + shard.num_of_configs;
+                 conf_index++) {
+                int begin = std::max(stopping.wave_begin(conf_index), shard.first_env);
+                int end = std::min(stopping.wave_end(conf_index), shard.first_env + shard.num_of_envs);
+                for (int env_count = begin; env_count < end; env_count++)
+                    if (!progress.is_done(conf_index, env_count))
+                        wave_jobs.push_back(conf_index * num_of_envs + env_count);
+            }
+
+            // Run the jobs in chunks when checkpointing, with a chance to save the progress after each one
+            size_t chunk_size = checkpoint ? num_of_workers * CHECKPOINT_CHUNK_JOBS : wave_jobs.size();
+            for (size_t first = 0; first < wave_jobs.size(); first += chunk_size) {
+                chunk_jobs.assign(wave_jobs.begin() + first, wave_jobs.begin() + std::min(first + chunk_size,
+                                                                                          wave_jobs.size()));
+                // Run every environment of the chunk with the UCB agent
+                if (batch_size > 1)
+                    run_batch_sweep(runner, std::vector<BatchUCBAgent>(1, BatchUCBAgent(batch_env.lane(0), "UCB")),
+                                    batch_size, size_of_cons_val, num_of_envs, num_of_arms, num_of_iters, print_freq,
+                                    seed, collect_snapshots ? &dump_writer : nullptr,
+                                    [&](BatchUCBAgent &ucb, int, int conf_index, BatchLane &env, Rng r) {
+                                        ucb.change_parameters(env, cons_val[conf_index], r);
+                                    }, job_optm, job_point, common_random_numbers ? &tapes : nullptr, &chunk_jobs,
+                                    drift);
+                else if (fixed_sweep != nullptr)
+                    fixed_sweep(runner, cons_val, num_of_envs, num_of_iters, print_freq, seed,
+                                collect_snapshots ? &dump_writer : nullptr, job_optm, job_point,
+                                common_random_numbers ? &tapes : nullptr, &chunk_jobs, drift);
+                else
+                    run_policy_sweep(runner, std::vector<UCBAgent>(1, UCBAgent(curr_env, "UCB")), size_of_cons_val,
+                                     num_of_envs, num_of_arms, num_of_iters, print_freq, seed,
+                                     collect_snapshots ? &dump_writer : nullptr,
+                                     [&](UCBAgent &ucb, int, int conf_index, Environment &env, Rng r) {
+                                         ucb.change_parameters(env, cons_val[conf_index], r);
+                                     }, job_optm, job_point, common_random_numbers ? &tapes : nullptr, &chunk_jobs,
+                                     drift);
+
+                // Mark the environments of the chunk as done in the checkpoint
+                for (size_t i = 0; i < chunk_jobs.size(); i++)
+                    progress.add(chunk_jobs[i] / num_of_envs, chunk_jobs[i] % num_of_envs);
+                if (!progress.save(results, collect_curves ? &curves : nullptr, false))
+                    std::cerr << "Cannot save " << checkpoint_file_name << std::endl;
+            }
+
+            // Decide which conf values need more environments
+            stopping.end_wave({job_point.data()});
+        }
+
+        // Write the results of the shard when it runs alone or for a coordinator
+        if (!shards.finish(shard, results))
+            return 1;
+    }
+    if (shards.is_partial())
+        return shards.is_valid() ? 0 : 1;
+    if (shards.get_mode() == ShardRun::MERGE && !shards.merge(results))
+        return 1;
+
+    // Environments a conf value did not use still end in the dump
+    for (int conf_index = 0; collect_snapshots && conf_index < size_of_cons_val; conf_index++) {
+        for (int env_count = stopping.get_used(conf_index); env_count < num_of_envs; env_count++)
+            dump_writer.end_environment(conf_index, env_count);
+    }
+
     // For each conf value
     for (int conf_index = 0; conf_index < size_of_cons_val; conf_index++) {
         // Reset the variables 
         ucb_point_avg = 0,  ucb_optm_avg = 0;
 
-        // Get the current values from our array
-        curr_conf = cons_val[conf_index];
-        
-        // Iterate number of environments indicated times
-        for (int env_count = 0; env_count < num_of_envs; env_count++) {
-            // Create a new environment with the indicated number of arms
-            curr_env = Environment(num_of_arms);
-
-            // Change the parameters of the agents to accomodate for the current configuration
-            ucb.change_parameters(curr_env, curr_conf);
-
-            for (int iter_num = 1; iter_num <= num_of_iters; iter_num++) {
-                // Execute an iteration (round) for both agents
-                ucb.exec_round();
-
-                // Print out once very print_freq number of times
-                if (iter_num % print_freq == 0 && collect_iter_data) {
-                    ucb.print_agent_stats(dump_file);
-                }
-            }
-            ucb_point_avg += ucb.get_reward_percent();
-            ucb_optm_avg += ucb.get_optm_percent();
+        // Sum the environments in order so the averages do not depend on the number of threads
+        int used_envs = sequential_stopping ? stopping.get_used(conf_index) : num_of_envs;
+        for (int env_count = 0; env_count < used_envs; env_count++) {
+            ucb_point_avg += job_point[conf_index * num_of_envs + env_count];
+            ucb_optm_avg += job_optm[conf_index * num_of_envs + env_count];
         }
 
         // Get the average points percent for L(r-p) (divide by n)
-        ucb_point_avg /= num_of_envs; 
+        ucb_point_avg /= used_envs; 
         // Get the average percentage of time optimal arm was chosen for L(r-p)
-        ucb_optm_avg /= num_of_envs; 
+        ucb_optm_avg /= used_envs; 
 
         // Store results in the results arrays
         ucb_results[conf_index].push_back(ucb_optm_avg); 
@@ -133,19 +340,30 @@ int main(){
     }
     
     if (collect_iter_data){
-        dump_file.close();
+        dump_writer.close();
+        dump_writer.print_backpressure(std::cout);
     }
 
+    // Per-phase timings of the profiling build
+    PROFILE_REPORT(std::cout, profile_file_name);
+
+    if (collect_curves)
+        curves.write(curves_file_name, config_names, {"UCB"});
+
     if (collect_stats) {
-        print_stats(cons_val, ucb_results, size_of_cons_val, stats_file_name);
+        print_stats(cons_val, ucb_results, size_of_cons_val, stats_file_name,
+                    sequential_stopping ? &stopping : nullptr);
     }
+
+    // The sweep is complete, nothing to resume
+    progress.remove();
     return 0;
 }
 /**
- * Prints all statistics to file
+ * Prints all statistics to file, with the environments every conf value used when stopping is given
  **/
 void print_stats(std::vector<double> cons_val,std::vector<std::vector<double>> ucb_results, 
-                int size_of_cons_val, std::string stats_file_name){
+                int size_of_cons_val, std::string stats_file_name, SequentialStopping *stopping){
     // Open the stats file
     std::ofstream stats_file;
     stats_file.open(stats_file_name, std::ofstream::trunc);
@@ -159,14 +377,61 @@ void print_stats(std::vector<double> cons_val,std::vector<std::vector<double>> u
     // Prints the header for the UCB algorithm
     stats_file << "\n\nUCB Statistics\n\n";
     stats_file << SIDE_OFFSET << "conf" << COL_WIDTH_2 << "% Optimal" << COL_WIDTH
-              << "% Reward" << std::endl;
+              << "% Reward";
+    if (stopping != nullptr)
+        stats_file << COL_WIDTH << "Envs" << "  Stopped";
+    stats_file << std::endl;
     stats_file << "----------------------------------------------------------------------------------------------------" << std::endl;
     // Print all the values
     for (int conf_index = 0; conf_index < size_of_cons_val; conf_index++) {
         stats_file << SIDE_OFFSET << cons_val[conf_index]
                   << COL_WIDTH << ucb_results[conf_index][0] * 100 << "%"
-                  << COL_WIDTH << ucb_results[conf_index][1] * 100 << "%" << std::endl;
+                  << COL_WIDTH << ucb_results[conf_index][1] * 100 << "%";
+        if (stopping != nullptr)
+            stats_file << COL_WIDTH << stopping->get_used(conf_index) << "  "
+                       << SequentialStopping::state_name(stopping->get_state(conf_index));
+        stats_file << std::endl;
     }
     stats_file << "----------------------------------------------------------------------------------------------------" << std::endl;
     stats_file.close();
-}
\ No newline at end of file
+}
+
+/**
+ * Runs the jobs of a sweep with the UCB agent and environment specialized for N arms, the same sweep as
+ * run_policy_sweep with a UCBAgent
+ **/
+template <int N>
+void run_fixed_ucb_sweep(SweepRunner &runner, const std::vector<double> &cons_val, int num_of_envs,
+                         int num_of_iters, int print_freq, unsigned long seed, DumpWriter *dump_writer,
+                         std::vector<double> &optm, std::vector<double> &point,
+                         const std::vector<RewardTape> *tapes, const std::vector<int> *jobs, const Drift &drift){
+    FixedEnvironment<N> env;
+    run_policy_sweep(runner, std::vector<FixedUCBAgent<N>>(1, FixedUCBAgent<N>(env, "UCB")), cons_val.size(),
+                     num_of_envs, N, num_of_iters, print_freq, seed, dump_writer,
+                     [&](FixedUCBAgent<N> &ucb, int, int conf_index, FixedEnvironment<N> &e, Rng r) {
+                         ucb.change_parameters(e, cons_val[conf_index], r);
+                     }, optm, point, tapes, jobs, drift);
+}
+
+/**
+ * Returns the sweep of the UCB agent specialized for num_of_arms, nullptr when there is none
+ **/
+FixedUCBSweep get_fixed_ucb_sweep(int num_of_arms){
+    switch (num_of_arms) {
+        case 2: return run_fixed_ucb_sweep<2>;
+        case 3: return run_fixed_ucb_sweep<3>;
+        case 4: return run_fixed_ucb_sweep<4>;
+        case 5: return run_fixed_ucb_sweep<5>;
+        case 6: return run_fixed_ucb_sweep<6>;
+        case 8: return run_fixed_ucb_sweep<8>;
+        case 10: return run_fixed_ucb_sweep<10>;
+        case 12: return run_fixed_ucb_sweep<12>;
+        case 16: return run_fixed_ucb_sweep<16>;
+        case 20: return run_fixed_ucb_sweep<20>;
+        case 24: return run_fixed_ucb_sweep<24>;
+        case 32: return run_fixed_ucb_sweep<32>;
+        case 48: return run_fixed_ucb_sweep<48>;
+        case 64: return run_fixed_ucb_sweep<64>;
+        default: return nullptr;
+    }
+}
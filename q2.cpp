@@ -5,10 +5,21 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 
 #include "Environment.hpp"
 #include "Arm.hpp"
 #include "LRAgent.hpp"
+#include "FixedLRAgent.hpp"
+#include "SweepRunner.hpp"
+#include "PolicySweep.hpp"
+#include "DumpWriter.hpp"
+#include "Profiler.hpp"
+#include "SequentialStopping.hpp"
+#include "LearningCurves.hpp"
+#include "Shard.hpp"
+#include "Checkpoint.hpp"
 
 #define COL_WIDTH std::setw(10) // Formatting support for printing the statistics
 #define COL_WIDTH_2 std::setw(12) // To align numerical values with their heading
@@ -18,19 +29,34 @@
 void print_stats(std::vector<std::vector<std::vector<double>>> ab_pairs
                 ,std::vector<std::vector<std::vector<double>>> lrp_results 
                 ,std::vector<std::vector<double>> lri_results, 
-                int size_of_cons_val, std::string stats_file_name);
+                int size_of_cons_val, std::string stats_file_name, SequentialStopping *stopping);
+
+// Sweep of the L(r-p) and L(r-i) agents specialized for a number of arms known at compile time, see
+// run_fixed_lr_sweep
+typedef void (*FixedLRSweep)(SweepRunner &runner, const std::vector<std::vector<std::vector<double>>> &ab_pairs,
+                             int num_of_envs, int num_of_iters, int print_freq, unsigned long seed,
+                             DumpWriter *dump_writer, std::vector<double> &optm, std::vector<double> &point,
+                             const std::vector<RewardTape> *tapes, const std::vector<int> *jobs,
+                             const Drift &drift);
+FixedLRSweep get_fixed_lr_sweep(int num_of_arms);
 
 /**
  * Main function that executes the program
  **/
-int main(){
+int main(int argc, char **argv){
 
     //-------------------------------------------------------------------------------------------------------//
     //-------------------------------------------------------------------------------------------------------//
 
-    // Dump and stats file names
+    // Dump, stats and learning curve file names
     std::string dump_file_name = "q2.out";
+    std::string trace_file_name = "q2.trace";
     std::string stats_file_name = "q2_stats";
+    std::string curves_file_name = "q2_curves";
+    std::string checkpoint_file_name = "q2.ckpt";
+
+    // Chrome trace of the profiler, only written by a profiling build (make q2 PROFILE=1)
+    std::string profile_file_name = "q2_profile.json";
 
     // Should we collect stats?
     bool collect_stats = true;
@@ -38,6 +64,14 @@ int main(){
     // Should we collect iteration data?
     bool collect_iter_data = true;
 
+    // Should we collect learning curves? (mean and standard deviation over the environments of the reward
+    // rate, optimal arm rate and regret every print_freq iterations, written to q2_curves without the dump)
+    bool collect_curves = false;
+
+    // Should the iteration data be written as a compact binary trace instead of the text dump?
+    // (./trace2text.o q2.trace q2.out rebuilds the text dump from the trace)
+    bool binary_trace = false;
+
     // How often (once every how many iterations) should we print stats of the iteration?
     int print_freq = 100;
 
@@ -56,41 +90,153 @@ int main(){
 
     // The full number of executions will be cons_val.size()^2 * num_of_envs * num_of_iters
 
+    // Number of threads the environments are spread over (0 uses every available core)
+    int num_of_threads = 0;
+
+    // Number of environments of an alpha and beta pair played in lockstep by batched agents (BatchAgent.hpp), 1
+    // plays every environment on its own. Same results either way, batches do not fast forward L(r-i)
+    int batch_size = 1;
+
+    // Should the sweep play the L(r-p)/L(r-i) agents and environment specialized for num_of_arms at compile time
+    // (FixedLRAgent.hpp) when there are (2-6, 8, 10, 12, 16, 20, 24, 32 or 48 arms)? Same results, not used when
+    // L(r-i) fast forwards and batch_size > 1 takes precedence
+    bool fixed_agents = true;
+
+    // Should every alpha and beta pair and both agents play the same environments with the same pre-generated
+    // rewards (common random numbers)? Differences between them then need far fewer environments to show,
+    // the tapes take num_of_envs * num_of_arms * num_of_iters / 8 bytes
+    bool common_random_numbers = false;
+
+    // Should L(r-i) skip the rounds without a reward in one draw each? The results have the same distribution
+    // but are not the same numbers
+    bool fast_forward_lri = false;
+
+    // Should every alpha and beta pair stop adding environments once the confidence intervals of the % reward
+    // of both agents are narrower than target_ci_width? It starts with min_envs environments and adds
+    // wave_envs at a time up to num_of_envs, the stats then show the environments used
+    bool sequential_stopping = false;
+    int min_envs = 20;
+    int wave_envs = 10;
+    double target_ci_width = 0.05;
+
+    // Should pairs whose L(r-p) % reward is clearly below the best one stop early? (sequential stopping only)
+    bool drop_losers = true;
+
+    // Size of the shards of a sharded sweep in alpha and beta pairs and environments. ./q2.o --shard i runs
+    // shard i alone, --merge prints the stats of every shard and --coordinate [workers] runs the shards on
+    // worker processes and merges them (no dump, curves or sequential stopping)
+    int configs_per_shard = 1;
+    int envs_per_shard = 20;
+
+    // Should the sweep save its progress to q2.ckpt (at most every checkpoint_secs seconds)? A run that finds the
+    // checkpoint of the same sweep resumes from it with the same stats and curves but no dump, with its seed
+    // when seed is 0. The checkpoint is deleted once the sweep is complete
+    bool checkpoint = false;
+    double checkpoint_secs = 5;
+
+    // Should the arms change while the environments are played (Environment.hpp)? DRIFT_RANDOM_WALK moves the
+    // probability of drift_arms random arms by up to drift_step every drift_period rounds, DRIFT_REDRAW gives them
+    // a new one every drift_period rounds and DRIFT_CHANGE_POINT at change points that come with a chance of
+    // drift_rate per round (drift_arms = 0 changes every arm). Common random numbers and fast forward do not apply
+    // to them, and the regret of the curves is measured against the best arm at the start
+    DriftMode drift_mode = DRIFT_NONE;
+    int drift_arms = 1;
+    int drift_period = 1;
+    double drift_rate = 0.001;
+    double drift_step = 0.01;
+
+    // Seed of the random streams, a run with the same seed gives the same results (0 uses the current time)
+    unsigned long seed = 0;
+
     //------------------------------------DO NOT MODIFY BEYOND THIS POINT------------------------------------//
     //-------------------------------------------------------------------------------------------------------//
 
 
-    srand(time(NULL));
+    // The whole sweep, a shard of it, the shards of a coordinator or the merge of their results
+    ShardRun shards(argc, argv, "q2");
+    if (!shards.is_valid())
+        return 1;
+    if (shards.get_mode() != ShardRun::RUN)
+        collect_iter_data = collect_curves = sequential_stopping = checkpoint = false;
+
+    // Rewards replayed from a tape and rounds skipped in one draw would ignore the changes of non-stationary
+    // environments
+    Drift drift(drift_mode, drift_arms, drift_period, drift_rate, drift_step);
+    if (drift.mode != DRIFT_NONE && (common_random_numbers || fast_forward_lri)) {
+        std::cerr << "Common random numbers and fast forward do not apply to drifting environments, turned off"
+                  << std::endl;
+        common_random_numbers = fast_forward_lri = false;
+    }
+    if (fast_forward_lri && batch_size > 1) {
+        std::cerr << "Batched agents play every round, batches turned off to fast forward L(r-i)" << std::endl;
+        batch_size = 1;
+    }
 
-    // Files to write to (dump file and stats file)
-    std::ofstream dump_file;
+    // Progress saved while the sweep runs, for the settings that change which environments run and their results
+    std::ostringstream sweep;
+    sweep << "q2 arms=" << num_of_arms << " iters=" << num_of_iters << " freq=" << print_freq << " crn="
+          << common_random_numbers << " fast_forward=" << fast_forward_lri << " curves=" << collect_curves << " stopping=" << sequential_stopping << ","
+          << min_envs << "," << wave_envs << "," << target_ci_width << "," << drop_losers << " conf=";
+    for (size_t i = 0; i < cons_val.size(); i++)
+        sweep << cons_val[i] << ",";
+    if (drift.mode != DRIFT_NONE)
+        sweep << " drift=" << drift.mode << "," << drift.arms << "," << drift.period << "," << drift.rate << ","
+              << drift.step;
+    Checkpoint progress(checkpoint_file_name, checkpoint ? checkpoint_secs : -1, sweep.str(),
+                        cons_val.size() * cons_val.size(), num_of_envs, 4);
+
+    seed = shards.get_seed(progress.get_seed(seed));
+    if (seed == 0) {
+        std::cerr << "A shard needs the seed of its sweep (--seed s)" << std::endl;
+        return 1;
+    }
+    if (progress.get_num_of_found() > 0 && collect_iter_data) {
+        std::cout << "Resuming from " << checkpoint_file_name << " without writing the dump" << std::endl;
+        collect_iter_data = false;
+    }
 
-    if (collect_iter_data){
-        // Open the dump file
-        dump_file.open(dump_file_name, std::ofstream::trunc);
+    shards.set_grid(cons_val.size() * cons_val.size(), num_of_envs, configs_per_shard, envs_per_shard);
+    if (shards.get_mode() == ShardRun::COORDINATE && !shards.coordinate(seed))
+        return 1;
 
-        // Set up the output style preferred
-        dump_file << std::fixed;
+    // Writes the dump file (text or binary trace) on its own thread, fed by the simulation threads
+    DumpWriter dump_writer(num_of_arms, num_of_envs);
 
-        //sets the printing double precision to 2 decimal points
-        dump_file << std::setprecision(2); 
+    if (collect_iter_data){
+        // Open the dump file
+        dump_writer.open(binary_trace ? trace_file_name : dump_file_name, binary_trace,
+                         {"L(r-p)", "L(r-i)"},
+                         {"Agent Choices Probs: \t", "Agent Choices Probs: \t"});
     }
     
     // Temporary values to use for getting averages and other operations
-    double lrp_point_avg, lrp_optm_avg, lri_optm_avg, lri_point_avg, curr_alpha, curr_beta, lri_tmp_o, lri_tmp_p;
+    double lrp_point_avg, lrp_optm_avg, lri_optm_avg, lri_point_avg, lri_tmp_o, lri_tmp_p;
 
     // Environment Variable to represent the current environment
     Environment curr_env;
+    BatchEnvironment batch_env(1, num_of_arms);
+    FixedLRSweep fixed_sweep = (fixed_agents && !fast_forward_lri) ? get_fixed_lr_sweep(num_of_arms) : nullptr;
 
-    // L(r-p) agent
-    LRAgent lrp(curr_env, "L(r-p)", 10); 
-
-    // L(r-i) agent
-    LRAgent lri(curr_env, "L(r-i)", 10, 0); 
+    // Thread pool that runs every (alpha, beta, environment) triple as a job
+    SweepRunner runner(num_of_threads);
+    int num_of_workers = runner.get_num_of_threads();
 
     // Size of considered values
     int size_of_cons_val = cons_val.size();
 
+    // Learning curves of every alpha and beta pair, fed by the dump writer with or without a dump file
+    LearningCurves curves(size_of_cons_val * size_of_cons_val, num_of_envs, 2, num_of_iters, print_freq);
+    std::vector<std::string> config_names;
+    for (int alpha_index = 0; alpha_index < size_of_cons_val; alpha_index++)
+        for (int beta_index = 0; beta_index < size_of_cons_val; beta_index++) {
+            std::ostringstream name;
+            name << "alpha=" << cons_val[alpha_index] << ",beta=" << cons_val[beta_index];
+            config_names.push_back(name.str());
+        }
+    if (collect_curves)
+        dump_writer.set_curves(&curves);
+    bool collect_snapshots = collect_iter_data || collect_curves;
+
     // Array of possible combinations of alpha and beta values
     std::vector<std::vector<std::vector<double>>> ab_pairs;
 
@@ -124,6 +270,114 @@ int main(){
         lri_results.push_back(v1);
     }
 
+    // Results (% optimal arm chosen, % reward collected) of every environment,
+    // index = (alpha_index * size_of_cons_val + beta_index) * num_of_envs + env_count
+    int num_of_results = size_of_cons_val * size_of_cons_val * num_of_envs;
+    std::vector<double> lrp_job_optm(num_of_results), lrp_job_point(num_of_results);
+    std::vector<double> lri_job_optm(num_of_results), lri_job_point(num_of_results);
+    std::vector<std::vector<double> *> results = {&lrp_job_optm, &lrp_job_point, &lri_job_optm, &lri_job_point};
+
+    // Reward tapes of every environment, shared by every alpha and beta pair and both agents
+    std::vector<RewardTape> tapes;
+    if (common_random_numbers)
+        generate_reward_tapes(runner, num_of_envs, num_of_arms, num_of_iters, seed, tapes);
+
+    // Environments used by every alpha and beta pair, all of them in one wave unless sequential stopping is on
+    int num_of_pairs = size_of_cons_val * size_of_cons_val;
+    SequentialStopping stopping(num_of_pairs, 2, num_of_envs, sequential_stopping ? min_envs : num_of_envs,
+                                wave_envs, sequential_stopping ? target_ci_width : -1,
+                                sequential_stopping && drop_losers);
+
+    // L(r-p) (agent 0) and L(r-i) (agent 1) agents played in every environment
+    std::vector<LRAgent> agents = { LRAgent(curr_env, "L(r-p)", 10), LRAgent(curr_env, "L(r-i)", 10, 0) };
+    agents[1].set_fast_forward(fast_forward_lri);
+    std::vector<BatchLRAgent> batch_agents = { BatchLRAgent(batch_env.lane(0), "L(r-p)", 10),
+                                               BatchLRAgent(batch_env.lane(0), "L(r-i)", 10, 0) };
+    std::vector<double> sweep_optm, sweep_point;
+
+    // Results and curves of the environments a checkpoint already holds
+    uint64_t restored = progress.restore(seed, results, collect_curves ? &curves : nullptr);
+    if (restored > 0)
+        std::cout << "Resumed " << restored << " environments from " << checkpoint_file_name << std::endl;
+
+    // Jobs of the current wave, within the shard being run and not done yet, and the ones run at once
+    std::vector<int> wave_jobs, chunk_jobs;
+    Shard shard;
+    while (shards.next(shard)) {
+        stopping.restart();
+        while (stopping.next_wave()) {
+            wave_jobs.clear();
+            for (int pair_index = shard.first_config; pair_index < shard.first_config + shard.num_of_configs;
+                 pair_index++) {
+                int begin = std::max(stopping.wave_begin(pair_index), shard.first_env);
+                int end = std::min(stopping.wave_end(pair_index), shard.first_env + shard.num_of_envs);
+                for (int env_count = begin; env_count < end; env_count++)
+                    if (!progress.is_done(pair_index, env_count))
+                        wave_jobs.push_back(pair_index * num_of_envs + env_count);
+            }
+
+            // Run the jobs in chunks when checkpointing, with a chance to save the progress after each one
+            size_t chunk_size = checkpoint ? num_of_workers * CHECKPOINT_CHUNK_JOBS : wave_jobs.size();
+            for (size_t first = 0; first < wave_jobs.size(); first += chunk_size) {
+                chunk_jobs.assign(wave_jobs.begin() + first, wave_jobs.begin() + std::min(first + chunk_size,
+                                                                                          wave_jobs.size()));
+                // Run every environment of the chunk with both agents
+                if (batch_size > 1)
+                    run_batch_sweep(runner, batch_agents, batch_size, num_of_pairs, num_of_envs, num_of_arms,
+                                    num_of_iters, print_freq, seed, collect_snapshots ? &dump_writer : nullptr,
+                                    [&](BatchLRAgent &agent, int agent_index, int pair_index, BatchLane &env, Rng r) {
+                                        double alpha = ab_pairs[pair_index / size_of_cons_val][pair_index % size_of_cons_val][0];
+                                        double beta = ab_pairs[pair_index / size_of_cons_val][pair_index % size_of_cons_val][1];
+                                        agent.change_parameters(env, alpha, agent_index == 0 ? beta : 0, r);
+                                    }, sweep_optm, sweep_point, common_random_numbers ? &tapes : nullptr, &chunk_jobs,
+                                    drift);
+                else if (fixed_sweep != nullptr)
+                    fixed_sweep(runner, ab_pairs, num_of_envs, num_of_iters, print_freq, seed,
+                                collect_snapshots ? &dump_writer : nullptr, sweep_optm, sweep_point,
+                                common_random_numbers ? &tapes : nullptr, &chunk_jobs, drift);
+                else
+                    run_policy_sweep(runner, agents, num_of_pairs, num_of_envs, num_of_arms,
+                                     num_of_iters, print_freq, seed, collect_snapshots ? &dump_writer : nullptr,
+                                     [&](LRAgent &agent, int agent_index, int pair_index, Environment &env, Rng r) {
+                                         double alpha = ab_pairs[pair_index / size_of_cons_val][pair_index % size_of_cons_val][0];
+                                         double beta = ab_pairs[pair_index / size_of_cons_val][pair_index % size_of_cons_val][1];
+                                         agent.change_parameters(env, alpha, agent_index == 0 ? beta : 0, r);
+                                     }, sweep_optm, sweep_point, common_random_numbers ? &tapes : nullptr, &chunk_jobs,
+                                     drift);
+
+                // The results of the L(r-i) agent follow those of the L(r-p) agent, the environments of the chunk
+                // are done
+                for (size_t i = 0; i < chunk_jobs.size(); i++) {
+                    int job = chunk_jobs[i];
+                    lrp_job_optm[job] = sweep_optm[job];
+                    lrp_job_point[job] = sweep_point[job];
+                    lri_job_optm[job] = sweep_optm[num_of_results + job];
+                    lri_job_point[job] = sweep_point[num_of_results + job];
+                    progress.add(job / num_of_envs, job % num_of_envs);
+                }
+                if (!progress.save(results, collect_curves ? &curves : nullptr, false))
+                    std::cerr << "Cannot save " << checkpoint_file_name << std::endl;
+            }
+
+            // Decide which pairs need more environments, from the % reward of both agents
+            stopping.end_wave({lrp_job_point.data(), lri_job_point.data()});
+        }
+
+        // Write the results of the shard when it runs alone or for a coordinator
+        if (!shards.finish(shard, results))
+            return 1;
+    }
+    if (shards.is_partial())
+        return shards.is_valid() ? 0 : 1;
+    if (shards.get_mode() == ShardRun::MERGE && !shards.merge(results))
+        return 1;
+
+    // Environments a pair did not use still end in the dump
+    for (int pair_index = 0; collect_snapshots && pair_index < num_of_pairs; pair_index++) {
+        for (int env_count = stopping.get_used(pair_index); env_count < num_of_envs; env_count++)
+            dump_writer.end_environment(pair_index, env_count);
+    }
+
     // For each alpha value
     for (int alpha_index = 0; alpha_index < size_of_cons_val; alpha_index++) {
         // For each beta value
@@ -132,47 +386,28 @@ int main(){
             lrp_point_avg = 0, lri_point_avg = 0, lrp_optm_avg = 0; lri_optm_avg = 0;
             lri_tmp_o = 0, lri_tmp_p = 0;
 
-            // Get the current values from our array
-            curr_alpha = ab_pairs[alpha_index][beta_index][0];
-            curr_beta = ab_pairs[alpha_index][beta_index][1];
-
-            // Iterate number of environments indicated times
-            for (int env_count = 0; env_count < num_of_envs; env_count++) {
-                // Create a new environment with the indicated number of arms
-                curr_env = Environment(num_of_arms);
-
-                // Change the parameters of the agents to accomodate for the current configuration
-                lrp.change_parameters(curr_env, curr_alpha, curr_beta);
-                lri.change_parameters(curr_env, curr_alpha, 0);
-
-                for (int iter_num = 1; iter_num <= num_of_iters; iter_num++) {
-                    // Execute an iteration (round) for both agents
-                    lrp.exec_round();
-                    lri.exec_round();
-
-                    // Print out once very print_freq number of times
-                    if (iter_num % print_freq == 0 && collect_iter_data) {
-                        lrp.print_agent_stats(dump_file);
-                        lri.print_agent_stats(dump_file);
-                    }
-                }
+            // Sum the environments in order so the averages do not depend on the number of threads
+            int used_envs = sequential_stopping ? stopping.get_used(alpha_index * size_of_cons_val + beta_index)
+                                                : num_of_envs;
+            for (int env_count = 0; env_count < used_envs; env_count++) {
+                int job = (alpha_index * size_of_cons_val + beta_index) * num_of_envs + env_count;
 
-                lrp_point_avg += lrp.get_reward_percent();
-                lrp_optm_avg += lrp.get_optm_percent();
+                lrp_point_avg += lrp_job_point[job];
+                lrp_optm_avg += lrp_job_optm[job];
 
-                lri_point_avg += lri.get_reward_percent();
-                lri_optm_avg += lri.get_optm_percent();
+                lri_point_avg += lri_job_point[job];
+                lri_optm_avg += lri_job_optm[job];
             }
 
             // Get the average points percent for L(r-p) (divide by n)
-            lrp_point_avg /= num_of_envs; 
+            lrp_point_avg /= used_envs; 
             // Get the average percentage of time optimal arm was chosen for L(r-p)
-            lrp_optm_avg /= num_of_envs; 
+            lrp_optm_avg /= used_envs; 
 
             // Get the average points percent for L(r-i) (divide by n)
-            lri_point_avg /= num_of_envs; 
+            lri_point_avg /= used_envs; 
             // Get the average percentage of time optimal arm was chosen for L(r-i)
-            lri_optm_avg /= num_of_envs; 
+            lri_optm_avg /= used_envs; 
 
             // Store results in the results arrays
             lrp_results[alpha_index][beta_index].push_back(lrp_optm_avg); 
@@ -187,21 +422,32 @@ int main(){
     }
     
     if (collect_iter_data){
-        dump_file.close();
+        dump_writer.close();
+        dump_writer.print_backpressure(std::cout);
     }
 
+    // Per-phase timings of the profiling build
+    PROFILE_REPORT(std::cout, profile_file_name);
+
+    if (collect_curves)
+        curves.write(curves_file_name, config_names, {"L(r-p)", "L(r-i)"});
+
     if (collect_stats) {
-        print_stats(ab_pairs, lrp_results, lri_results, size_of_cons_val, stats_file_name);
+        print_stats(ab_pairs, lrp_results, lri_results, size_of_cons_val, stats_file_name,
+                    sequential_stopping ? &stopping : nullptr);
     }
+
+    // The sweep is complete, nothing to resume
+    progress.remove();
     return 0;
 }
 /**
- * Prints all statistics to file
+ * Prints all statistics to file, with the environments every alpha and beta pair used when stopping is given
  **/
 void print_stats(std::vector<std::vector<std::vector<double>>> ab_pairs
                 ,std::vector<std::vector<std::vector<double>>> lrp_results 
                 ,std::vector<std::vector<double>> lri_results, 
-                int size_of_cons_val, std::string stats_file_name){
+                int size_of_cons_val, std::string stats_file_name, SequentialStopping *stopping){
     // Open the stats file
     std::ofstream stats_file;
     stats_file.open(stats_file_name, std::ofstream::trunc);
@@ -215,7 +461,10 @@ void print_stats(std::vector<std::vector<std::vector<double>>> ab_pairs
     // Prints the header for our L(r-p)
     stats_file << "L(r-p) Statistics\n\n";
     stats_file << SIDE_OFFSET << "alpha" << COL_WIDTH << "beta" << COL_WIDTH_2
-              << "% Optimal" << COL_WIDTH << "% Reward" << std::endl;
+              << "% Optimal" << COL_WIDTH << "% Reward";
+    if (stopping != nullptr)
+        stats_file << COL_WIDTH << "Envs" << "  Stopped";
+    stats_file << std::endl;
     stats_file << "----------------------------------------------------------------------------------------------------" << std::endl;
     
     // Print all the values
@@ -227,7 +476,11 @@ void print_stats(std::vector<std::vector<std::vector<double>>> ab_pairs
             stats_file << SIDE_OFFSET << ab_pairs[alpha_index][beta_index][0] 
                       << COL_WIDTH << ab_pairs[alpha_index][beta_index][1] 
                       << COL_WIDTH << lrp_results[alpha_index][beta_index][0] * 100 << "%"
-                      << COL_WIDTH << lrp_results[alpha_index][beta_index][1] * 100 << "%" << std::endl;
+                      << COL_WIDTH << lrp_results[alpha_index][beta_index][1] * 100 << "%";
+            if (stopping != nullptr)
+                stats_file << COL_WIDTH << stopping->get_used(alpha_index * size_of_cons_val + beta_index) << "  "
+                           << SequentialStopping::state_name(stopping->get_state(alpha_index * size_of_cons_val + beta_index));
+            stats_file << std::endl;
         }
     }
     stats_file << "----------------------------------------------------------------------------------------------------" << std::endl;
@@ -245,4 +498,48 @@ void print_stats(std::vector<std::vector<std::vector<double>>> ab_pairs
     }
     stats_file << "----------------------------------------------------------------------------------------------------" << std::endl;
     stats_file.close();
-}
\ No newline at end of file
+}
+
+/**
+ * Runs the jobs of a sweep with the L(r-p) and L(r-i) agents and environment specialized for N arms, the same
+ * sweep as run_policy_sweep with two LRAgents
+ **/
+template <int N>
+void run_fixed_lr_sweep(SweepRunner &runner, const std::vector<std::vector<std::vector<double>>> &ab_pairs,
+                        int num_of_envs, int num_of_iters, int print_freq, unsigned long seed,
+                        DumpWriter *dump_writer, std::vector<double> &optm, std::vector<double> &point,
+                        const std::vector<RewardTape> *tapes, const std::vector<int> *jobs, const Drift &drift){
+    int size_of_cons_val = ab_pairs.size();
+    FixedEnvironment<N> env;
+    std::vector<FixedLRAgent<N>> agents = { FixedLRAgent<N>(env, "L(r-p)", 10), FixedLRAgent<N>(env, "L(r-i)", 10, 0) };
+    run_policy_sweep(runner, agents, size_of_cons_val * size_of_cons_val, num_of_envs, N, num_of_iters, print_freq,
+                     seed, dump_writer,
+                     [&](FixedLRAgent<N> &agent, int agent_index, int pair_index, FixedEnvironment<N> &e, Rng r) {
+                         double alpha = ab_pairs[pair_index / size_of_cons_val][pair_index % size_of_cons_val][0];
+                         double beta = ab_pairs[pair_index / size_of_cons_val][pair_index % size_of_cons_val][1];
+                         agent.change_parameters(e, alpha, agent_index == 0 ? beta : 0, r);
+                     }, optm, point, tapes, jobs, drift);
+}
+
+/**
+ * Returns the sweep of the L(r-p) and L(r-i) agents specialized for num_of_arms, nullptr when there is none
+ * (from LR_TREE_MIN_ARMS arms on the LRAgent keeps a tree)
+ **/
+FixedLRSweep get_fixed_lr_sweep(int num_of_arms){
+    switch (num_of_arms) {
+        case 2: return run_fixed_lr_sweep<2>;
+        case 3: return run_fixed_lr_sweep<3>;
+        case 4: return run_fixed_lr_sweep<4>;
+        case 5: return run_fixed_lr_sweep<5>;
+        case 6: return run_fixed_lr_sweep<6>;
+        case 8: return run_fixed_lr_sweep<8>;
+        case 10: return run_fixed_lr_sweep<10>;
+        case 12: return run_fixed_lr_sweep<12>;
+        case 16: return run_fixed_lr_sweep<16>;
+        case 20: return run_fixed_lr_sweep<20>;
+        case 24: return run_fixed_lr_sweep<24>;
+        case 32: return run_fixed_lr_sweep<32>;
+        case 48: return run_fixed_lr_sweep<48>;
+        default: return nullptr;
+    }
+}
@@ -0,0 +1,38 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+
+#include "Trace.hpp"
+
+/**
+ * Rebuilds the text dump of q1/q2 from a binary trace
+ * Usage: ./trace2text.o <trace file> [text file] (the text goes to the standard output by default)
+ **/
+int main(int argc, char **argv){
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <trace file> [text file]" << std::endl;
+        return 1;
+    }
+
+    TraceReader reader;
+    if (!reader.open(argv[1])) {
+        std::cerr << "Could not read trace " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::ofstream text_file;
+    if (argc > 2)
+        text_file.open(argv[2], std::ofstream::trunc);
+    std::ostream &out = (argc > 2) ? text_file : std::cout;
+
+    // Same output style as the dump file
+    out << std::fixed;
+    out << std::setprecision(2);
+
+    if (!reader.print_text(out)) {
+        std::cerr << "Trace " << argv[1] << " is corrupt" << std::endl;
+        return 1;
+    }
+    return 0;
+}